@@ -0,0 +1,606 @@
+#include "Benchmark.h"
+#include "Game.h"
+#include "String.h"
+#include "Stream.h"
+#include "Platform.h"
+#include "Logger.h"
+#include "Entity.h"
+#include "World.h"
+#include "ExtMath.h"
+#include "MapRenderer.h"
+#include "Window.h"
+#include "Funcs.h"
+#include "Constants.h"
+#include "Deflate.h"
+#include "Formats.h"
+#include "Utils.h"
+#include "Graphics.h"
+#include "Bitmap.h"
+#include "Block.h"
+#include "TexturePack.h"
+#include "Lighting.h"
+
+cc_bool Benchmark_Enabled;
+int Benchmark_Seed;
+int Benchmark_Frames = 1000;
+static char outputBuffer[FILENAME_SIZE];
+cc_string Benchmark_OutputPath = String_FromArray(outputBuffer);
+
+struct BenchmarkFrame {
+	float frameMS, mapUpdateMS;
+	int chunkBuilds, vertices, drawCalls;
+};
+static struct BenchmarkFrame* frames;
+static struct BenchmarkFrame* curFrame;
+static cc_uint64 frameStart;
+static int framesCount;
+static cc_bool recording;
+
+
+/*########################################################################################################################*
+*------------------------------------------------------Camera path--------------------------------------------------------*
+*#########################################################################################################################*/
+/* Flies one lap around the centre of the map, facing along the direction of travel */
+/* The path only depends on the frame index, so each run renders exactly the same views */
+static void MoveAlongPath(int frame) {
+	struct Entity* e = &Entities.CurPlayer->Base;
+	struct LocationUpdate update;
+	float angle  = (2.0f * MATH_PI * frame) / Benchmark_Frames;
+	float radius = min(World.Width, World.Length) * 0.375f;
+
+	update.pos.x = World.Width  * 0.5f + Math_CosF(angle) * radius;
+	update.pos.z = World.Length * 0.5f + Math_SinF(angle) * radius;
+	update.pos.y = World.Height * 0.75f + Math_SinF(angle * 2.0f) * 8.0f;
+
+	update.yaw   = angle * MATH_RAD2DEG + 180.0f;
+	update.pitch = 20.0f;
+	update.flags = LU_HAS_POS | LU_HAS_PITCH | LU_HAS_YAW | LU_POS_ABSOLUTE_INSTANT;
+	e->VTABLE->SetLocation(e, &update);
+	Vec3_Set(e->Velocity, 0,0,0);
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------------Recording--------------------------------------------------------*
+*#########################################################################################################################*/
+static void WriteResults(void) {
+	cc_string line; char lineBuffer[STRING_SIZE];
+	struct BenchmarkFrame* f;
+	struct Stream stream;
+	cc_result res;
+	int i;
+
+	res = Stream_CreateFile(&stream, &Benchmark_OutputPath);
+	if (res) { Logger_SysWarn2(res, "creating", &Benchmark_OutputPath); return; }
+
+	line = String_FromReadonly("frame,frame_ms,mapupdate_ms,chunk_builds,vertices,draw_calls");
+	res  = Stream_WriteLine(&stream, &line);
+
+	for (i = 0; !res && i < framesCount; i++) {
+		f = &frames[i];
+		String_InitArray(line, lineBuffer);
+
+		String_Format4(&line, "%i,%f3,%f3,%i,", &i, &f->frameMS, &f->mapUpdateMS, &f->chunkBuilds);
+		String_Format2(&line, "%i,%i", &f->vertices, &f->drawCalls);
+		res = Stream_WriteLine(&stream, &line);
+	}
+	if (res) Logger_SysWarn2(res, "writing to", &Benchmark_OutputPath);
+
+	res = stream.Close(&stream);
+	if (res) { Logger_SysWarn2(res, "closing", &Benchmark_OutputPath); }
+}
+
+static void LogSummary(void) {
+	float total = 0.0f, maxMS = 0.0f, avgMS;
+	int i, builds = 0;
+
+	for (i = 0; i < framesCount; i++) {
+		total  += frames[i].frameMS;
+		builds += frames[i].chunkBuilds;
+		maxMS   = max(maxMS, frames[i].frameMS);
+	}
+	avgMS = total / framesCount;
+
+	Platform_Log4("Benchmark: %i frames, %f3 ms average, %f3 ms worst, %i chunk builds",
+					&framesCount, &avgMS, &maxMS, &builds);
+}
+
+static void FinishBenchmark(void) {
+	recording = false;
+	WriteResults();
+	LogSummary();
+	Window_RequestClose();
+}
+
+void Benchmark_BeginFrame(void) {
+	curFrame = NULL;
+	if (!recording) return;
+
+	MoveAlongPath(framesCount);
+	curFrame   = &frames[framesCount];
+	frameStart = Stopwatch_Measure();
+
+	curFrame->mapUpdateMS = 0.0f;
+	curFrame->chunkBuilds = 0;
+}
+
+void Benchmark_EndFrame(void) {
+	cc_uint64 end;
+	if (!curFrame) return;
+
+	end = Stopwatch_Measure();
+	curFrame->frameMS   = Stopwatch_ElapsedMicroseconds(frameStart, end) / 1000.0f;
+	curFrame->vertices  = Game_Vertices;
+	curFrame->drawCalls = Game_DrawCalls;
+	curFrame = NULL;
+
+	if (++framesCount == Benchmark_Frames) FinishBenchmark();
+}
+
+void Benchmark_UpdateMap(float delta) {
+	cc_uint64 beg, end;
+	int updates;
+
+	if (!curFrame) { MapRenderer_Update(delta); return; }
+	updates = Game.ChunkUpdates;
+	beg     = Stopwatch_Measure();
+
+	MapRenderer_Update(delta);
+	end = Stopwatch_Measure();
+
+	/* Anaglyph 3D renders the world twice per frame */
+	curFrame->mapUpdateMS += Stopwatch_ElapsedMicroseconds(beg, end) / 1000.0f;
+	curFrame->chunkBuilds += Game.ChunkUpdates - updates;
+}
+
+
+/*########################################################################################################################*
+*----------------------------------------------------Map compression------------------------------------------------------*
+*#########################################################################################################################*/
+static cc_uint32 compressedSize;
+static cc_result CountingWrite(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	compressedSize += count;
+	*modified = count;
+	return 0;
+}
+
+/* Logs how small and how quickly the map compresses with each compression level */
+static void BenchmarkCompression(void) {
+	struct Stream counter, compStream;
+	struct GZipState* state;
+	cc_uint64 beg, end;
+	float elapsedMS, mbPerSec;
+	int level, size, compSize;
+	cc_result res;
+
+	state = (struct GZipState*)Mem_TryAlloc(1, sizeof(struct GZipState));
+	if (!state) return;
+	Stream_Init(&counter);
+	counter.Write = CountingWrite;
+
+	for (level = 0; level < DEFLATE_LEVEL_COUNT; level++) {
+		compressedSize = 0;
+		beg = Stopwatch_Measure();
+
+		GZip_MakeStream(&compStream, state, &counter);
+		Deflate_SetLevel(&state->Base, level);
+		res = Cw_Save(&compStream);
+		if (!res) res = compStream.Close(&compStream);
+
+		end = Stopwatch_Measure();
+		if (res) { Logger_SysWarn(res, "compressing map"); break; }
+
+		elapsedMS = Stopwatch_ElapsedMicroseconds(beg, end) / 1000.0f;
+		mbPerSec  = (state->Size / (1024.0f * 1024.0f)) / (max(elapsedMS, 0.001f) / 1000.0f);
+		size = state->Size; compSize = compressedSize;
+
+		Platform_Log4("Benchmark: %c map compression, %i bytes to %i bytes, %f1 MB/s",
+						Deflate_LevelNames[level], &size, &compSize, &mbPerSec);
+	}
+	Mem_Free(state);
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------------CRC32-----------------------------------------------------------*
+*#########################################################################################################################*/
+#ifndef CC_BUILD_CHUNKEDWORLD
+static float MeasureGBPerSec(cc_uint64 beg, cc_uint64 end, int size) {
+	float elapsedMS = Stopwatch_ElapsedMicroseconds(beg, end) / 1000.0f;
+	return (size / (1024.0f * 1024.0f * 1024.0f)) / (max(elapsedMS, 0.001f) / 1000.0f);
+}
+
+/* Logs how quickly the map's blocks are checksummed, compared to the simple one byte at a time method */
+static void BenchmarkCrc32(void) {
+	cc_uint32 simpleCrc, crc = 0xFFFFFFFFUL;
+	cc_uint64 beg, mid, end;
+	float fastRate, simpleRate;
+	int i;
+
+	beg = Stopwatch_Measure();
+	simpleCrc = Utils_CRC32(World.Blocks, World.Volume);
+	mid = Stopwatch_Measure();
+
+	for (i = 0; i < World.Volume; i++) {
+		crc = Utils_Crc32Table[(crc ^ World.Blocks[i]) & 0xFF] ^ (crc >> 8);
+	}
+	end = Stopwatch_Measure();
+
+	if ((crc ^ 0xFFFFFFFFUL) != simpleCrc) Platform_LogConst("Benchmark: CRC32 mismatch");
+	fastRate   = MeasureGBPerSec(beg, mid, World.Volume);
+	simpleRate = MeasureGBPerSec(mid, end, World.Volume);
+	Platform_Log2("Benchmark: CRC32 %f3 GB/s, one byte at a time %f3 GB/s", &fastRate, &simpleRate);
+}
+#else
+/* World.Blocks is freed once the map has been converted into chunks */
+static void BenchmarkCrc32(void) { }
+#endif
+
+
+/*########################################################################################################################*
+*------------------------------------------------------Chunk sorting------------------------------------------------------*
+*#########################################################################################################################*/
+/* Chunks in a 1024 x 256 x 1024 map */
+#define SORT_CHUNKS_X 64
+#define SORT_CHUNKS_Y 16
+#define SORT_CHUNKS_Z 64
+#define SORT_CHUNKS_COUNT (SORT_CHUNKS_X * SORT_CHUNKS_Y * SORT_CHUNKS_Z)
+/* Number of chunk boundaries the camera crosses */
+#define SORT_STEPS 128
+static cc_uint32* sortKeys;
+static void** sortValues;
+
+/* How the map renderer used to sort chunks, for comparison */
+static void QuickSortChunks(int left, int right) {
+	void** values  = sortValues; void* value;
+	cc_uint32* keys = sortKeys;  cc_uint32 key;
+
+	while (left < right) {
+		int i = left, j = right;
+		cc_uint32 pivot = keys[(i + j) >> 1];
+
+		/* partition the list */
+		while (i <= j) {
+			while (pivot > keys[i]) i++;
+			while (pivot < keys[j]) j--;
+			QuickSort_Swap_KV_Maybe();
+		}
+		/* recurse into the smaller subset */
+		QuickSort_Recurse(QuickSortChunks)
+	}
+}
+
+/* Calculates the distance of each chunk from the camera, keeping the order from the previous sort */
+static void CalcChunkDistances(cc_uint32* keys, void** values, int step) {
+	float angle = (2.0f * MATH_PI * step) / SORT_STEPS;
+	int camX = (int)(SORT_CHUNKS_X * 0.5f + Math_CosF(angle) * SORT_CHUNKS_X * 0.375f);
+	int camZ = (int)(SORT_CHUNKS_Z * 0.5f + Math_SinF(angle) * SORT_CHUNKS_Z * 0.375f);
+	int camY = SORT_CHUNKS_Y * 3 / 4;
+	int i, index, dx, dy, dz;
+
+	for (i = 0; i < SORT_CHUNKS_COUNT; i++) {
+		index = (int)(cc_uintptr)values[i];
+		dx = (index % SORT_CHUNKS_X) - camX;
+		dz = (index / SORT_CHUNKS_X) % SORT_CHUNKS_Z - camZ;
+		dy = (index / (SORT_CHUNKS_X * SORT_CHUNKS_Z)) - camY;
+		keys[i] = (dx * dx + dy * dy + dz * dz) * CHUNK_SIZE * CHUNK_SIZE;
+	}
+}
+
+/* Logs how long sorting chunks by distance takes each time the camera moves into another chunk */
+static void BenchmarkChunkSort(void) {
+	cc_uint32 *keysBuffer, *keys, *tmpKeys, *swapKeys;
+	void **valuesBuffer, **values, **tmpValues, **swapValues;
+	cc_uint64 beg, end, radixTime = 0, quickTime = 0;
+	float radixMS, quickMS;
+	int i, step, count = SORT_CHUNKS_COUNT;
+
+	keysBuffer   = (cc_uint32*)Mem_TryAlloc(count * 2, sizeof(cc_uint32));
+	valuesBuffer = (void**)Mem_TryAlloc(count * 2, sizeof(void*));
+	if (!keysBuffer || !valuesBuffer) { Mem_Free(keysBuffer); Mem_Free(valuesBuffer); return; }
+
+	keys   = keysBuffer;   tmpKeys   = keysBuffer   + count;
+	values = valuesBuffer; tmpValues = valuesBuffer + count;
+
+	for (i = 0; i < count; i++) { values[i] = (void*)(cc_uintptr)i; }
+	for (step = 0; step < SORT_STEPS; step++) {
+		CalcChunkDistances(keys, values, step);
+		beg = Stopwatch_Measure();
+		if (Utils_RadixSortKV(keys, values, tmpKeys, tmpValues, count)) {
+			swapKeys   = keys;   keys   = tmpKeys;   tmpKeys   = swapKeys;
+			swapValues = values; values = tmpValues; tmpValues = swapValues;
+		}
+		end = Stopwatch_Measure();
+		radixTime += Stopwatch_ElapsedMicroseconds(beg, end);
+	}
+
+	sortKeys = keys; sortValues = values;
+	for (i = 0; i < count; i++) { values[i] = (void*)(cc_uintptr)i; }
+	for (step = 0; step < SORT_STEPS; step++) {
+		CalcChunkDistances(keys, values, step);
+		beg = Stopwatch_Measure();
+		QuickSortChunks(0, count - 1);
+		end = Stopwatch_Measure();
+		quickTime += Stopwatch_ElapsedMicroseconds(beg, end);
+	}
+
+	radixMS = radixTime / (1000.0f * SORT_STEPS);
+	quickMS = quickTime / (1000.0f * SORT_STEPS);
+	Platform_Log3("Benchmark: Sorting %i chunks, %f3 ms radix sort, %f3 ms quicksort", &count, &radixMS, &quickMS);
+	Mem_Free(keysBuffer);
+	Mem_Free(valuesBuffer);
+}
+
+
+/*########################################################################################################################*
+*----------------------------------------------------Lighting heightmap---------------------------------------------------*
+*#########################################################################################################################*/
+#define HEIGHTMAP_RUNS 10
+
+/* Logs how long calculating the classic lighting heightmap for every chunk column of the map takes */
+static void BenchmarkHeightmap(void) {
+	cc_uint64 beg, end, elapsed = 0;
+	int x, z, run, hash = 0;
+	float ms;
+	if (!World.Volume) return;
+
+	for (run = 0; run < HEIGHTMAP_RUNS; run++) {
+		ClassicLighting_Refresh();
+		beg = Stopwatch_Measure();
+
+		for (z = 0; z < World.Length; z += CHUNK_SIZE) {
+			for (x = 0; x < World.Width; x += CHUNK_SIZE) {
+				ClassicLighting_LightHint(x - 1, 0, z - 1);
+			}
+		}
+		end = Stopwatch_Measure();
+		elapsed += end - beg;
+	}
+
+	/* So that results from different builds can be checked to be the same */
+	for (z = 0; z < World.Length; z++) {
+		for (x = 0; x < World.Width; x++) {
+			hash = hash * 31 + ClassicLighting_GetLightHeight(x, z);
+		}
+	}
+	/* Leave the heightmap as it was when the map was loaded */
+	ClassicLighting_Refresh();
+
+	ms = Stopwatch_ElapsedMicroseconds(0, elapsed) / (1000.0f * HEIGHTMAP_RUNS);
+	Platform_Log2("Benchmark: Lighting heightmap %f3 ms per map, hash %i", &ms, &hash);
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------SoftGPU rasterisation---------------------------------------------------*
+*#########################################################################################################################*/
+#if CC_GFX_BACKEND == CC_GFX_BACKEND_SOFTGPU
+/* Rendered at a fixed size, so results don't depend on the size of the window or terminal */
+#define RASTER_WIDTH   1280
+#define RASTER_HEIGHT  720
+/* Columns along each side of the generated terrain */
+#define RASTER_TERRAIN 96
+#define RASTER_WATER_Y 5
+#define RASTER_FRAMES  20
+static struct VertexTextured* rasterVertices;
+static int rasterCount;
+
+static int RasterHeight(int x, int z) {
+	if (x < 0 || z < 0 || x >= RASTER_TERRAIN || z >= RASTER_TERRAIN) return 0;
+	return max(1, 5 + (int)(Math_SinF(x * 0.21f) * 3.0f + Math_CosF(z * 0.17f) * 3.0f));
+}
+
+/* Adds a quad textured with the given tile, or just counts it when there is no vertex buffer yet */
+static void AddRasterQuad(Vec3 a, Vec3 b, Vec3 c, Vec3 d, BlockID block, Face face, PackedCol col) {
+	struct VertexTextured* v = rasterVertices + rasterCount;
+	TextureLoc loc = Block_Tex(block, face);
+	float v1 = Atlas1D_RowId(loc) * Atlas1D.InvTileSize;
+	float v2 = v1 + Atlas1D.InvTileSize;
+
+	rasterCount += 4;
+	if (!rasterVertices) return;
+	v->x = a.x; v->y = a.y; v->z = a.z; v->Col = col; v->U = 0.0f; v->V = v1; v++;
+	v->x = b.x; v->y = b.y; v->z = b.z; v->Col = col; v->U = 1.0f; v->V = v1; v++;
+	v->x = c.x; v->y = c.y; v->z = c.z; v->Col = col; v->U = 1.0f; v->V = v2; v++;
+	v->x = d.x; v->y = d.y; v->z = d.z; v->Col = col; v->U = 0.0f; v->V = v2;
+}
+
+/* Adds the faces of each column that can be seen, like the chunk builder does */
+static void AddRasterTerrain(void) {
+	PackedCol colX = PackedCol_Scale(PACKEDCOL_WHITE, PACKEDCOL_SHADE_X);
+	PackedCol colZ = PackedCol_Scale(PACKEDCOL_WHITE, PACKEDCOL_SHADE_Z);
+	Vec3 a, b, c, d;
+	int x, y, z, h;
+
+	for (z = 0; z < RASTER_TERRAIN; z++) {
+		for (x = 0; x < RASTER_TERRAIN; x++) {
+			h = RasterHeight(x, z);
+			Vec3_Set(a, x, h, z); Vec3_Set(b, x + 1, h, z); Vec3_Set(c, x + 1, h, z + 1); Vec3_Set(d, x, h, z + 1);
+			AddRasterQuad(a, b, c, d, BLOCK_GRASS, FACE_YMAX, PACKEDCOL_WHITE);
+
+			for (y = RasterHeight(x - 1, z); y < h; y++) {
+				Vec3_Set(a, x, y + 1, z); Vec3_Set(b, x, y + 1, z + 1); Vec3_Set(c, x, y, z + 1); Vec3_Set(d, x, y, z);
+				AddRasterQuad(a, b, c, d, BLOCK_DIRT, FACE_XMIN, colX);
+			}
+			for (y = RasterHeight(x + 1, z); y < h; y++) {
+				Vec3_Set(a, x + 1, y + 1, z + 1); Vec3_Set(b, x + 1, y + 1, z); Vec3_Set(c, x + 1, y, z); Vec3_Set(d, x + 1, y, z + 1);
+				AddRasterQuad(a, b, c, d, BLOCK_DIRT, FACE_XMAX, colX);
+			}
+			for (y = RasterHeight(x, z - 1); y < h; y++) {
+				Vec3_Set(a, x + 1, y + 1, z); Vec3_Set(b, x, y + 1, z); Vec3_Set(c, x, y, z); Vec3_Set(d, x + 1, y, z);
+				AddRasterQuad(a, b, c, d, BLOCK_DIRT, FACE_ZMIN, colZ);
+			}
+			for (y = RasterHeight(x, z + 1); y < h; y++) {
+				Vec3_Set(a, x, y + 1, z + 1); Vec3_Set(b, x + 1, y + 1, z + 1); Vec3_Set(c, x + 1, y, z + 1); Vec3_Set(d, x, y, z + 1);
+				AddRasterQuad(a, b, c, d, BLOCK_DIRT, FACE_ZMAX, colZ);
+			}
+		}
+	}
+}
+
+static void AddRasterWater(void) {
+	float y = RASTER_WATER_Y - 0.1f;
+	Vec3 a, b, c, d;
+	int x, z;
+
+	for (z = 0; z < RASTER_TERRAIN; z++) {
+		for (x = 0; x < RASTER_TERRAIN; x++) {
+			if (RasterHeight(x, z) >= RASTER_WATER_Y) continue;
+			Vec3_Set(a, x, y, z); Vec3_Set(b, x + 1, y, z); Vec3_Set(c, x + 1, y, z + 1); Vec3_Set(d, x, y, z + 1);
+			AddRasterQuad(a, b, c, d, BLOCK_STILL_WATER, FACE_YMAX, PACKEDCOL_WHITE);
+		}
+	}
+}
+
+static void LoadRasterView(float x, float y, float z, float yaw, float pitch) {
+	struct Matrix proj, view;
+	Vec3 pos; Vec2 rot;
+
+	Gfx_CalcPerspectiveMatrix(&proj, 70.0f * MATH_DEG2RAD, (float)RASTER_WIDTH / RASTER_HEIGHT, 256.0f);
+	Vec3_Set(pos, x, y, z);
+	rot.x = yaw * MATH_DEG2RAD; rot.y = pitch * MATH_DEG2RAD;
+	Matrix_LookRot(&view, pos, rot);
+
+	Gfx_LoadMatrix(MATRIX_PROJECTION, &proj);
+	Gfx_LoadMatrix(MATRIX_VIEW,       &view);
+}
+
+/* Draws opaque terrain, then translucent water over it, the same way the map renderer does */
+static void DrawRasterScene(GfxResourceID vb, int terrainCount, int waterCount) {
+	Gfx_ClearBuffers(GFX_BUFFER_COLOR | GFX_BUFFER_DEPTH);
+	Gfx_BindVb(vb);
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Gfx_BindTexture(Atlas1D.TexIds[0]);
+
+	Gfx_SetAlphaTest(true);
+	Gfx_DrawVb_IndexedTris(terrainCount);
+	Gfx_SetAlphaTest(false);
+
+	Gfx_SetAlphaBlending(true);
+	Gfx_SetDepthWrite(false);
+	Gfx_DrawVb_IndexedTris_Range(waterCount, terrainCount);
+	Gfx_SetDepthWrite(true);
+	Gfx_SetAlphaBlending(false);
+}
+
+/* Counts the pixels that nothing was drawn over, i.e. that are still the clear colour */
+static int CountUncoveredPixels(void) {
+	BitmapCol clear = BitmapCol_Make(255, 0, 255, 255);
+	struct Stream shot, stream;
+	struct Bitmap bmp;
+	cc_result res;
+	int i, count = 0;
+
+	res = Stream_WriteonlyMemory(&shot, RASTER_WIDTH * RASTER_HEIGHT);
+	if (res) return -1;
+	res = Gfx_TakeScreenshot(&shot);
+	if (res) { Logger_SysWarn(res, "taking screenshot"); shot.Close(&shot); return -1; }
+
+	Stream_ReadonlyMemory(&stream, shot.meta.mem.base, shot.meta.mem.length);
+	res = Png_Decode(&bmp, &stream);
+	shot.Close(&shot);
+	if (res) { Logger_SysWarn(res, "decoding screenshot"); Mem_Free(bmp.scan0); return -1; }
+
+	for (i = 0; i < bmp.width * bmp.height; i++) {
+		if (bmp.scan0[i] == clear) count++;
+	}
+	Mem_Free(bmp.scan0);
+	return count;
+}
+
+/* Logs how long rendering a fixed terrain scene takes, and how many pixels are left uncovered */
+/*  when the camera is so close to the ground that nearby quads cross the near plane */
+/* NOTE: Set gfx-softgputhreads to 0 in options.txt to measure a single thread */
+static void BenchmarkRasterisation(void) {
+	int oldWidth = Game.Width, oldHeight = Game.Height;
+	int i, terrainCount, waterCount, quads, uncovered;
+	GfxResourceID vb;
+	cc_uint64 beg, end;
+	float frameMS, pixelNS;
+
+	rasterVertices = NULL; rasterCount = 0;
+	AddRasterTerrain(); terrainCount = rasterCount;
+	AddRasterWater();   waterCount   = rasterCount - terrainCount;
+
+	vb = Gfx_CreateVb(VERTEX_FORMAT_TEXTURED, rasterCount);
+	if (!vb) return;
+	rasterVertices = (struct VertexTextured*)Gfx_LockVb(vb, VERTEX_FORMAT_TEXTURED, rasterCount);
+	rasterCount    = 0;
+	AddRasterTerrain();
+	AddRasterWater();
+	Gfx_UnlockVb(vb);
+	rasterVertices = NULL;
+
+	Game.Width = RASTER_WIDTH; Game.Height = RASTER_HEIGHT;
+	Gfx_OnWindowResize();
+	/* Not used by any of the textures, so uncovered pixels can be counted afterwards */
+	Gfx_ClearColor(PackedCol_Make(255, 0, 255, 255));
+
+	/* Looking across the terrain from above one side */
+	LoadRasterView(RASTER_TERRAIN * 0.5f, 40.0f, RASTER_TERRAIN * 1.15f, 0.0f, 30.0f);
+	DrawRasterScene(vb, terrainCount, waterCount);
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < RASTER_FRAMES; i++) {
+		DrawRasterScene(vb, terrainCount, waterCount);
+	}
+	/* Triangles are binned until the buffers are next cleared */
+	Gfx_ClearBuffers(0);
+	end = Stopwatch_Measure();
+
+	quads   = (terrainCount + waterCount) / 4;
+	frameMS = Stopwatch_ElapsedMicroseconds(beg, end) / (1000.0f * RASTER_FRAMES);
+	pixelNS = frameMS * 1000000.0f / (RASTER_WIDTH * RASTER_HEIGHT);
+	Platform_Log3("Benchmark: SoftGPU %i quads at 1280x720, %f3 ms per frame, %f2 ns per pixel",
+					&quads, &frameMS, &pixelNS);
+
+	/* Just above the ground, so the quads around the camera cross the near plane */
+	LoadRasterView(30.5f, RasterHeight(30, 30) + 0.25f, 30.5f, 0.0f, 40.0f);
+	DrawRasterScene(vb, terrainCount, waterCount);
+	uncovered = CountUncoveredPixels();
+	Platform_Log1("Benchmark: SoftGPU camera near the ground, %i pixels uncovered", &uncovered);
+
+	Gfx_DeleteVb(&vb);
+
+	Game.Width = oldWidth; Game.Height = oldHeight;
+	Gfx_OnWindowResize();
+}
+#else
+/* Other backends render asynchronously on the GPU, so the time taken can't be measured here */
+static void BenchmarkRasterisation(void) { }
+#endif
+
+
+/*########################################################################################################################*
+*-------------------------------------------------Benchmark component-----------------------------------------------------*
+*#########################################################################################################################*/
+static void OnNewMapLoaded(void) {
+	if (!Benchmark_Enabled || frames) return;
+	BenchmarkCompression();
+	BenchmarkCrc32();
+	BenchmarkChunkSort();
+	BenchmarkHeightmap();
+	BenchmarkRasterisation();
+
+	frames    = (struct BenchmarkFrame*)Mem_Alloc(Benchmark_Frames, sizeof(struct BenchmarkFrame), "benchmark frames");
+	recording = true;
+	/* Frame time should reflect rendering cost, not the FPS limiter */
+	Game_SetFpsLimit(FPS_LIMIT_NONE);
+	/* View bobbing depends on the player's physics, which varies with frame timing */
+	Game_ViewBobbing = false;
+}
+
+static void OnFree(void) {
+	if (frames) Mem_Free(frames);
+	frames      = NULL;
+	recording   = false;
+	framesCount = 0;
+}
+
+struct IGameComponent Benchmark_Component = {
+	NULL,          /* Init  */
+	OnFree,        /* Free  */
+	NULL,          /* Reset */
+	NULL,          /* OnNewMap */
+	OnNewMapLoaded /* OnNewMapLoaded */
+};
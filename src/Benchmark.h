@@ -0,0 +1,29 @@
+#ifndef CC_BENCHMARK_H
+#define CC_BENCHMARK_H
+#include "Core.h"
+/* Replays a scripted camera path over a map and records per-frame timings to a CSV file.
+   Intended to be run headless (e.g. SoftGPU + Terminal backends) to catch performance regressions.
+   Also logs how quickly the map compresses when saved, with each compression level.
+   Copyright 2014-2023 ClassiCube | Licensed under BSD-3
+*/
+
+struct IGameComponent;
+extern struct IGameComponent Benchmark_Component;
+
+/* Whether the game is running in benchmark mode */
+extern cc_bool Benchmark_Enabled;
+/* Seed used to generate the map, when a map file is not being loaded */
+extern int Benchmark_Seed;
+/* Number of frames to record before exiting */
+extern int Benchmark_Frames;
+/* Path of the CSV file the per-frame timings are written to */
+extern cc_string Benchmark_OutputPath;
+
+/* Moves the camera to the next point along the scripted path */
+/* NOTE: Must be called after scheduled tasks, so the player's physics tick does not override it */
+void Benchmark_BeginFrame(void);
+/* Records the timings of the frame that was just rendered */
+void Benchmark_EndFrame(void);
+/* Calls MapRenderer_Update, recording how long it took and how many chunks were built */
+void Benchmark_UpdateMap(float delta);
+#endif
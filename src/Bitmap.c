@@ -637,13 +637,12 @@ static void Png_EncodeRow(const cc_uint8* cur, const cc_uint8* prior, cc_uint8*
 
 static BitmapCol* DefaultGetRow(struct Bitmap* bmp, int y, void* ctx) { return Bitmap_GetRow(bmp, y); }
 static cc_result Png_EncodeCore(struct Bitmap* bmp, struct Stream* stream, cc_uint8* buffer,
-					Png_RowGetter getRow, cc_bool alpha, void* ctx) {
+					struct ZLibState* zlState, Png_RowGetter getRow, cc_bool alpha, void* ctx) {
 	cc_uint8 tmp[32];
 	cc_uint8* prevLine = buffer;
 	cc_uint8*  curLine = buffer + (bmp->width * 4) * 1;
 	cc_uint8* bestLine = buffer + (bmp->width * 4) * 2;
 
-	struct ZLibState zlState;
 	struct Stream chunk, zlStream;
 	cc_uint32 stream_end, stream_beg;
 	int y, lineSize;
@@ -676,7 +675,7 @@ static cc_result Png_EncodeCore(struct Bitmap* bmp, struct Stream* stream, cc_ui
 	Stream_SetU32_BE(&tmp[0], PNG_FourCC('I','D','A','T'));
 	if ((res = Stream_Write(&chunk, tmp, 4))) return res;
 
-	ZLib_MakeStream(&zlStream, &zlState, &chunk); 
+	ZLib_MakeStream(&zlStream, zlState, &chunk); 
 	lineSize = bmp->width * (alpha ? 4 : 3);
 	Mem_Set(prevLine, 0, lineSize);
 
@@ -714,9 +713,15 @@ cc_result Png_Encode(struct Bitmap* bmp, struct Stream* stream,
 	cc_result res;
 	/* Add 1 for scanline filter type byter */
 	cc_uint8* buffer = Mem_TryAlloc(3, bmp->width * 4 + 1);
+	/* ZLib state is too large to safely allocate on the stack */
+	struct ZLibState* zlState;
 	if (!buffer) return ERR_NOT_SUPPORTED;
 
-	res = Png_EncodeCore(bmp, stream, buffer, getRow, alpha, ctx);
+	zlState = (struct ZLibState*)Mem_TryAlloc(1, sizeof(struct ZLibState));
+	if (!zlState) { Mem_Free(buffer); return ERR_OUT_OF_MEMORY; }
+
+	res = Png_EncodeCore(bmp, stream, buffer, zlState, getRow, alpha, ctx);
+	Mem_Free(zlState);
 	Mem_Free(buffer);
 	return res;
 }
@@ -14,6 +14,17 @@
 #include "Vectors.h"
 #include "Chat.h"
 
+/* Physics only looks at the lower 8 bits of blocks */
+/* Physics_GetBlockAt is for when the coordinates of the index are already known */
+#ifdef CC_BUILD_CHUNKEDWORLD
+/* Looking up a block by index has to unpack the index into coordinates first, which is slow */
+#define Physics_GetBlock(index) ((BlockRaw)World_GetRawBlock(index))
+#define Physics_GetBlockAt(x, y, z, index) ((BlockRaw)World_GetBlock(x, y, z))
+#else
+#define Physics_GetBlock(index) World.Blocks[index]
+#define Physics_GetBlockAt(x, y, z, index) World.Blocks[index]
+#endif
+
 /* Data for a resizable queue, used for liquid physic tick entries. */
 struct TickQueue {
 	cc_uint32* entries; /* Buffer holding the items in the tick queue */
@@ -117,19 +128,19 @@ void Physics_SetEnabled(cc_bool enabled) {
 	Physics_OnNewMapLoaded(NULL);
 }
 
-static void Physics_Activate(int index) {
-	BlockID block = World.Blocks[index];
+static void Physics_Activate(int x, int y, int z, int index) {
+	BlockID block = Physics_GetBlockAt(x, y, z, index);
 	PhysicsHandler activate = Physics.OnActivate[block];
 	if (activate) activate(index, block);
 }
 
 static void Physics_ActivateNeighbours(int x, int y, int z, int index) {
-	if (x > 0)          Physics_Activate(index - 1);
-	if (x < World.MaxX) Physics_Activate(index + 1);
-	if (z > 0)          Physics_Activate(index - World.Width);
-	if (z < World.MaxZ) Physics_Activate(index + World.Width);
-	if (y > 0)          Physics_Activate(index - World.OneY);
-	if (y < World.MaxY) Physics_Activate(index + World.OneY);
+	if (x > 0)          Physics_Activate(x - 1, y, z, index - 1);
+	if (x < World.MaxX) Physics_Activate(x + 1, y, z, index + 1);
+	if (z > 0)          Physics_Activate(x, y, z - 1, index - World.Width);
+	if (z < World.MaxZ) Physics_Activate(x, y, z + 1, index + World.Width);
+	if (y > 0)          Physics_Activate(x, y - 1, z, index - World.OneY);
+	if (y < World.MaxY) Physics_Activate(x, y + 1, z, index + World.OneY);
 }
 
 static cc_bool Physics_IsEdgeWater(int x, int y, int z) {
@@ -180,17 +191,17 @@ static void Physics_TickRandomBlocks(void) {
 				hi = World_Pack(x2, y2, z2);
 				
 				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
+				block = Physics_GetBlock(index);
 				tick = Physics.OnRandomTick[block];
 				if (tick) tick(index, block);
 
 				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
+				block = Physics_GetBlock(index);
 				tick = Physics.OnRandomTick[block];
 				if (tick) tick(index, block);
 
 				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
+				block = Physics_GetBlock(index);
 				tick = Physics.OnRandomTick[block];
 				if (tick) tick(index, block);
 			}
@@ -200,28 +211,28 @@ static void Physics_TickRandomBlocks(void) {
 
 
 static void Physics_DoFalling(int index, BlockID block) {
-	int found = -1, start = index;
+	int foundY = -1, start = index;
 	BlockID other;
-	int x, y, z;
+	int x, y, z, startY;
+	World_Unpack(index, x, y, z);
+	startY = y;
 
 	/* Find lowest block can fall into */
-	while (index >= World.OneY) {
-		index -= World.OneY;
-		other  = World.Blocks[index];
+	while (y > 0) {
+		index -= World.OneY; y--;
+		other  = Physics_GetBlockAt(x, y, z, index);
 
 		if (other == BLOCK_AIR || (other >= BLOCK_WATER && other <= BLOCK_STILL_LAVA))
-			found = index;
+			foundY = y;
 		else
 			break;
 	}
 
-	if (found == -1) return;
-	World_Unpack(found, x, y, z);
-	Game_UpdateBlock(x, y, z, block);
+	if (foundY == -1) return;
+	Game_UpdateBlock(x, foundY, z, block);
 
-	World_Unpack(start, x, y, z);
-	Game_UpdateBlock(x, y, z, BLOCK_AIR);
-	Physics_ActivateNeighbours(x, y, z, start);
+	Game_UpdateBlock(x, startY, z, BLOCK_AIR);
+	Physics_ActivateNeighbours(x, startY, z, start);
 }
 
 static cc_bool Physics_CheckItem(struct TickQueue* queue, int* posIndex) {
@@ -247,7 +258,7 @@ static void Physics_HandleSapling(int index, BlockID block) {
 	World_Unpack(index, x, y, z);
 
 	below = BLOCK_AIR;
-	if (y > 0) below = World.Blocks[index - World.OneY];
+	if (y > 0) below = Physics_GetBlockAt(x, y - 1, z, index - World.OneY);
 	if (below != BLOCK_GRASS) return;
 
 	height = 5 + Random_Next(&physics_rnd, 3);
@@ -294,7 +305,7 @@ static void Physics_HandleFlower(int index, BlockID block) {
 	}
 
 	below = BLOCK_DIRT;
-	if (y > 0) below = World.Blocks[index - World.OneY];
+	if (y > 0) below = Physics_GetBlockAt(x, y - 1, z, index - World.OneY);
 	if (!(below == BLOCK_DIRT || below == BLOCK_GRASS)) {
 		Game_UpdateBlock(x, y, z, BLOCK_AIR);
 		Physics_ActivateNeighbours(x, y, z, index);
@@ -313,7 +324,7 @@ static void Physics_HandleMushroom(int index, BlockID block) {
 	}
 
 	below = BLOCK_STONE;
-	if (y > 0) below = World.Blocks[index - World.OneY];
+	if (y > 0) below = Physics_GetBlockAt(x, y - 1, z, index - World.OneY);
 	if (!(below == BLOCK_STONE || below == BLOCK_COBBLE)) {
 		Game_UpdateBlock(x, y, z, BLOCK_AIR);
 		Physics_ActivateNeighbours(x, y, z, index);
@@ -326,7 +337,7 @@ static void Physics_PlaceLava(int index, BlockID block) {
 }
 
 static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
-	BlockID block = World.Blocks[posIndex];
+	BlockID block = Physics_GetBlockAt(x, y, z, posIndex);
 
 	if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) {
 		/* Lava spreading into water turns the water solid */
@@ -339,10 +350,7 @@ static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
 	}
 }
 
-static void Physics_ActivateLava(int index, BlockID block) {
-	int x, y, z;
-	World_Unpack(index, x, y, z);
-
+static void Physics_SpreadLava(int x, int y, int z, int index) {
 	if (x > 0)          Physics_PropagateLava(index - 1, x - 1, y, z);
 	if (x < World.MaxX) Physics_PropagateLava(index + 1, x + 1, y, z);
 	if (z > 0)          Physics_PropagateLava(index - World.Width, x, y, z - 1);
@@ -350,14 +358,22 @@ static void Physics_ActivateLava(int index, BlockID block) {
 	if (y > 0)          Physics_PropagateLava(index - World.OneY, x, y - 1, z);
 }
 
+static void Physics_ActivateLava(int index, BlockID block) {
+	int x, y, z;
+	World_Unpack(index, x, y, z);
+	Physics_SpreadLava(x, y, z, index);
+}
+
 static void Physics_TickLava(void) {
 	int i, count = lavaQ.count;
+	int index, x, y, z;
+	BlockID block;
 	for (i = 0; i < count; i++) {
-		int index;
 		if (Physics_CheckItem(&lavaQ, &index)) {
-			BlockID block = World.Blocks[index];
+			World_Unpack(index, x, y, z);
+			block = Physics_GetBlockAt(x, y, z, index);
 			if (!(block == BLOCK_LAVA || block == BLOCK_STILL_LAVA)) continue;
-			Physics_ActivateLava(index, block);
+			Physics_SpreadLava(x, y, z, index);
 		}
 	}
 }
@@ -367,9 +383,65 @@ static void Physics_PlaceWater(int index, BlockID block) {
 	TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | index);
 }
 
+#ifdef CC_BUILD_CHUNKEDWORLD
+/* Whether the given chunk may contain a sponge, without having to look at every block in it */
+static cc_bool Physics_ChunkMayHaveSponge(const struct WorldChunk* chunk) {
+	int i;
+	if (!chunk->data)       return chunk->uniform == BLOCK_SPONGE;
+	if (chunk->bits == 16)  return true;
+
+	for (i = 0; i < chunk->count; i++) {
+		if (chunk->palette[i] == BLOCK_SPONGE) return true;
+	}
+	return false;
+}
+
+/* Whether there is a sponge in the given inclusive box (checked chunk by chunk) */
+static cc_bool Physics_HasSponge(int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
+	const struct WorldChunk* chunk;
+	int cx, cy, cz, x, y, z;
+	int x1, y1, z1, x2, y2, z2;
+
+	for (cy = minY >> CHUNK_SHIFT; cy <= maxY >> CHUNK_SHIFT; cy++) {
+		for (cz = minZ >> CHUNK_SHIFT; cz <= maxZ >> CHUNK_SHIFT; cz++) {
+			for (cx = minX >> CHUNK_SHIFT; cx <= maxX >> CHUNK_SHIFT; cx++) {
+				chunk = &World.Chunks[World_ChunkPack(cx, cy, cz)];
+				if (!Physics_ChunkMayHaveSponge(chunk)) continue;
+				if (!chunk->data) return true;
+
+				x1 = max(minX, cx << CHUNK_SHIFT); x2 = min(maxX, (cx << CHUNK_SHIFT) + CHUNK_MASK);
+				y1 = max(minY, cy << CHUNK_SHIFT); y2 = min(maxY, (cy << CHUNK_SHIFT) + CHUNK_MASK);
+				z1 = max(minZ, cz << CHUNK_SHIFT); z2 = min(maxZ, (cz << CHUNK_SHIFT) + CHUNK_MASK);
+
+				for (y = y1; y <= y2; y++) {
+					for (z = z1; z <= z2; z++) {
+						for (x = x1; x <= x2; x++) {
+							if (WorldChunk_GetBlock(chunk, World_ChunkLocalIndex(x, y, z)) == BLOCK_SPONGE) return true;
+						}
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+#else
+/* Whether there is a sponge in the given inclusive box */
+static cc_bool Physics_HasSponge(int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
+	int x, y, z;
+	for (y = minY; y <= maxY; y++) {
+		for (z = minZ; z <= maxZ; z++) {
+			for (x = minX; x <= maxX; x++) {
+				if (World_GetBlock(x, y, z) == BLOCK_SPONGE) return true;
+			}
+		}
+	}
+	return false;
+}
+#endif
+
 static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
-	BlockID block = World.Blocks[posIndex];
-	int xx, yy, zz;
+	BlockID block = Physics_GetBlockAt(x, y, z, posIndex);
 
 	if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) {
 		/* Water spreading into lava turns the lava solid */
@@ -377,25 +449,17 @@ static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
 			Game_UpdateBlock(x, y, z, BLOCK_STONE);
 		}
 	} else if (Blocks.Collide[block] == COLLIDE_NONE) {
-		/* Sponge check */		
-		for (yy = (y < 2 ? 0 : y - 2); yy <= (y > physics_maxWaterY ? World.MaxY : y + 2); yy++) {
-			for (zz = (z < 2 ? 0 : z - 2); zz <= (z > physics_maxWaterZ ? World.MaxZ : z + 2); zz++) {
-				for (xx = (x < 2 ? 0 : x - 2); xx <= (x > physics_maxWaterX ? World.MaxX : x + 2); xx++) {
-					block = World_GetBlock(xx, yy, zz);
-					if (block == BLOCK_SPONGE) return;
-				}
-			}
-		}
+		if (Physics_HasSponge(x < 2 ? 0 : x - 2, y < 2 ? 0 : y - 2, z < 2 ? 0 : z - 2,
+				x > physics_maxWaterX ? World.MaxX : x + 2,
+				y > physics_maxWaterY ? World.MaxY : y + 2,
+				z > physics_maxWaterZ ? World.MaxZ : z + 2)) return;
 
 		TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | posIndex);
 		Game_UpdateBlock(x, y, z, BLOCK_WATER);
 	}
 }
 
-static void Physics_ActivateWater(int index, BlockID block) {
-	int x, y, z;
-	World_Unpack(index, x, y, z);
-
+static void Physics_SpreadWater(int x, int y, int z, int index) {
 	if (x > 0)          Physics_PropagateWater(index - 1,           x - 1, y,     z);
 	if (x < World.MaxX) Physics_PropagateWater(index + 1,           x + 1, y,     z);
 	if (z > 0)          Physics_PropagateWater(index - World.Width, x,     y,     z - 1);
@@ -403,14 +467,22 @@ static void Physics_ActivateWater(int index, BlockID block) {
 	if (y > 0)          Physics_PropagateWater(index - World.OneY,  x,     y - 1, z);
 }
 
+static void Physics_ActivateWater(int index, BlockID block) {
+	int x, y, z;
+	World_Unpack(index, x, y, z);
+	Physics_SpreadWater(x, y, z, index);
+}
+
 static void Physics_TickWater(void) {
 	int i, count = waterQ.count;
+	int index, x, y, z;
+	BlockID block;
 	for (i = 0; i < count; i++) {
-		int index;
 		if (Physics_CheckItem(&waterQ, &index)) {
-			BlockID block = World.Blocks[index];
+			World_Unpack(index, x, y, z);
+			block = Physics_GetBlockAt(x, y, z, index);
 			if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) continue;
-			Physics_ActivateWater(index, block);
+			Physics_SpreadWater(x, y, z, index);
 		}
 	}
 }
@@ -445,7 +517,7 @@ static void Physics_DeleteSponge(int index, BlockID block) {
 					if (!World_Contains(xx, yy, zz)) continue;
 
 					index = World_Pack(xx, yy, zz);
-					block = World.Blocks[index];
+					block = Physics_GetBlockAt(xx, yy, zz, index);
 					if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
 						TickQueue_Enqueue(&waterQ, index | PHYSICS_ONE_DELAY);
 					}
@@ -461,7 +533,7 @@ static void Physics_HandleSlab(int index, BlockID block) {
 	World_Unpack(index, x, y, z);
 	if (index < World.OneY) return;
 
-	if (World.Blocks[index - World.OneY] != BLOCK_SLAB) return;
+	if (Physics_GetBlockAt(x, y - 1, z, index - World.OneY) != BLOCK_SLAB) return;
 	Game_UpdateBlock(x, y,     z, BLOCK_AIR);
 	Game_UpdateBlock(x, y - 1, z, BLOCK_DOUBLE_SLAB);
 }
@@ -471,7 +543,7 @@ static void Physics_HandleCobblestoneSlab(int index, BlockID block) {
 	World_Unpack(index, x, y, z);
 	if (index < World.OneY) return;
 
-	if (World.Blocks[index - World.OneY] != BLOCK_COBBLE_SLAB) return;
+	if (Physics_GetBlockAt(x, y - 1, z, index - World.OneY) != BLOCK_COBBLE_SLAB) return;
 	Game_UpdateBlock(x, y,     z, BLOCK_AIR);
 	Game_UpdateBlock(x, y - 1, z, BLOCK_COBBLE);
 }
@@ -504,7 +576,7 @@ static void Physics_HandleTnt(int index, BlockID block) {
 				if (!World_Contains(xx, yy, zz)) continue;
 				index = World_Pack(xx, yy, zz);
 
-				block = World.Blocks[index];
+				block = Physics_GetBlockAt(xx, yy, zz, index);
 				if (BlocksTNT(block)) continue;
 
 				Game_UpdateBlock(xx, yy, zz, BLOCK_AIR);
@@ -562,7 +634,7 @@ void Physics_Free(void) {
 }
 
 void Physics_Tick(void) {
-	if (!Physics.Enabled || !World.Blocks) return;
+	if (!Physics.Enabled || !World_HasBlocks()) return;
 
 	/*if ((tickCount % 5) == 0) {*/
 	Physics_TickLava();
@@ -20,22 +20,27 @@ int Builder_SidesLevel, Builder_EdgeLevel;
 /* Packs an index into the 18x18x18 chunk array. Coordinates range from -1 to 16. */
 #define Builder_PackChunk(xx, yy, zz) (((yy) + 1) * EXTCHUNK_SIZE_2 + ((zz) + 1) * EXTCHUNK_SIZE + ((xx) + 1))
 
-static BlockID* Builder_Chunk;
-static cc_uint8* Builder_Counts;
-static int* Builder_BitFlags;
-static int Builder_X, Builder_Y, Builder_Z;
-static BlockID Builder_Block;
-static int Builder_ChunkIndex;
-static cc_bool Builder_FullBright;
-static int Builder_ChunkEndX, Builder_ChunkEndZ;
+/* NOTE: State below is thread local, as chunk meshes may be built on several worker threads at once */
+static CC_THREADLOCAL BlockID* Builder_Chunk;
+static CC_THREADLOCAL cc_uint8* Builder_Counts;
+static CC_THREADLOCAL int* Builder_BitFlags;
+static CC_THREADLOCAL int Builder_X, Builder_Y, Builder_Z;
+static CC_THREADLOCAL BlockID Builder_Block;
+static CC_THREADLOCAL int Builder_ChunkIndex;
+static CC_THREADLOCAL cc_bool Builder_FullBright;
+static CC_THREADLOCAL int Builder_ChunkEndX, Builder_ChunkEndZ;
+/* Lighting engine used to calculate light colours of the chunk currently being built */
+static CC_THREADLOCAL struct _Lighting* Builder_Lighting;
+static CC_THREADLOCAL struct _DrawerData Builder_Drawer;
 static int Builder_Offsets[FACE_COUNT] = { -1,1, -EXTCHUNK_SIZE,EXTCHUNK_SIZE, -EXTCHUNK_SIZE_2,EXTCHUNK_SIZE_2 };
 
-static int (*Builder_StretchXLiquid)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
-static int (*Builder_StretchX)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
-static int (*Builder_StretchZ)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
-static void (*Builder_RenderBlock)(int countsIndex, int x, int y, int z);
-static void (*Builder_PrePrepareChunk)(void);
-static void (*Builder_PostPrepareChunk)(void);
+/* Active mesh builder is also per thread, as worker threads always use the normal mesh builder */
+static CC_THREADLOCAL int (*Builder_StretchXLiquid)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
+static CC_THREADLOCAL int (*Builder_StretchX)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
+static CC_THREADLOCAL int (*Builder_StretchZ)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
+static CC_THREADLOCAL void (*Builder_RenderBlock)(int countsIndex, int x, int y, int z);
+static CC_THREADLOCAL void (*Builder_PrePrepareChunk)(void);
+static CC_THREADLOCAL void (*Builder_PostPrepareChunk)(void);
 
 /* Contains state for vertices for a portion of a chunk mesh (vertices that are in a 1D atlas) */
 struct Builder1DPart {
@@ -49,8 +54,12 @@ struct Builder1DPart {
 
 /* Part builder data, for both normal and translucent parts.
 The first ATLAS1D_MAX_ATLASES parts are for normal parts, remainder are for translucent parts. */
-static struct Builder1DPart Builder_Parts[ATLAS1D_MAX_ATLASES * 2];
-static struct VertexTextured* Builder_Vertices;
+#define BUILDER_PARTS_COUNT (ATLAS1D_MAX_ATLASES * 2)
+static struct Builder1DPart mainThreadParts[BUILDER_PARTS_COUNT];
+/* NOTE: A pointer rather than thread local array, as static TLS is reserved from every thread's stack */
+/*  (worker threads point this at their own storage, see BuilderWorker_Run) */
+static CC_THREADLOCAL struct Builder1DPart* Builder_Parts = mainThreadParts;
+static CC_THREADLOCAL struct VertexTextured* Builder_Vertices;
 
 static int Builder1DPart_VerticesCount(struct Builder1DPart* part) {
 	int i, count = part->sCount;
@@ -261,6 +270,46 @@ for (yy = -1; yy < 17; ++yy) {\
 	}\
 }
 
+#ifdef CC_BUILD_CHUNKEDWORLD
+/* Reads each row of blocks along the X axis at once, which decodes a chunk's blocks much faster */
+static cc_bool ReadChunkRows(int x1, int y1, int z1, cc_bool* outAllAir) {
+	cc_bool allAir = true, allSolid = true;
+	int xStart = max(x1 - 1, 0), xEnd = min(x1 + 17, World.Width);
+	int cIndex, xx, yy, zz, y, z;
+	BlockID block;
+
+	for (yy = -1; yy < 17; ++yy) {
+		y = yy + y1;
+		if (y < 0 || y >= World.Height) { allSolid = false; continue; }
+
+		for (zz = -1; zz < 17; ++zz) {
+			z = zz + z1;
+			if (z < 0 || z >= World.Length) { allSolid = false; continue; }
+
+			cIndex = Builder_PackChunk(xStart - x1, yy, zz);
+			World_GetBlockRow(xStart, y, z, xEnd - xStart, &Builder_Chunk[cIndex]);
+
+			for (xx = xStart; xx < xEnd; xx++, cIndex++) {
+				block    = Builder_Chunk[cIndex];
+				allAir   = allAir   && Blocks.Draw[block] == DRAW_GAS;
+				allSolid = allSolid && Blocks.FullOpaque[block];
+			}
+		}
+	}
+
+	*outAllAir = allAir;
+	return allSolid;
+}
+
+static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+	return ReadChunkRows(x1, y1, z1, outAllAir);
+}
+
+static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+	ReadChunkRows(x1, y1, z1, outAllAir);
+	return false;
+}
+#else
 static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 	BlockRaw* blocks = World.Blocks;
 	BlockRaw* blocks2;
@@ -332,6 +381,7 @@ static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 	*outAllAir = allAir;
 	return false;
 }
+#endif
 
 static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
 	cc_bool hasNorm, hasTran;
@@ -359,6 +409,139 @@ static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
 	}
 }
 
+/*########################################################################################################################*
+*---------------------------------------------------Chunk connectivity----------------------------------------------------*
+*#########################################################################################################################*/
+/* Packs an index into the 16x16x16 connectivity arrays. Coordinates range from 0 to 15. */
+#define Conn_Pack(xx, yy, zz) (((yy) << 8) | ((zz) << 4) | (xx))
+
+static cc_uint16 Conn_FacePairs(int faces) {
+	cc_uint16 connections = 0;
+	int a, b;
+
+	for (a = 0; a < FACE_COUNT; a++) {
+		if (!(faces & (1 << a))) continue;
+
+		for (b = a + 1; b < FACE_COUNT; b++) {
+			if (faces & (1 << b)) connections |= CHUNK_CONNECTION(a, b);
+		}
+	}
+	return connections;
+}
+
+#define Conn_Visit(next) \
+if (!conn_seen[next]) { \
+	conn_seen[next] = true; \
+	if (!Blocks.FullOpaque[Builder_Chunk[Builder_PackChunk(xx, yy, zz) + (delta)]]) conn_queue[tail++] = next; \
+}
+
+/* Flood fills through the non-opaque blocks in the chunk, to calculate */
+/*  which pairs of chunk faces can be seen through from one another */
+static cc_uint16 Builder_CalcConnections(void) {
+#ifdef CC_BUILD_SATURN
+	static cc_uint16 conn_queue[CHUNK_SIZE_3];
+	static cc_uint8  conn_seen[CHUNK_SIZE_3];
+#else
+	/* NOTE: Kept on the stack instead of thread local, as static TLS is reserved from every thread's stack */
+	cc_uint16 conn_queue[CHUNK_SIZE_3];
+	cc_uint8  conn_seen[CHUNK_SIZE_3];
+#endif
+	cc_uint16 connections = 0;
+	int start, head, tail, cur, faces, delta;
+	int xx, yy, zz;
+	Mem_Set(conn_seen, 0, sizeof(conn_seen));
+
+	for (start = 0; start < CHUNK_SIZE_3; start++) {
+		if (conn_seen[start]) continue;
+		conn_seen[start] = true;
+
+		xx = start & CHUNK_MASK; zz = (start >> 4) & CHUNK_MASK; yy = start >> 8;
+		if (Blocks.FullOpaque[Builder_Chunk[Builder_PackChunk(xx, yy, zz)]]) continue;
+
+		head = 0; tail = 0; faces = 0;
+		conn_queue[tail++] = start;
+
+		while (head < tail) {
+			cur = conn_queue[head++];
+			xx  = cur & CHUNK_MASK; zz = (cur >> 4) & CHUNK_MASK; yy = cur >> 8;
+
+			if (xx == 0)          { faces |= 1 << FACE_XMIN; } else { delta = -1;               Conn_Visit(cur - 1); }
+			if (xx == CHUNK_MAX)  { faces |= 1 << FACE_XMAX; } else { delta =  1;               Conn_Visit(cur + 1); }
+			if (zz == 0)          { faces |= 1 << FACE_ZMIN; } else { delta = -EXTCHUNK_SIZE;   Conn_Visit(cur - CHUNK_SIZE); }
+			if (zz == CHUNK_MAX)  { faces |= 1 << FACE_ZMAX; } else { delta =  EXTCHUNK_SIZE;   Conn_Visit(cur + CHUNK_SIZE); }
+			if (yy == 0)          { faces |= 1 << FACE_YMIN; } else { delta = -EXTCHUNK_SIZE_2; Conn_Visit(cur - CHUNK_SIZE_2); }
+			if (yy == CHUNK_MAX)  { faces |= 1 << FACE_YMAX; } else { delta =  EXTCHUNK_SIZE_2; Conn_Visit(cur + CHUNK_SIZE_2); }
+		}
+
+		connections |= Conn_FacePairs(faces);
+		if (connections == CHUNK_CONNECTIONS_ALL) break;
+	}
+	return connections;
+}
+
+
+/* Reads the blocks of the chunk (and a one block border around it) into Builder_Chunk */
+static cc_bool ReadChunk(int x1, int y1, int z1, cc_bool* allAir) {
+	cc_bool onBorder = 
+		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
+		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
+
+	if (onBorder) {
+		/* less optimal case here */
+		Mem_Set(Builder_Chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
+		return ReadBorderChunkData(x1, y1, z1, allAir);
+	}
+	return ReadChunkData(x1, y1, z1, allAir);
+}
+
+/* Calculates which faces are visible, and returns total number of vertices in the chunk's mesh */
+static int CountChunk(int x1, int y1, int z1) {
+	Mem_Set(Builder_Counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
+	Builder_ChunkEndX = min(World.Width,  x1 + CHUNK_SIZE); 
+	Builder_ChunkEndZ = min(World.Length, z1 + CHUNK_SIZE);
+
+	PrepareChunk(x1, y1, z1);
+	return Builder_TotalVerticesCount();
+}
+
+/* Writes the vertices of all the visible faces in the chunk into Builder_Vertices */
+static void RenderChunk(int x1, int y1, int z1) {
+	int xMax = min(World.Width,  x1 + CHUNK_SIZE);
+	int yMax = min(World.Height, y1 + CHUNK_SIZE);
+	int zMax = min(World.Length, z1 + CHUNK_SIZE);
+	int cIndex, index;
+	int x, y, z, xx, yy, zz;
+
+	Builder_PostPrepareChunk();
+	for (y = y1, yy = 0; y < yMax; y++, yy++) {
+		for (z = z1, zz = 0; z < zMax; z++, zz++) {
+			cIndex = Builder_PackChunk(0, yy, zz);
+
+			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
+				Builder_Block = Builder_Chunk[cIndex];
+				if (Blocks.Draw[Builder_Block] == DRAW_GAS) continue;
+
+				index = Builder_PackCount(xx, yy, zz);
+				Builder_ChunkIndex = cIndex;
+				Builder_RenderBlock(index, x, y, z);
+			}
+		}
+	}
+}
+
+#ifdef CC_BUILD_GL11
+static void BuildChunkVbs(int x1, int y1, int z1) {
+	int i, cIndex = World_ChunkPack(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT);
+
+	for (i = 0; i < MapRenderer_1DUsedCount; i++) {
+		int curIdx = cIndex + i * World.ChunksCount;
+
+		BuildPartVbs(&MapRenderer_PartsNormal[curIdx]);
+		BuildPartVbs(&MapRenderer_PartsTranslucent[curIdx]);
+	}
+}
+#endif
+
 void Builder_MakeChunk(struct ChunkInfo* info) {
 #ifdef CC_BUILD_SATURN
 	/* The Saturn build only has 16 kb stack, not large enough */
@@ -371,42 +554,25 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 	int bitFlags[EXTCHUNK_SIZE_3];
 #endif
 
-	cc_bool allAir, allSolid, onBorder;
-	int xMax, yMax, zMax, totalVerts;
-	int cIndex, index;
-	int x, y, z, xx, yy, zz;
+	cc_bool allAir, allSolid;
+	int totalVerts;
 	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
 
 	Builder_Chunk  = chunk;
 	Builder_Counts = counts;
 	Builder_BitFlags = bitFlags;
+	Builder_Lighting = &Lighting;
 	Builder_PrePrepareChunk();
-	
-	onBorder = 
-		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
-		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
+	allSolid = ReadChunk(x1, y1, z1, &allAir);
 
-	if (onBorder) {
-		/* less optimal case here */
-		Mem_Set(chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
-		allSolid = ReadBorderChunkData(x1, y1, z1, &allAir);
-	} else {
-		allSolid = ReadChunkData(x1, y1, z1, &allAir);
-	}
-
-	info->allAir = allAir;
+	info->allAir      = allAir;
+	info->connections = allAir ? CHUNK_CONNECTIONS_ALL : 0;
 	if (allAir || allSolid) return;
-	Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
-
-	Mem_Set(counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
-	xMax = min(World.Width,  x1 + CHUNK_SIZE);
-	yMax = min(World.Height, y1 + CHUNK_SIZE);
-	zMax = min(World.Length, z1 + CHUNK_SIZE);
 
-	Builder_ChunkEndX = xMax; Builder_ChunkEndZ = zMax;
-	PrepareChunk(x1, y1, z1);
+	info->connections = Builder_CalcConnections();
+	Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
 
-	totalVerts = Builder_TotalVerticesCount();
+	totalVerts = CountChunk(x1, y1, z1);
 	if (!totalVerts) return;
 	
 	OutputChunkPartsMeta(x1, y1, z1, info);
@@ -424,33 +590,11 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 	Builder_Vertices = (struct VertexTextured*)Gfx_LockVb(0, 
 													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
 #endif
-	Builder_PostPrepareChunk();
 	/* now render the chunk */
-
-	for (y = y1, yy = 0; y < yMax; y++, yy++) {
-		for (z = z1, zz = 0; z < zMax; z++, zz++) {
-			cIndex = Builder_PackChunk(0, yy, zz);
-
-			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				Builder_Block = chunk[cIndex];
-				if (Blocks.Draw[Builder_Block] == DRAW_GAS) continue;
-
-				index = Builder_PackCount(xx, yy, zz);
-				Builder_ChunkIndex = cIndex;
-				Builder_RenderBlock(index, x, y, z);
-			}
-		}
-	}
+	RenderChunk(x1, y1, z1);
 
 #ifdef CC_BUILD_GL11
-	cIndex = World_ChunkPack(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT);
-
-	for (index = 0; index < MapRenderer_1DUsedCount; index++) {
-		int curIdx = cIndex + index * World.ChunksCount;
-
-		BuildPartVbs(&MapRenderer_PartsNormal[curIdx]);
-		BuildPartVbs(&MapRenderer_PartsTranslucent[curIdx]);
-	}
+	BuildChunkVbs(x1, y1, z1);
 #else
 	Gfx_UnlockVb(info->vb);
 #endif
@@ -467,7 +611,7 @@ static cc_bool Builder_OccludedLiquid(int chunkIndex) {
 }
 
 static void DefaultPrePrepateChunk(void) {
-	Mem_Set(Builder_Parts, 0, sizeof(Builder_Parts));
+	Mem_Set(Builder_Parts, 0, sizeof(mainThreadParts));
 }
 
 static void DefaultPostStretchChunk(void) {
@@ -481,7 +625,7 @@ static void DefaultPostStretchChunk(void) {
 	}
 }
 
-static RNGState spriteRng;
+static CC_THREADLOCAL RNGState spriteRng;
 static void Builder_DrawSprite(int x, int y, int z) {
 	struct Builder1DPart* part;
 	struct VertexTextured* v;
@@ -519,7 +663,7 @@ static void Builder_DrawSprite(int x, int y, int z) {
 	
 	bright = Blocks.Brightness[Builder_Block];
 	part   = &Builder_Parts[Atlas1D_Index(loc)];
-	color  = bright ? PACKEDCOL_WHITE : Lighting.Color_Sprite_Fast(x, y, z);
+	color  = bright ? PACKEDCOL_WHITE : Builder_Lighting->Color_Sprite_Fast(x, y, z);
 	Block_Tint(color, Builder_Block);
 
 	/* Draw Z axis */
@@ -562,18 +706,18 @@ static PackedCol Normal_LightColor(int x, int y, int z, Face face, BlockID block
 
 	switch (face) {
 	case FACE_XMIN:
-		return x < offset                ? Env.SunXSide : Lighting.Color_XSide_Fast(x - offset, y, z);
+		return x < offset                ? Env.SunXSide : Builder_Lighting->Color_XSide_Fast(x - offset, y, z);
 	case FACE_XMAX:
-		return x > (World.MaxX - offset) ? Env.SunXSide : Lighting.Color_XSide_Fast(x + offset, y, z);
+		return x > (World.MaxX - offset) ? Env.SunXSide : Builder_Lighting->Color_XSide_Fast(x + offset, y, z);
 	case FACE_ZMIN:
-		return z < offset                ? Env.SunZSide : Lighting.Color_ZSide_Fast(x, y, z - offset);
+		return z < offset                ? Env.SunZSide : Builder_Lighting->Color_ZSide_Fast(x, y, z - offset);
 	case FACE_ZMAX:
-		return z > (World.MaxZ - offset) ? Env.SunZSide : Lighting.Color_ZSide_Fast(x, y, z + offset);
+		return z > (World.MaxZ - offset) ? Env.SunZSide : Builder_Lighting->Color_ZSide_Fast(x, y, z + offset);
 
 	case FACE_YMIN:
-		return Lighting.Color_YMin_Fast(x, y - offset, z);		
+		return Builder_Lighting->Color_YMin_Fast(x, y - offset, z);		
 	case FACE_YMAX:
-		return Lighting.Color_YMax_Fast(x, y + offset, z);
+		return Builder_Lighting->Color_YMax_Fast(x, y + offset, z);
 	}
 	return 0; /* should never happen */
 }
@@ -677,15 +821,15 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 	baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
 	lightFlags = Blocks.LightOffset[Builder_Block];
 
-	Drawer.MinBB = Blocks.MinBB[Builder_Block]; Drawer.MinBB.y = 1.0f - Drawer.MinBB.y;
-	Drawer.MaxBB = Blocks.MaxBB[Builder_Block]; Drawer.MaxBB.y = 1.0f - Drawer.MaxBB.y;
+	Builder_Drawer.MinBB = Blocks.MinBB[Builder_Block]; Builder_Drawer.MinBB.y = 1.0f - Builder_Drawer.MinBB.y;
+	Builder_Drawer.MaxBB = Blocks.MaxBB[Builder_Block]; Builder_Drawer.MaxBB.y = 1.0f - Builder_Drawer.MaxBB.y;
 
 	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
-	Drawer.X1 = x + min.x; Drawer.Y1 = y + min.y; Drawer.Z1 = z + min.z;
-	Drawer.X2 = x + max.x; Drawer.Y2 = y + max.y; Drawer.Z2 = z + max.z;
+	Builder_Drawer.X1 = x + min.x; Builder_Drawer.Y1 = y + min.y; Builder_Drawer.Z1 = z + min.z;
+	Builder_Drawer.X2 = x + max.x; Builder_Drawer.Y2 = y + max.y; Builder_Drawer.Z2 = z + max.z;
 
-	Drawer.Tinted  = Blocks.Tinted[Builder_Block];
-	Drawer.TintCol = Blocks.FogCol[Builder_Block];
+	Builder_Drawer.Tinted  = Blocks.Tinted[Builder_Block];
+	Builder_Drawer.TintCol = Blocks.FogCol[Builder_Block];
 
 	if (count_XMin) {
 		loc    = Block_Tex(Builder_Block, FACE_XMIN);
@@ -693,8 +837,8 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
-			x >= offset ? Lighting.Color_XSide_Fast(x - offset, y, z) : Env.SunXSide;
-		Drawer_XMin(count_XMin, col, loc, &part->faces.vertices[FACE_XMIN]);
+			x >= offset ? Builder_Lighting->Color_XSide_Fast(x - offset, y, z) : Env.SunXSide;
+		DrawerState_XMin(&Builder_Drawer, count_XMin, col, loc, &part->faces.vertices[FACE_XMIN]);
 	}
 
 	if (count_XMax) {
@@ -703,8 +847,8 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
-			x <= (World.MaxX - offset) ? Lighting.Color_XSide_Fast(x + offset, y, z) : Env.SunXSide;
-		Drawer_XMax(count_XMax, col, loc, &part->faces.vertices[FACE_XMAX]);
+			x <= (World.MaxX - offset) ? Builder_Lighting->Color_XSide_Fast(x + offset, y, z) : Env.SunXSide;
+		DrawerState_XMax(&Builder_Drawer, count_XMax, col, loc, &part->faces.vertices[FACE_XMAX]);
 	}
 
 	if (count_ZMin) {
@@ -713,8 +857,8 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
-			z >= offset ? Lighting.Color_ZSide_Fast(x, y, z - offset) : Env.SunZSide;
-		Drawer_ZMin(count_ZMin, col, loc, &part->faces.vertices[FACE_ZMIN]);
+			z >= offset ? Builder_Lighting->Color_ZSide_Fast(x, y, z - offset) : Env.SunZSide;
+		DrawerState_ZMin(&Builder_Drawer, count_ZMin, col, loc, &part->faces.vertices[FACE_ZMIN]);
 	}
 
 	if (count_ZMax) {
@@ -723,8 +867,8 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
-			z <= (World.MaxZ - offset) ? Lighting.Color_ZSide_Fast(x, y, z + offset) : Env.SunZSide;
-		Drawer_ZMax(count_ZMax, col, loc, &part->faces.vertices[FACE_ZMAX]);
+			z <= (World.MaxZ - offset) ? Builder_Lighting->Color_ZSide_Fast(x, y, z + offset) : Env.SunZSide;
+		DrawerState_ZMax(&Builder_Drawer, count_ZMax, col, loc, &part->faces.vertices[FACE_ZMAX]);
 	}
 
 	if (count_YMin) {
@@ -732,8 +876,8 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 		offset = (lightFlags >> FACE_YMIN) & 1;
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
-		col = fullBright ? PACKEDCOL_WHITE : Lighting.Color_YMin_Fast(x, y - offset, z);
-		Drawer_YMin(count_YMin, col, loc, &part->faces.vertices[FACE_YMIN]);
+		col = fullBright ? PACKEDCOL_WHITE : Builder_Lighting->Color_YMin_Fast(x, y - offset, z);
+		DrawerState_YMin(&Builder_Drawer, count_YMin, col, loc, &part->faces.vertices[FACE_YMIN]);
 	}
 
 	if (count_YMax) {
@@ -741,8 +885,8 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 		offset = (lightFlags >> FACE_YMAX) & 1;
 		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
 
-		col = fullBright ? PACKEDCOL_WHITE : Lighting.Color_YMax_Fast(x, y + offset, z);
-		Drawer_YMax(count_YMax, col, loc, &part->faces.vertices[FACE_YMAX]);
+		col = fullBright ? PACKEDCOL_WHITE : Builder_Lighting->Color_YMax_Fast(x, y + offset, z);
+		DrawerState_YMax(&Builder_Drawer, count_YMax, col, loc, &part->faces.vertices[FACE_YMAX]);
 	}
 }
 
@@ -769,12 +913,12 @@ static void NormalBuilder_SetActive(void) {
 *-------------------------------------------------Advanced mesh builder---------------------------------------------------*
 *#########################################################################################################################*/
 #ifdef CC_BUILD_ADVLIGHTING
-static Vec3 adv_minBB, adv_maxBB;
-static int adv_initBitFlags, adv_baseOffset;
-static int* adv_bitFlags;
-static float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
-static PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
-static cc_bool adv_tinted;
+static CC_THREADLOCAL Vec3 adv_minBB, adv_maxBB;
+static CC_THREADLOCAL int adv_initBitFlags, adv_baseOffset;
+static CC_THREADLOCAL int* adv_bitFlags;
+static CC_THREADLOCAL float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
+static CC_THREADLOCAL PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
+static CC_THREADLOCAL cc_bool adv_tinted;
 
 enum ADV_MASK {
 	/* z-1 cube points */
@@ -818,14 +962,14 @@ static int Adv_Lit(int x, int y, int z, int cIndex) {
 
 	/* Use fact Light(Y.YMin) == Light((Y-1).YMax) */
 	offset = (lightFlags >> LIGHT_FLAG_SHADES_FROM_BELOW) & 1;
-	flags |= Lighting.IsLit_Fast(x, y - offset, z) ? LIT_M1 : 0;
+	flags |= Builder_Lighting->IsLit_Fast(x, y - offset, z) ? LIT_M1 : 0;
 
 	/* Light is same for all the horizontal faces */
-	flags |= Lighting.IsLit_Fast(x, y, z) ? LIT_CC : 0;
+	flags |= Builder_Lighting->IsLit_Fast(x, y, z) ? LIT_CC : 0;
 
 	/* Use fact Light((Y+1).YMin) == Light(Y.YMax) */
 	offset = (lightFlags >> LIGHT_FLAG_SHADES_FROM_BELOW) & 1;
-	flags |= Lighting.IsLit_Fast(x, (y + 1) - offset, z) ? LIT_P1 : 0;
+	flags |= Builder_Lighting->IsLit_Fast(x, (y + 1) - offset, z) ? LIT_P1 : 0;
 
 	/* If a block is fullbright, it should also look as if that spot is lit */
 	if (Blocks.Brightness[Builder_Chunk[cIndex - 324]]) flags |= LIT_M1;
@@ -1318,9 +1462,9 @@ static PackedCol Modern_GetColorX(PackedCol orig, int x, int y, int z, int oY, i
 	cc_bool zOccluded =  Modern_IsOccluded(x, y     , z + oZ);
 	cc_bool xzOccluded = Modern_IsOccluded(x, y + oY, z + oZ);
 
-	PackedCol CoX = xOccluded ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color_XSide_Fast(x, y + oY, z     );
-	PackedCol CoZ = zOccluded ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color_XSide_Fast(x, y     , z + oZ);
-	PackedCol CoXoZ = (xzOccluded || (xOccluded && zOccluded)) ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color_XSide_Fast(x, y + oY, z + oZ);
+	PackedCol CoX = xOccluded ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color_XSide_Fast(x, y + oY, z     );
+	PackedCol CoZ = zOccluded ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color_XSide_Fast(x, y     , z + oZ);
+	PackedCol CoXoZ = (xzOccluded || (xOccluded && zOccluded)) ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color_XSide_Fast(x, y + oY, z + oZ);
 
 	PackedCol ab = AVERAGE(CoX, CoZ);
 	PackedCol cd = AVERAGE(CoXoZ, orig);
@@ -1337,7 +1481,7 @@ static void Modern_DrawXMin(int count, int x, int y, int z) {
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_XMIN) & 1;
-	PackedCol orig = Lighting.Color_XSide_Fast(x-offset, y, z);
+	PackedCol orig = Builder_Lighting->Color_XSide_Fast(x-offset, y, z);
 	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorX(orig, x-offset, y, z, -1, -1);
 	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorX(orig, x-offset, y, z, 1, -1);
 	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorX(orig, x-offset, y, z, 1, 1);
@@ -1370,7 +1514,7 @@ static void Modern_DrawXMax(int count, int x, int y, int z) {
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_XMAX) & 1;
-	PackedCol orig = Lighting.Color_XSide_Fast(x+offset, y, z);
+	PackedCol orig = Builder_Lighting->Color_XSide_Fast(x+offset, y, z);
 	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorX(orig, x+offset, y, z, -1, -1);
 	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorX(orig, x+offset, y, z, 1, -1);
 	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorX(orig, x+offset, y, z, 1, 1);
@@ -1397,9 +1541,9 @@ static PackedCol Modern_GetColorZ(PackedCol orig, int x, int y, int z, int oX, i
 	cc_bool zOccluded  = Modern_IsOccluded(x,      y + oY, z);
 	cc_bool xzOccluded = Modern_IsOccluded(x + oX, y + oY, z);
 
-	PackedCol CoX   =                                xOccluded ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color_ZSide_Fast(x + oX, y     , z);
-	PackedCol CoZ   =                                zOccluded ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color_ZSide_Fast(x     , y + oY, z);
-	PackedCol CoXoZ = (xzOccluded || (xOccluded && zOccluded)) ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color_ZSide_Fast(x + oX, y + oY, z);
+	PackedCol CoX   =                                xOccluded ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color_ZSide_Fast(x + oX, y     , z);
+	PackedCol CoZ   =                                zOccluded ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color_ZSide_Fast(x     , y + oY, z);
+	PackedCol CoXoZ = (xzOccluded || (xOccluded && zOccluded)) ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color_ZSide_Fast(x + oX, y + oY, z);
 
 	PackedCol ab = AVERAGE(CoX, CoZ);
 	PackedCol cd = AVERAGE(CoXoZ, orig);
@@ -1416,7 +1560,7 @@ static void Modern_DrawZMin(int count, int x, int y, int z) {
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_ZMIN) & 1;
-	PackedCol orig = Lighting.Color_ZSide_Fast(x, y, z-offset);
+	PackedCol orig = Builder_Lighting->Color_ZSide_Fast(x, y, z-offset);
 	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, -1, -1);
 	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, 1, -1);
 	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, 1, 1);
@@ -1449,7 +1593,7 @@ static void Modern_DrawZMax(int count, int x, int y, int z) {
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_ZMAX) & 1;
-	PackedCol orig = Lighting.Color_ZSide_Fast(x, y, z+offset);
+	PackedCol orig = Builder_Lighting->Color_ZSide_Fast(x, y, z+offset);
 	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, -1, -1);
 	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, 1, -1);
 	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, 1, 1);
@@ -1476,9 +1620,9 @@ static PackedCol Modern_GetColorYMin(PackedCol orig, int x, int y, int z, int oX
 	cc_bool zOccluded  = Modern_IsOccluded(x,      y, z + oZ);
 	cc_bool xzOccluded = Modern_IsOccluded(x + oX, y, z + oZ);
 
-	PackedCol CoX   =                                xOccluded ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color_YMin_Fast(x + oX, y, z     );
-	PackedCol CoZ   =                                zOccluded ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color_YMin_Fast(x     , y, z + oZ);
-	PackedCol CoXoZ = (xzOccluded || (xOccluded && zOccluded)) ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color_YMin_Fast(x + oX, y, z + oZ);
+	PackedCol CoX   =                                xOccluded ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color_YMin_Fast(x + oX, y, z     );
+	PackedCol CoZ   =                                zOccluded ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color_YMin_Fast(x     , y, z + oZ);
+	PackedCol CoXoZ = (xzOccluded || (xOccluded && zOccluded)) ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color_YMin_Fast(x + oX, y, z + oZ);
 
 	PackedCol ab = AVERAGE(CoX, CoZ);
 	PackedCol cd = AVERAGE(CoXoZ, orig);
@@ -1495,7 +1639,7 @@ static void Modern_DrawYMin(int count, int x, int y, int z) {
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_YMIN) & 1;
-	PackedCol orig = Lighting.Color_YMin_Fast(x, y-offset, z);
+	PackedCol orig = Builder_Lighting->Color_YMin_Fast(x, y-offset, z);
 	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z, -1, -1);
 	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z,  1, -1);
 	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z,  1,  1);
@@ -1522,9 +1666,9 @@ static PackedCol Modern_GetColorYMax(PackedCol orig, int x, int y, int z, int oX
 	cc_bool zOccluded  = Modern_IsOccluded(x,      y, z + oZ);
 	cc_bool xzOccluded = Modern_IsOccluded(x + oX, y, z + oZ);
 
-	PackedCol CoX   =                                xOccluded ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color(x + oX, y, z     );
-	PackedCol CoZ   =                                zOccluded ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color(x     , y, z + oZ);
-	PackedCol CoXoZ = (xzOccluded || (xOccluded && zOccluded)) ? PackedCol_Scale(orig, FANCY_AO) : Lighting.Color(x + oX, y, z + oZ);
+	PackedCol CoX   =                                xOccluded ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color(x + oX, y, z     );
+	PackedCol CoZ   =                                zOccluded ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color(x     , y, z + oZ);
+	PackedCol CoXoZ = (xzOccluded || (xOccluded && zOccluded)) ? PackedCol_Scale(orig, FANCY_AO) : Builder_Lighting->Color(x + oX, y, z + oZ);
 
 	PackedCol ab = AVERAGE(CoX, CoZ);
 	PackedCol cd = AVERAGE(CoXoZ, orig);
@@ -1541,7 +1685,7 @@ static void Modern_DrawYMax(int count, int x, int y, int z) {
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_YMAX) & 1;
-	PackedCol orig = Lighting.Color(x, y+offset, z);
+	PackedCol orig = Builder_Lighting->Color(x, y+offset, z);
 	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z, -1, -1);
 	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z,  1, -1);
 	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z,  1,  1);
@@ -1619,6 +1763,320 @@ static void ModernBuilder_SetActive(void) {
 static void ModernBuilder_SetActive(void) { NormalBuilder_SetActive(); }
 #endif
 
+/*########################################################################################################################*
+*-------------------------------------------------Threaded mesh builder---------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_THREADEDBUILDER
+#define BUILDER_MAX_WORKERS 16
+#define BUILDER_JOBS_PER_WORKER 4
+
+/* Snapshot of everything needed to build the mesh of a chunk, so that workers never access the world */
+struct BuilderJob {
+	struct ChunkInfo* info;
+	struct BuilderJob* next;
+	int generation, x1, y1, z1;
+	/* Total number of vertices in the mesh, or -1 if allocating vertices failed */
+	int totalVerts;
+	cc_bool allAir;
+	cc_uint16 connections;
+	struct VertexTextured* vertices;
+	cc_int16 heights[EXTCHUNK_SIZE * EXTCHUNK_SIZE];
+	struct Builder1DPart parts[ATLAS1D_MAX_ATLASES * 2];
+	BlockID chunk[EXTCHUNK_SIZE_3];
+};
+
+static void* builder_threads[BUILDER_MAX_WORKERS];
+static int builder_workers, builder_generation;
+static void* builder_mutex;
+static void* builder_signal;
+static volatile cc_bool builder_stopping;
+
+static struct BuilderJob* builder_jobs;
+static struct BuilderJob* curJob;
+/* NOTE: Free jobs list is only accessed from the main thread */
+static struct BuilderJob* freeJobs;
+/* NOTE: Pending and finished jobs lists are protected by builder_mutex */
+static struct BuilderJob* pendingHead;
+static struct BuilderJob* pendingTail;
+static struct BuilderJob* finishedHead;
+static struct BuilderJob* finishedTail;
+
+/* Classic lighting, but using the heightmap snapshot of the chunk currently being built */
+static struct _Lighting snapshotLighting;
+static CC_THREADLOCAL cc_int16* snapshot_heights;
+static CC_THREADLOCAL int snapshot_x, snapshot_z;
+#define Snapshot_Height(x, z) snapshot_heights[((z) - snapshot_z) * EXTCHUNK_SIZE + ((x) - snapshot_x)]
+
+static cc_bool Snapshot_IsLit_Fast(int x, int y, int z) {
+	return y > Snapshot_Height(x, z);
+}
+
+static PackedCol Snapshot_Color_YMax_Fast(int x, int y, int z) {
+	return y > Snapshot_Height(x, z) ? Env.SunCol : Env.ShadowCol;
+}
+
+static PackedCol Snapshot_Color_YMin_Fast(int x, int y, int z) {
+	return y > Snapshot_Height(x, z) ? Env.SunYMin : Env.ShadowYMin;
+}
+
+static PackedCol Snapshot_Color_XSide_Fast(int x, int y, int z) {
+	return y > Snapshot_Height(x, z) ? Env.SunXSide : Env.ShadowXSide;
+}
+
+static PackedCol Snapshot_Color_ZSide_Fast(int x, int y, int z) {
+	return y > Snapshot_Height(x, z) ? Env.SunZSide : Env.ShadowZSide;
+}
+
+static void BuilderJobs_Append(struct BuilderJob** head, struct BuilderJob** tail, struct BuilderJob* job) {
+	job->next = NULL;
+	if (*tail) { (*tail)->next = job; } else { *head = job; }
+	*tail = job;
+}
+
+static struct BuilderJob* BuilderJobs_Take(struct BuilderJob** head, struct BuilderJob** tail) {
+	struct BuilderJob* job = *head;
+	if (!job) return NULL;
+
+	*head = job->next;
+	if (!job->next) *tail = NULL;
+	return job;
+}
+
+static void BuilderJob_Free(struct BuilderJob* job) {
+	Mem_Free(job->vertices);
+	job->vertices = NULL;
+	job->next = freeJobs;
+	freeJobs  = job;
+}
+
+static void BuilderJob_Build(struct BuilderJob* job) {
+	int x1 = job->x1, y1 = job->y1, z1 = job->z1;
+	Builder_Chunk    = job->chunk;
+	snapshot_heights = job->heights;
+	snapshot_x = x1 - 1; snapshot_z = z1 - 1;
+
+	job->connections = Builder_CalcConnections();
+	Builder_PrePrepareChunk();
+	job->totalVerts = CountChunk(x1, y1, z1);
+	if (!job->totalVerts) return;
+	/* Part counts are turned into vertex pointers when rendering, so need to be saved beforehand */
+	Mem_Copy(job->parts, Builder_Parts, sizeof(mainThreadParts));
+
+	/* add an extra element to fix crashing on some GPUs */
+	job->vertices = (struct VertexTextured*)Mem_TryAlloc(job->totalVerts + 1, sizeof(struct VertexTextured));
+	if (!job->vertices) { job->totalVerts = -1; return; }
+
+	Builder_Vertices = job->vertices;
+	RenderChunk(x1, y1, z1);
+}
+
+static void BuilderWorker_Run(void) {
+	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT];
+	struct Builder1DPart parts[BUILDER_PARTS_COUNT];
+	int bitFlags[1]; /* only used by advanced lighting mesh builder */
+	struct BuilderJob* job;
+	cc_bool morePending;
+
+	Builder_Counts   = counts;
+	Builder_Parts    = parts;
+	Builder_BitFlags = bitFlags;
+	Builder_Lighting = &snapshotLighting;
+	NormalBuilder_SetActive();
+
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		job = BuilderJobs_Take(&pendingHead, &pendingTail);
+		morePending = pendingHead != NULL;
+		Mutex_Unlock(builder_mutex);
+
+		/* Signals may have been coalesced, so make sure another worker wakes up too */
+		if (builder_stopping) { Waitable_Signal(builder_signal); return; }
+		if (morePending) Waitable_Signal(builder_signal);
+		if (!job) { Waitable_Wait(builder_signal); continue; }
+
+		BuilderJob_Build(job);
+		Mutex_Lock(builder_mutex);
+		BuilderJobs_Append(&finishedHead, &finishedTail, job);
+		Mutex_Unlock(builder_mutex);
+	}
+}
+
+cc_bool Builder_IsThreaded(void) {
+	return builder_workers && Lighting_Mode == LIGHTING_MODE_CLASSIC && !Builder_SmoothLighting;
+}
+
+cc_bool Builder_QueueChunk(struct ChunkInfo* info) {
+	struct BuilderJob* job = freeJobs;
+	cc_bool allAir, allSolid;
+	int x1, y1, z1, x, z;
+	int xMin, xMax, zMin, zMax;
+	if (!job) return false;
+
+	freeJobs = job->next;
+	x1 = info->centreX - 8; y1 = info->centreY - 8; z1 = info->centreZ - 8;
+	job->info = info; job->generation = builder_generation;
+	job->x1   = x1;   job->y1 = y1;   job->z1 = z1;
+	job->totalVerts = 0;
+
+	Builder_Chunk = job->chunk;
+	allSolid      = ReadChunk(x1, y1, z1, &allAir);
+	job->allAir   = allAir;
+	job->connections = allAir ? CHUNK_CONNECTIONS_ALL : 0;
+
+	if (!allAir && !allSolid) {
+		Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
+		xMin = max(x1 - 1, 0); xMax = min(World.Width,  x1 + CHUNK_SIZE + 1);
+		zMin = max(z1 - 1, 0); zMax = min(World.Length, z1 + CHUNK_SIZE + 1);
+
+		for (z = zMin; z < zMax; z++) {
+			for (x = xMin; x < xMax; x++) {
+				job->heights[(z - (z1 - 1)) * EXTCHUNK_SIZE + (x - (x1 - 1))] = ClassicLighting_GetLightHeight(x, z);
+			}
+		}
+	}
+
+	Mutex_Lock(builder_mutex);
+	{
+		if (allAir || allSolid) {
+			/* Nothing to build, so skip the worker threads entirely */
+			BuilderJobs_Append(&finishedHead, &finishedTail, job);
+		} else {
+			BuilderJobs_Append(&pendingHead,  &pendingTail,  job);
+		}
+	}
+	Mutex_Unlock(builder_mutex);
+
+	if (!allAir && !allSolid) Waitable_Signal(builder_signal);
+	return true;
+}
+
+struct ChunkInfo* Builder_NextFinishedChunk(void) {
+	struct BuilderJob* job;
+	if (!builder_workers) return NULL;
+
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		job = BuilderJobs_Take(&finishedHead, &finishedTail);
+		Mutex_Unlock(builder_mutex);
+
+		if (!job) return NULL;
+		/* Chunks may have been freed since the job was queued */
+		if (job->generation == builder_generation) break;
+		BuilderJob_Free(job);
+	}
+
+	curJob = job;
+	return job->info;
+}
+
+void Builder_OutputFinishedChunk(void) {
+	struct BuilderJob* job  = curJob;
+	struct ChunkInfo* info  = job->info;
+	struct VertexTextured* vertices;
+	int totalVerts = job->totalVerts;
+
+	info->allAir      = job->allAir;
+	info->connections = job->connections;
+	curJob = NULL;
+
+	if (totalVerts < 0) {
+		/* Out of memory, so try building again later */
+		info->pendingDelete = true;
+	} else if (totalVerts) {
+		Mem_Copy(Builder_Parts, job->parts, sizeof(mainThreadParts));
+		OutputChunkPartsMeta(job->x1, job->y1, job->z1, info);
+		Builder_Vertices = job->vertices;
+
+#ifdef CC_BUILD_GL11
+		BuildChunkVbs(job->x1, job->y1, job->z1);
+#else
+		vertices = (struct VertexTextured*)Gfx_RecreateAndLockVb(&info->vb,
+												VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+		Mem_Copy(vertices, job->vertices, (totalVerts + 1) * SIZEOF_VERTEX_TEXTURED);
+		Gfx_UnlockVb(info->vb);
+#endif
+	}
+	BuilderJob_Free(job);
+}
+
+void Builder_CancelChunks(void) {
+	struct BuilderJob* job;
+	if (!builder_workers) return;
+
+	Mutex_Lock(builder_mutex);
+	{
+		while ((job = BuilderJobs_Take(&pendingHead, &pendingTail))) {
+			BuilderJob_Free(job);
+		}
+	}
+	Mutex_Unlock(builder_mutex);
+	/* Jobs currently being built or already finished are discarded once they are retrieved */
+	builder_generation++;
+}
+
+static void ThreadedBuilder_Init(void) {
+	int i, jobsCount;
+	builder_workers = Options_GetInt(OPT_BUILDER_THREADS, 0, BUILDER_MAX_WORKERS, 
+									min(Thread_ProcessorCount() - 1, BUILDER_MAX_WORKERS));
+	if (!builder_workers) return;
+
+	jobsCount    = builder_workers * BUILDER_JOBS_PER_WORKER;
+	builder_jobs = (struct BuilderJob*)Mem_TryAlloc(jobsCount, sizeof(struct BuilderJob));
+	if (!builder_jobs) { builder_workers = 0; return; }
+
+	for (i = 0; i < jobsCount; i++) {
+		builder_jobs[i].vertices = NULL;
+		BuilderJob_Free(&builder_jobs[i]);
+	}
+
+	snapshotLighting.IsLit_Fast        = Snapshot_IsLit_Fast;
+	snapshotLighting.Color_Sprite_Fast = Snapshot_Color_YMax_Fast;
+	snapshotLighting.Color_YMax_Fast   = Snapshot_Color_YMax_Fast;
+	snapshotLighting.Color_YMin_Fast   = Snapshot_Color_YMin_Fast;
+	snapshotLighting.Color_XSide_Fast  = Snapshot_Color_XSide_Fast;
+	snapshotLighting.Color_ZSide_Fast  = Snapshot_Color_ZSide_Fast;
+
+	builder_mutex  = Mutex_Create();
+	builder_signal = Waitable_Create();
+	for (i = 0; i < builder_workers; i++) {
+		Thread_Run(&builder_threads[i], BuilderWorker_Run, 256 * 1024, "Chunk builder");
+	}
+}
+
+static void ThreadedBuilder_Free(void) {
+	int i;
+	if (!builder_workers) return;
+	Builder_CancelChunks();
+
+	builder_stopping = true;
+	Waitable_Signal(builder_signal);
+	for (i = 0; i < builder_workers; i++) {
+		Thread_Join(builder_threads[i]);
+	}
+
+	for (i = 0; i < builder_workers * BUILDER_JOBS_PER_WORKER; i++) {
+		Mem_Free(builder_jobs[i].vertices);
+	}
+	Mem_Free(builder_jobs);
+	Mutex_Free(builder_mutex);
+	Waitable_Free(builder_signal);
+
+	builder_workers = 0;
+	builder_jobs    = NULL;
+	freeJobs = pendingHead = pendingTail = finishedHead = finishedTail = NULL;
+}
+#else
+cc_bool Builder_IsThreaded(void) { return false; }
+cc_bool Builder_QueueChunk(struct ChunkInfo* info) { return false; }
+struct ChunkInfo* Builder_NextFinishedChunk(void)  { return NULL; }
+void Builder_OutputFinishedChunk(void) { }
+void Builder_CancelChunks(void) { }
+
+static void ThreadedBuilder_Init(void) { }
+static void ThreadedBuilder_Free(void) { }
+#endif
+
+
 /*########################################################################################################################*
 *---------------------------------------------------Builder interface-----------------------------------------------------*
 *#########################################################################################################################*/
@@ -1646,6 +2104,11 @@ static void OnInit(void) {
 
 	if (!Game_ClassicMode) Builder_SmoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
 	Builder_ApplyActive();
+	ThreadedBuilder_Init();
+}
+
+static void OnFree(void) {
+	ThreadedBuilder_Free();
 }
 
 static void OnNewMapLoaded(void) {
@@ -1655,7 +2118,7 @@ static void OnNewMapLoaded(void) {
 
 struct IGameComponent Builder_Component = {
 	OnInit, /* Init */
-	NULL, /* Free */
+	OnFree, /* Free */
 	NULL, /* Reset */
 	NULL, /* OnNewMap */
 	OnNewMapLoaded /* OnNewMapLoaded */
@@ -20,5 +20,20 @@ extern cc_bool Builder_SmoothLighting;
 /* Builds the mesh of vertices for the given chunk. */
 void Builder_MakeChunk(struct ChunkInfo* info);
 
+/* Whether chunk meshes are currently built on background worker threads. */
+/* NOTE: Only the normal mesh builder with classic lighting supports this */
+cc_bool Builder_IsThreaded(void);
+/* Queues the given chunk to have its mesh built on a worker thread. */
+/* Returns false if too many chunks are already queued. */
+cc_bool Builder_QueueChunk(struct ChunkInfo* info);
+/* Returns a chunk whose mesh has finished being built, or NULL if there are none. */
+/* NOTE: Builder_OutputFinishedChunk must be called after this returns a chunk */
+struct ChunkInfo* Builder_NextFinishedChunk(void);
+/* Uploads the mesh of the chunk last returned by Builder_NextFinishedChunk to the GPU. */
+/* NOTE: Any previous mesh of the chunk must have been deleted beforehand */
+void Builder_OutputFinishedChunk(void);
+/* Discards all chunks queued or being built on worker threads. */
+void Builder_CancelChunks(void);
+
 void Builder_ApplyActive(void);
 #endif
@@ -17,6 +17,8 @@
 #include "TexturePack.h"
 #include "Options.h"
 #include "Drawer2D.h"
+#include "Lighting.h"
+#include "Profiler.h"
 
 #define COMMANDS_PREFIX "/client"
 #define COMMANDS_PREFIX_SPACE "/client "
@@ -285,6 +287,82 @@ static struct ChatCommand MotdCommand = {
 	}
 };
 
+static void LightMemCommand_Execute(const cc_string* args, int argsCount) {
+	int dense, packed, uniform, kb;
+	FancyLighting_GetMemoryUsage(&dense, &packed, &uniform, &kb);
+
+	if (!dense && !packed && !uniform) {
+		Chat_AddRaw("&e/client: &cFancy lighting is not currently active."); return;
+	}
+	kb /= 1024;
+	Chat_Add4("&eLight data: &f%i &echunks per-cell, &f%i &echunks packed, &f%i &echunks uniform (&f%i &eKB)", 
+				&dense, &packed, &uniform, &kb);
+}
+
+static struct ChatCommand LightMemCommand = {
+	"LightMem", LightMemCommand_Execute,
+	COMMAND_FLAG_UNSPLIT_ARGS,
+	{
+		"&a/client lightmem",
+		"&eDisplays how much memory fancy lighting is using for the current map.",
+	}
+};
+
+static void NetStatsCommand_Execute(const cc_string* args, int argsCount) {
+	struct NetSendStats stats;
+	if (Server.IsSinglePlayer) {
+		Chat_AddRaw("&e/client: &cThis command can only be used in multiplayer."); return;
+	}
+
+	Server_GetSendStats(&stats);
+	Chat_Add3("&eSent: &f%i &ebytes queued, &f%i &ebytes pending (max &f%i&e)",
+				&stats.BytesQueued, &stats.BytesPending, &stats.MaxPending);
+	Chat_Add3("&eFlushes: &f%i&e, last took &f%i &ems (max &f%i &ems)",
+				&stats.Flushes, &stats.LastFlushMS, &stats.MaxFlushMS);
+}
+
+static struct ChatCommand NetStatsCommand = {
+	"NetStats", NetStatsCommand_Execute,
+	COMMAND_FLAG_UNSPLIT_ARGS,
+	{
+		"&a/client netstats",
+		"&eDisplays statistics about data queued for sending to the server.",
+	}
+};
+
+static void ProfileCommand_Execute(const cc_string* args, int argsCount) {
+	static const cc_string defPath = String_FromConst("profile.csv");
+	const cc_string* path;
+	cc_result res;
+
+	if (!argsCount) {
+		Profiler_SetEnabled(!Profiler_Enabled);
+		Chat_AddRaw(Profiler_Enabled ? "&eFrame profiler: &aON" : "&eFrame profiler: &cOFF");
+	} else if (String_CaselessEqualsConst(&args[0], "dump")) {
+		if (!Profiler_Enabled) {
+			Chat_AddRaw("&e/client profile: &cThe profiler is not enabled."); return;
+		}
+
+		path = argsCount > 1 ? &args[1] : &defPath;
+		res  = Profiler_Dump(path);
+		if (res) { Logger_SysWarn2(res, "writing profile to", path); return; }
+		Chat_Add1("&eSaved frame timings to &f%s", path);
+	} else {
+		Chat_AddRaw("&e/client profile: &cUnrecognised argument");
+	}
+}
+
+static struct ChatCommand ProfileCommand = {
+	"Profile", ProfileCommand_Execute,
+	0,
+	{
+		"&a/client profile",
+		"&eToggles showing how long each stage of a frame takes.",
+		"&a/client profile dump [file]",
+		"&eSaves the timings of the most recent frames to a CSV file.",
+	}
+};
+
 /*########################################################################################################################*
 *-------------------------------------------------------DrawOpCommand-----------------------------------------------------*
 *#########################################################################################################################*/
@@ -727,6 +805,9 @@ static void OnInit(void) {
 	Commands_Register(&TeleportCommand);
 	Commands_Register(&ClearDeniedCommand);
 	Commands_Register(&MotdCommand);
+	Commands_Register(&LightMemCommand);
+	Commands_Register(&NetStatsCommand);
+	Commands_Register(&ProfileCommand);
 	Commands_Register(&BlockEditCommand);
 	Commands_Register(&CuboidCommand);
 	Commands_Register(&ReplaceCommand);
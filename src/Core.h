@@ -23,6 +23,7 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 	
 	#define CC_INLINE inline
 	#define CC_NOINLINE __declspec(noinline)
+	#define CC_THREADLOCAL __declspec(thread)
 	#ifndef CC_API
 	#define CC_API __declspec(dllexport, noinline)
 	#define CC_VAR __declspec(dllexport)
@@ -58,6 +59,10 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 	
 	#define CC_INLINE inline
 	#define CC_NOINLINE __attribute__((noinline))
+	/* old Apple GCC versions don't support __thread */
+	#if (__GNUC__ >= 4 && !defined __APPLE__) || defined __clang__
+	#define CC_THREADLOCAL __thread
+	#endif
 	#ifndef CC_API
 	#ifdef _WIN32
 	#define CC_API __attribute__((dllexport, noinline))
@@ -428,11 +433,21 @@ typedef cc_uint8  cc_bool;
 #undef CC_BUILD_PLUGINS
 #endif
 
+/* Building chunk meshes on worker threads relies on thread local builder state */
+#if defined CC_THREADLOCAL && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_COOPTHREADED
+#define CC_BUILD_THREADEDBUILDER
+#else
+#undef  CC_THREADLOCAL
+#define CC_THREADLOCAL
+#endif
+
 #ifndef CC_BUILD_LOWMEM
 #define EXTENDED_BLOCKS
 #define CUSTOM_MODELS
 #endif
 #define EXTENDED_TEXTURES
+/* Define CC_BUILD_CHUNKEDWORLD (e.g. via command line) to store the world's blocks in */
+/*  palette compressed chunks instead of flat arrays, trading some speed for memory usage */
 
 #ifdef EXTENDED_BLOCKS
 typedef cc_uint16 BlockID;
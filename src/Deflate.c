@@ -151,8 +151,6 @@ enum INFLATE_STATE_ {
 #define Inflate_AlignBits(state) cc_uint32 alignSkip = state->NumBits & 7; Inflate_ConsumeBits(state, alignSkip);
 /* Ensures there are 'bitsCount' bits, or returns if not */
 #define Inflate_EnsureBits(state, bitsCount) while (state->NumBits < bitsCount) { if (!state->AvailIn) return; Inflate_GetByte(state); }
-/* Ensures there are 'bitsCount' bits */
-#define Inflate_UNSAFE_EnsureBits(state, bitsCount) while (state->NumBits < bitsCount) { Inflate_GetByte(state); }
 /* Peeks then consumes given bits */
 #define Inflate_ReadBits(state, bitsCount) Inflate_PeekBits(state, bitsCount); Inflate_ConsumeBits(state, bitsCount);
 /* Sets to given result and sets state to DONE */
@@ -162,9 +160,11 @@ enum INFLATE_STATE_ {
 #define Inflate_NextBlockState(state) (state->LastBlock ? INFLATE_STATE_DONE : INFLATE_STATE_HEADER)
 /* Goes to the next state, after having finished reading a compressed entry */
 #define Inflate_NextCompressState(state) ((state->AvailIn >= INFLATE_FASTINF_IN && state->AvailOut >= INFLATE_FASTINF_OUT) ? INFLATE_STATE_FASTCOMPRESSED : INFLATE_STATE_COMPRESSED_LIT)
-/* The maximum amount of bytes that can be output is 258 */
-#define INFLATE_FASTINF_OUT 258
-/* The most input bytes required for huffman codes and extra data is 16 + 5 + 16 + 13 bits. Add 3 extra bytes to account for putting data into the bit buffer. */
+/* The maximum amount of bytes that can be output is 258. Matches are copied 16 bytes at a time though, */
+/*  so up to 15 bytes past the end of a match may also be overwritten with garbage. */
+#define INFLATE_FASTINF_OUT (258 + 16)
+/* The bit buffer is refilled once per symbol by reading at most 8 bytes, */
+/*  which is enough to always hold the 15 + 5 + 15 + 13 bits for a literal/length and distance */
 #define INFLATE_FASTINF_IN 10
 
 static cc_uint32 Huffman_ReverseBits(cc_uint32 n, cc_uint8 bits) {
@@ -296,44 +296,24 @@ static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table
 	return -1;
 }
 
-/* Inline the common <= 9 bits case */
-#define Huffman_UNSAFE_Decode(state, table, result) \
-{\
-	Inflate_UNSAFE_EnsureBits(state, INFLATE_MAX_BITS);\
-	packed = table.fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];\
-	if (packed >= 0) {\
-		consumedBits = packed >> INFLATE_FAST_BITS;\
-		Inflate_ConsumeBits(state, consumedBits);\
-		result = packed & 0x1FF;\
-	} else {\
-		result = Huffman_UNSAFE_Decode_Slow(state, &table);\
-	}\
-}
-
-static int Huffman_UNSAFE_Decode_Slow(struct InflateState* state, struct HuffmanTable* table) {
-	cc_uint32 i, j, codeword;
+/* Decodes a codeword longer than INFLATE_FAST_BITS from the given bits, returning -1 if it is invalid */
+static int Huffman_DecodeSlow(struct HuffmanTable* table, cc_uint64 bits, cc_uint32* len) {
+	cc_uint32 i, codeword;
 	int offset;
 
-	/* Slow, bit by bit lookup. Need to reverse order for huffman. */
-	codeword = Inflate_PeekBits(state,       INFLATE_FAST_BITS);
-	codeword = Huffman_ReverseBits(codeword, INFLATE_FAST_BITS);
+	/* Bit by bit lookup. Need to reverse order for huffman. */
+	codeword = Huffman_ReverseBits((cc_uint32)bits & ((1 << INFLATE_FAST_BITS) - 1), INFLATE_FAST_BITS);
 
-	for (i = INFLATE_FAST_BITS + 1, j = INFLATE_FAST_BITS; i < INFLATE_MAX_BITS; i++, j++) {
-		codeword = (codeword << 1) | ((state->Bits >> j) & 1);
+	for (i = INFLATE_FAST_BITS + 1; i < INFLATE_MAX_BITS; i++) {
+		codeword = (codeword << 1) | ((cc_uint32)(bits >> (i - 1)) & 1);
 
 		if (codeword < table->endCodewords[i]) {
 			offset = table->firstOffsets[i] + (codeword - table->firstCodewords[i]);
-			Inflate_ConsumeBits(state, i);
+			*len   = i;
 			return table->values[offset];
 		}
 	}
-
-	Inflate_Fail(state, INF_ERR_INVALID_CODE);
-	/* Need to exit the fast decode loop */
-	/* TODO: This means a few garbage bytes can get written */
-	/* to the output, but it probably doesn't matter */
-	state->AvailIn = 0;
-	return 0;
+	return -1;
 }
 
 void Inflate_Init2(struct InflateState* state, struct Stream* source) {
@@ -389,80 +369,162 @@ static const cc_uint8 codelens_order[INFLATE_MAX_CODELENS] = {
 	16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 
 };
 
-static void Inflate_InflateFast(struct InflateState* s) {
-	/* huffman variables */
-	cc_uint32 lit, len, dist;
-	cc_uint32 bits, lenIdx, distIdx;
-	int packed, consumedBits;
+/* Copies the given recently output data into the window circular buffer */
+static void Inflate_UpdateWindow(struct InflateState* s, const cc_uint8* data, cc_uint32 len) {
+	cc_uint32 partLen;
+	/* Only the most recent data is needed for LZ77 */
+	if (len >= INFLATE_WINDOW_SIZE) {
+		Mem_Copy(s->Window, data + (len - INFLATE_WINDOW_SIZE), INFLATE_WINDOW_SIZE);
+		s->WindowIndex = 0;
+		return;
+	}
 
-	/* window variables */
-	cc_uint8* window;
-	cc_uint32 i, curIdx, startIdx;
-	cc_uint32 copyStart, copyLen, partLen;
+	partLen = min(len, INFLATE_WINDOW_SIZE - s->WindowIndex);
+	Mem_Copy(&s->Window[s->WindowIndex], data, partLen);
+	/* Wrap around remainder of copy to start from beginning of window */
+	Mem_Copy(s->Window, data + partLen, len - partLen);
+	s->WindowIndex = (s->WindowIndex + len) & INFLATE_WINDOW_MASK;
+}
 
-	window = s->Window;
-	curIdx = s->WindowIndex;
-	copyStart = s->WindowIndex;
-	copyLen   = 0;
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INFLATE_SSE2
+#define Inflate_Copy16(dst, src) _mm_storeu_si128((__m128i*)(dst), _mm_loadu_si128((const __m128i*)(src)))
+#endif
+
+/* Decodes as many symbols as possible without needing to check for running out of input or output space. */
+/* Output is written directly to the output buffer, which also acts as the LZ77 window for matches that */
+/*  only refer back to data output by this call, so the window only needs updating once at the end. */
+static void Inflate_InflateFast(struct InflateState* s) {
+	/* bit buffer variables */
+	cc_uint64 bits;
+	cc_uint32 numBits, used;
+	const cc_uint8* in;
+	const cc_uint8* inLimit;
+	/* huffman variables */
+	const cc_int16* litsFast;
+	const cc_int16* distsFast;
+	cc_uint32 len, dist, extra;
+	int lit, distIdx, packed;
+	/* output variables */
+	cc_uint8* outStart;
+	cc_uint8* outLimit;
+	cc_uint8* out;
+	cc_uint8* end;
+	const cc_uint8* src;
+	cc_uint32 i, back, windowIdx;
+
+	bits    = s->Bits;
+	numBits = s->NumBits;
+	in      = s->NextIn;
+	inLimit = in + (s->AvailIn - 8);
+
+	out      = s->Output;
+	outStart = out;
+	outLimit = out + (s->AvailOut - INFLATE_FASTINF_OUT);
+
+	litsFast  = s->Table.Lits.fast;
+	distsFast = s->TableDists.fast;
+
+#define Inflate_Decode64(fast, table, value) \
+	packed = fast[bits & ((1 << INFLATE_FAST_BITS) - 1)];\
+	if (packed >= 0) {\
+		used  = packed >> INFLATE_FAST_LEN_SHIFT;\
+		value = packed &  INFLATE_FAST_VAL_MASK;\
+	} else {\
+		value = Huffman_DecodeSlow(&table, bits, &used);\
+		if (value < 0) { Inflate_Fail(s, INF_ERR_INVALID_CODE); break; }\
+	}\
+	bits >>= used; numBits -= used;
 
-#define INFLATE_FAST_COPY_MAX (INFLATE_WINDOW_SIZE - INFLATE_FASTINF_OUT)
-	while (s->AvailOut >= INFLATE_FASTINF_OUT && s->AvailIn >= INFLATE_FASTINF_IN && copyLen < INFLATE_FAST_COPY_MAX) {
-		Huffman_UNSAFE_Decode(s, s->Table.Lits, lit);
+	while (out <= outLimit && in <= inLimit) {
+		/* Refill bit buffer to have at least 57 bits */
+		while (numBits <= 56) {
+			bits    |= (cc_uint64)(*in++) << numBits;
+			numBits += 8;
+		}
+		Inflate_Decode64(litsFast, s->Table.Lits, lit);
+
+		if (lit < 256) {
+			*out++ = (cc_uint8)lit;
+			/* Runs of literals are common, and there are enough bits buffered to decode another */
+			/*  two literals without refilling. Only try the fast table though, to keep this simple. */
+			packed = litsFast[bits & ((1 << INFLATE_FAST_BITS) - 1)];
+			if (packed < 0 || (packed & INFLATE_FAST_VAL_MASK) >= 256) continue;
+			used = packed >> INFLATE_FAST_LEN_SHIFT;
+			bits >>= used; numBits -= used;
+			*out++ = (cc_uint8)packed;
+
+			packed = litsFast[bits & ((1 << INFLATE_FAST_BITS) - 1)];
+			if (packed < 0 || (packed & INFLATE_FAST_VAL_MASK) >= 256) continue;
+			used = packed >> INFLATE_FAST_LEN_SHIFT;
+			bits >>= used; numBits -= used;
+			*out++ = (cc_uint8)packed;
+			continue;
+		} else if (lit == 256) {
+			s->State = Inflate_NextBlockState(s);
+			break;
+		}
 
-		if (lit <= 256) {
-			if (lit < 256) {
-				window[curIdx] = (cc_uint8)lit;
-				s->AvailOut--; copyLen++;
-				curIdx = (curIdx + 1) & INFLATE_WINDOW_MASK;
-			} else {
-				s->State = Inflate_NextBlockState(s);
-				break;
+		lit  -= 257;
+		extra = len_bits[lit];
+		len   = len_base[lit] + (cc_uint32)(bits & ((1 << extra) - 1));
+		bits >>= extra; numBits -= extra;
+
+		Inflate_Decode64(distsFast, s->TableDists, distIdx);
+		extra = dist_bits[distIdx];
+		dist  = dist_base[distIdx] + (cc_uint32)(bits & ((1 << extra) - 1));
+		bits >>= extra; numBits -= extra;
+		/* Distance codes 30 and 31 are invalid */
+		if (!dist) { Inflate_Fail(s, INF_ERR_INVALID_CODE); break; }
+
+		/* Start of match may be before this call's output, in which case it is in the window */
+		if (dist > (cc_uint32)(out - outStart)) {
+			back = dist - (cc_uint32)(out - outStart);
+			windowIdx = s->WindowIndex - back;
+
+			for (i = 0; i < back && len; i++, len--) {
+				*out++ = s->Window[(windowIdx + i) & INFLATE_WINDOW_MASK];
 			}
+			if (!len) continue;
+		}
+
+		src = out - dist;
+		end = out + len;
+#ifdef INFLATE_SSE2
+		if (dist >= 16) {
+			do { Inflate_Copy16(out, src); out += 16; src += 16; } while (out < end);
+		} else if (dist == 1) {
+			__m128i value = _mm_set1_epi8((char)*src);
+			do { _mm_storeu_si128((__m128i*)out, value); out += 16; } while (out < end);
 		} else {
-			lenIdx = lit - 257;
-			bits = len_bits[lenIdx];
-			Inflate_UNSAFE_EnsureBits(s, bits);
-			len  = len_base[lenIdx] + Inflate_ReadBits(s, bits);
-
-			Huffman_UNSAFE_Decode(s, s->TableDists, distIdx);
-			bits = dist_bits[distIdx];
-			Inflate_UNSAFE_EnsureBits(s, bits);
-			dist = dist_base[distIdx] + Inflate_ReadBits(s, bits);
-	
-			/* Window infinitely repeats like ...xyz|uvwxyz|uvwxyz|uvw... */
-			/* If start and end don't cross a boundary, can avoid masking index */
-			startIdx = (curIdx - dist) & INFLATE_WINDOW_MASK;
-			if (curIdx >= startIdx && (curIdx + len) < INFLATE_WINDOW_SIZE) {
-				cc_uint8* src = &window[startIdx]; 
-				cc_uint8* dst = &window[curIdx];
-
-				for (i = 0; i < (len & ~0x3); i += 4) {
-					*dst++ = *src++; *dst++ = *src++; *dst++ = *src++; *dst++ = *src++;
-				}
-				for (; i < len; i++) { *dst++ = *src++; }
-			} else {
-				for (i = 0; i < len; i++) {
-					window[(curIdx + i) & INFLATE_WINDOW_MASK] = window[(startIdx + i) & INFLATE_WINDOW_MASK];
-				}
-			}
-			curIdx = (curIdx + len) & INFLATE_WINDOW_MASK;
-			s->AvailOut -= len; copyLen += len;
+			/* Source and destination overlap, but each copy still produces 'dist' valid bytes */
+			do { Inflate_Copy16(out, src); out += dist; src += dist; } while (out < end);
+		}
+		out = end;
+#else
+		for (i = 0; i < (len & ~0x3); i += 4) {
+			*out++ = *src++; *out++ = *src++; *out++ = *src++; *out++ = *src++;
 		}
+		for (; i < len; i++) { *out++ = *src++; }
+#endif
 	}
 
-	s->WindowIndex = curIdx;
-	if (!copyLen) return;
-
-	if (copyStart + copyLen < INFLATE_WINDOW_SIZE) {
-		Mem_Copy(s->Output, &s->Window[copyStart], copyLen);
-		s->Output += copyLen;
-	} else {
-		partLen = INFLATE_WINDOW_SIZE - copyStart;
-		Mem_Copy(s->Output, &s->Window[copyStart], partLen);
-		s->Output += partLen;
-		Mem_Copy(s->Output, s->Window, copyLen - partLen);
-		s->Output += (copyLen - partLen);
-	}
+	/* Return unused whole bytes in the bit buffer to the input, so the rest fits in the state's 32 bit buffer */
+	/* (at most the bits that were already in the state's buffer remain after returning all the bytes read) */
+	used     = min(numBits >> 3, (cc_uint32)(in - s->NextIn));
+	in      -= used;
+	numBits -= used << 3;
+
+	s->Bits    = (cc_uint32)(bits & (((cc_uint64)1 << numBits) - 1));
+	s->NumBits = numBits;
+	s->AvailIn -= (cc_uint32)(in - s->NextIn);
+	s->NextIn   = (cc_uint8*)in;
+
+	len = (cc_uint32)(out - outStart);
+	s->AvailOut -= len;
+	s->Output    = out;
+	Inflate_UpdateWindow(s, outStart, len);
 }
 
 void Inflate_Process(struct InflateState* s) {
@@ -479,7 +541,7 @@ void Inflate_Process(struct InflateState* s) {
 	cc_uint8  repeatValue;
 	/* window variables */
 	cc_uint32 startIdx, curIdx;
-	cc_uint32 copyLen, windowCopyLen;
+	cc_uint32 copyLen;
 
 	for (;;) {
 		switch (s->State) {
@@ -539,16 +601,8 @@ void Inflate_Process(struct InflateState* s) {
 			copyLen = min(copyLen, s->Index);
 			if (copyLen > 0) {
 				Mem_Copy(s->Output, s->NextIn, copyLen);
-				windowCopyLen = INFLATE_WINDOW_SIZE - s->WindowIndex;
-				windowCopyLen = min(windowCopyLen, copyLen);
-
-				Mem_Copy(&s->Window[s->WindowIndex], s->Output, windowCopyLen);
-				/* Wrap around remainder of copy to start from beginning of window */
-				if (windowCopyLen < copyLen) {
-					Mem_Copy(s->Window, &s->Output[windowCopyLen], copyLen - windowCopyLen);
-				}
+				Inflate_UpdateWindow(s, s->Output, copyLen);
 
-				s->WindowIndex = (s->WindowIndex + copyLen) & INFLATE_WINDOW_MASK;
 				s->Output += copyLen; s->AvailOut -= copyLen; s->Index -= copyLen;
 				s->NextIn += copyLen; s->AvailIn  -= copyLen;		
 			}
@@ -721,10 +775,20 @@ void Inflate_Process(struct InflateState* s) {
 	}
 }
 
+/* Points the input directly at the source's remaining data, instead of copying it into the Input buffer */
+/* NOTE: Only safe for file mappings, as other memory (e.g. network packets) may be reused before it is decoded */
+static void Inflate_UseMemoryInput(struct InflateState* state) {
+	struct Stream* source = state->Source;
+	state->NextIn  = source->meta.mem.cur;
+	state->AvailIn = source->meta.mem.left;
+
+	source->meta.mem.cur += source->meta.mem.left;
+	source->meta.mem.left = 0;
+}
+
 static cc_result Inflate_StreamRead(struct Stream* stream, cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
 	struct InflateState* state;
-	cc_uint8* inputEnd;
-	cc_uint32 read, left;
+	cc_uint32 read;
 	cc_uint32 startAvailOut;
 	cc_bool hasInput;
 	cc_result res;
@@ -738,19 +802,20 @@ static cc_result Inflate_StreamRead(struct Stream* stream, cc_uint8* data, cc_ui
 	while (state->AvailOut > 0 && hasInput) {
 		if (state->State == INFLATE_STATE_DONE) return state->result;
 
-		if (!state->AvailIn) {
+		if (!state->AvailIn && Stream_IsMapped(state->Source)) {
+			Inflate_UseMemoryInput(state);
+			hasInput = state->AvailIn > 0;
+		} else if (!state->AvailIn) {
 			/* Fully used up input buffer. Cycle back to start. */
-			inputEnd = state->Input + INFLATE_MAX_INPUT;
-			if (state->NextIn == inputEnd) state->NextIn = state->Input;
-
-			left = (cc_uint32)(inputEnd - state->NextIn);
-			res  = state->Source->Read(state->Source, state->NextIn, left, &read);
+			/* (NextIn may also be pointing into a mapped source's data) */
+			state->NextIn = state->Input;
+			res = state->Source->Read(state->Source, state->Input, INFLATE_MAX_INPUT, &read);
 			if (res) return res;
 
 			/* Did we fail to read in more input data? Can't immediately return here, */
 			/* because there might be a few bits of data left in the bit buffer */
 			hasInput = read > 0;
-			state->AvailIn += read;
+			state->AvailIn = read;
 		}
 		
 		/* Reading data reduces available out */
@@ -788,8 +853,8 @@ static const cc_uint16 deflate_dist[31] = {
 #define Deflate_PushBits(state, value, bits) state->Bits |= (value) << state->NumBits; state->NumBits += (bits);
 /* Pushes bits of the huffman codeword bits for the given literal, but does not write them */
 #define Deflate_PushLit(state, value) Deflate_PushBits(state, state->LitsCodewords[value], state->LitsLens[value])
-/* Pushes given bits (reversing for huffman code), but does not write them */
-#define Deflate_PushHuff(state, value, bits) Deflate_PushBits(state, Huffman_ReverseBits(value, bits), bits)
+/* Pushes bits of the huffman codeword bits for the given distance, but does not write them */
+#define Deflate_PushDist(state, value) Deflate_PushBits(state, state->DistsCodewords[value], state->DistsLens[value])
 /* Writes given byte to output */
 #define Deflate_WriteByte(state) *state->NextOut++ = state->Bits; state->AvailOut--; state->Bits >>= 8; state->NumBits -= 8;
 /* Flushes bits in buffer to output buffer */
@@ -797,7 +862,55 @@ static const cc_uint16 deflate_dist[31] = {
 
 #define MIN_MATCH_LEN 3
 #define MAX_MATCH_LEN 258
+#define DEFLATE_MAX_LITS  286 /* Literal/length codes 286 and 287 are never used */
+#define DEFLATE_MAX_DISTS 30  /* Distance codes 30 and 31 are never used */
+#define DEFLATE_MAX_BITS  15  /* Longest allowed literal/length or distance codeword */
+#define DEFLATE_MAX_CODELEN_BITS 7
+
+const char* const Deflate_LevelNames[DEFLATE_LEVEL_COUNT] = { "Fast", "Default", "Best" };
+/* How hard each level tries to find matches */
+static const struct DeflateLevelConfig {
+	cc_uint16 maxChain; /* Maximum number of previous matches to explore */
+	cc_uint16 niceLen;  /* Stop searching once a match at least this long is found */
+	cc_uint16 lazyLen;  /* Lazy: Don't look for a better match at next byte if match is at least this long */
+	                    /* Greedy: Only add strings within match to hash chains if match is at most this long */
+	cc_bool lazy;
+} deflate_levels[DEFLATE_LEVEL_COUNT] = {
+	{    8,  32,   8, false },
+	{   32, 128,  32, true  },
+	{ 1024, 258, 258, true  }
+};
+
+/* Length code (minus 257) for each match length (minus MIN_MATCH_LEN) */
+static cc_uint8 deflate_lenCodes[MAX_MATCH_LEN - MIN_MATCH_LEN + 1];
+/* Distance code for distances 1 to 256, followed by distance code for every 128th distance afterwards */
+static cc_uint8 deflate_distCodes[512];
+#define Deflate_DistCode(dist) ((dist) <= 256 ? deflate_distCodes[(dist) - 1] : deflate_distCodes[256 + (((dist) - 1) >> 7)])
+
+static int Deflate_FindCode(const cc_uint16* bases, int value) {
+	int j;
+	for (j = 0; value >= bases[j + 1]; j++) { }
+	return j;
+}
+
+static void Deflate_InitCodes(void) {
+	int i;
+	/* Length 258 has non-zero code, so tables have already been initialised */
+	if (deflate_lenCodes[MAX_MATCH_LEN - MIN_MATCH_LEN]) return;
+
+	for (i = 0; i < 256; i++) {
+		deflate_distCodes[i]       = Deflate_FindCode(deflate_dist, i + 1);
+		deflate_distCodes[i + 256] = Deflate_FindCode(deflate_dist, (i << 7) + 1);
+	}
+	for (i = MIN_MATCH_LEN; i <= MAX_MATCH_LEN; i++) {
+		deflate_lenCodes[i - MIN_MATCH_LEN] = Deflate_FindCode(deflate_len, i);
+	}
+}
 
+
+/*########################################################################################################################*
+*--------------------------------------------------Deflate match finding--------------------------------------------------*
+*#########################################################################################################################*/
 /* Number of bytes that match (are the same) from a and b */
 static int Deflate_MatchLen(cc_uint8* a, cc_uint8* b, int maxLen) {
 	int i = 0;
@@ -807,131 +920,425 @@ static int Deflate_MatchLen(cc_uint8* a, cc_uint8* b, int maxLen) {
 
 /* Hashes 3 bytes of data */
 static cc_uint32 Deflate_Hash(cc_uint8* src) {
-	return (cc_uint32)((src[0] << 8) ^ (src[1] << 4) ^ (src[2])) & DEFLATE_HASH_MASK;
+	cc_uint32 value = src[0] | (src[1] << 8) | (src[2] << 16);
+	value *= 0x9E3779B1UL;
+	return (value & 0xFFFFFFFFUL) >> (32 - DEFLATE_HASH_BITS);
 }
 
-/* Writes a literal to state->Output */
-static void Deflate_Lit(struct DeflateState* state, int lit) {
-	Deflate_PushLit(state, lit);
-	Deflate_FlushBits(state);
+/* Inserts the string starting at the given position into the hash chains, returning the previous head of its chain */
+static int Deflate_Insert(struct DeflateState* state, cc_uint8* cur) {
+	cc_uint32 hash = Deflate_Hash(cur);
+	int pos  = (int)(cur - state->Input);
+	int head = state->Head[hash];
+
+	state->Head[hash] = pos;
+	state->Prev[pos]  = head;
+	return head;
 }
 
-/* Writes a length-distance pair to state->Output */
-static void Deflate_LenDist(struct DeflateState* state, int len, int dist) {
-	int j;
-	/* TODO: Do we actually need the if (len_bits[j]) ????????? does writing 0 bits matter??? */
+/* Inserts the strings starting at the given positions into the hash chains */
+static void Deflate_InsertRange(struct DeflateState* state, cc_uint8* cur, int count, cc_uint8* end) {
+	/* Hash needs 3 bytes of data */
+	count = min(count, (int)(end - cur) - (MIN_MATCH_LEN - 1));
+	for (; count > 0; count--, cur++) { Deflate_Insert(state, cur); }
+}
 
-	for (j = 0; len >= deflate_len[j + 1]; j++);
-	Deflate_PushLit(state, j + 257);
-	if (len_bits[j]) { Deflate_PushBits(state, len - deflate_len[j], len_bits[j]); }
-	Deflate_FlushBits(state);
+/* Searches the hash chain starting at pos for a match longer than bestLen */
+static int Deflate_LongestMatch(struct DeflateState* state, cc_uint8* cur, int pos, int maxLen, int bestLen, int* bestPos) {
+	int depth = state->MaxChain;
+	int len, niceLen;
+	cc_uint8* match;
 
-	for (j = 0; dist >= deflate_dist[j + 1]; j++);
-	Deflate_PushHuff(state, j, 5);
-	if (dist_bits[j]) { Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]); }
-	Deflate_FlushBits(state);
+	maxLen  = min(maxLen, MAX_MATCH_LEN);
+	niceLen = min(state->NiceLen, maxLen);
+	if (bestLen >= maxLen) return bestLen;
+
+	for (; pos != 0 && depth > 0; depth--, pos = state->Prev[pos]) {
+		match = &state->Input[pos];
+		/* Quickly skip over matches that can't be longer than the current best match */
+		if (match[bestLen] != cur[bestLen] || match[0] != cur[0] || match[1] != cur[1]) continue;
+
+		len = Deflate_MatchLen(match, cur, maxLen);
+		if (len <= bestLen) continue;
+
+		bestLen  = len;
+		*bestPos = pos;
+		if (len >= niceLen) break;
+	}
+	return bestLen;
 }
 
-/* Moves "current block" to "previous block", adjusting state if needed. */
-static void Deflate_MoveBlock(struct DeflateState* state) {
-	int i;
-	Mem_Copy(state->Input, state->Input + DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
-	state->InputPosition = DEFLATE_BLOCK_SIZE;
+static void Deflate_RecordLit(struct DeflateState* state, int lit) {
+	int i = state->NumSyms++;
+	state->SymLens[i]  = lit;
+	state->SymDists[i] = 0;
+	state->LitsFreqs[lit]++;
+}
 
-	/* adjust hash table offsets, removing offsets that are no longer in data at all */
-	for (i = 0; i < Array_Elems(state->Head); i++) {
-		state->Head[i] = state->Head[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Head[i] - DEFLATE_BLOCK_SIZE);
+static void Deflate_RecordMatch(struct DeflateState* state, int len, int dist) {
+	int i = state->NumSyms++;
+	state->SymLens[i]  = len - MIN_MATCH_LEN;
+	state->SymDists[i] = dist;
+	state->LitsFreqs[257 + deflate_lenCodes[len - MIN_MATCH_LEN]]++;
+	state->DistsFreqs[Deflate_DistCode(dist)]++;
+}
+
+/* Finds matches in the current block, using the longest match found at each byte */
+static void Deflate_MatchGreedy(struct DeflateState* state, int len) {
+	cc_uint8* cur = state->Input + DEFLATE_BLOCK_SIZE;
+	cc_uint8* end = cur + len;
+	int head, matchLen, matchPos = 0;
+
+	while (end - cur > MIN_MATCH_LEN) {
+		head     = Deflate_Insert(state, cur);
+		matchLen = MIN_MATCH_LEN - 1;
+		if (head) matchLen = Deflate_LongestMatch(state, cur, head, (int)(end - cur), matchLen, &matchPos);
+
+		if (matchLen >= MIN_MATCH_LEN) {
+			Deflate_RecordMatch(state, matchLen, (int)(cur - state->Input) - matchPos);
+			/* Skip adding long matches to the hash chains, to avoid slow performance */
+			if (matchLen <= state->LazyLen) Deflate_InsertRange(state, cur + 1, matchLen - 1, end);
+			cur += matchLen;
+		} else {
+			Deflate_RecordLit(state, *cur);
+			cur++;
+		}
+	}
+	for (; cur < end; cur++) { Deflate_RecordLit(state, *cur); }
+}
+
+/* Finds matches in the current block, preferring a longer match at the next byte over the match at this byte */
+/* Based off descriptions from http://www.gzip.org/algorithm.txt */
+static void Deflate_MatchLazy(struct DeflateState* state, int len) {
+	cc_uint8* cur = state->Input + DEFLATE_BLOCK_SIZE;
+	cc_uint8* end = cur + len;
+	int head, pos, curLen, curPos = 0;
+	int prevLen = MIN_MATCH_LEN - 1, prevPos = 0;
+	cc_bool havePrev = false;
+
+	while (end - cur > MIN_MATCH_LEN) {
+		head   = Deflate_Insert(state, cur);
+		pos    = (int)(cur - state->Input);
+		curLen = MIN_MATCH_LEN - 1;
+
+		if (head && prevLen < state->LazyLen) {
+			curLen = Deflate_LongestMatch(state, cur, head, (int)(end - cur), prevLen, &curPos);
+		}
+
+		if (prevLen >= MIN_MATCH_LEN && curLen <= prevLen) {
+			/* Match at previous byte is at least as long as the match at this byte */
+			Deflate_RecordMatch(state, prevLen, (pos - 1) - prevPos);
+			Deflate_InsertRange(state, cur + 1, prevLen - 2, end);
+
+			cur     += prevLen - 1;
+			prevLen  = MIN_MATCH_LEN - 1;
+			havePrev = false;
+		} else {
+			if (havePrev) Deflate_RecordLit(state, cur[-1]);
+			havePrev = true;
+			prevLen  = curLen;
+			prevPos  = curPos;
+			cur++;
+		}
 	}
-	for (i = 0; i < Array_Elems(state->Prev); i++) {
-		state->Prev[i] = state->Prev[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Prev[i] - DEFLATE_BLOCK_SIZE);
+
+	if (havePrev && prevLen >= MIN_MATCH_LEN) {
+		Deflate_RecordMatch(state, prevLen, (int)(cur - 1 - state->Input) - prevPos);
+		cur += prevLen - 1;
+	} else if (havePrev) {
+		Deflate_RecordLit(state, cur[-1]);
 	}
+	for (; cur < end; cur++) { Deflate_RecordLit(state, *cur); }
 }
 
-/* Compresses current block of data */
-static cc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
-	cc_uint32 hash, nextHash;
-	int bestLen, maxLen, matchLen, depth;
-	int bestPos, pos, nextPos;
-	cc_uint16 oldHead;
-	cc_uint8* input;
-	cc_uint8* cur;
-	cc_result res;
 
-	if (!state->WroteHeader) {
-		state->WroteHeader = true;
-		Deflate_PushBits(state, 3, 3); /* final block TRUE, block type FIXED */
+/*########################################################################################################################*
+*-------------------------------------------------Deflate block encoding--------------------------------------------------*
+*#########################################################################################################################*/
+/* Calculates length limited huffman codeword bit lengths for the given symbol frequencies */
+/* Based off descriptions from https://en.wikipedia.org/wiki/Huffman_coding and miniz's tdefl_optimize_huffman_table */
+static void Deflate_CalcLengths(const cc_uint16* freqs, int count, int maxBits, cc_uint8* lens) {
+	int syms[INFLATE_MAX_LITS];
+	int nodes[INFLATE_MAX_LITS * 2], parents[INFLATE_MAX_LITS * 2];
+	int blCount[DEFLATE_MAX_BITS + 1];
+	int i, j, n = 0, sym, sum, pick;
+	int leaf, node, next;
+	cc_uint32 total;
+
+	for (i = 0; i < count; i++) {
+		lens[i] = 0;
+		if (freqs[i]) syms[n++] = i;
+	}
+	/* Huffman code must have at least two codewords, so add dummy codewords if necessary */
+	for (i = 0; n < 2; i++) {
+		if (!freqs[i] && (n == 0 || syms[0] != i)) syms[n++] = i;
 	}
 
-	/* Based off descriptions from http://www.gzip.org/algorithm.txt and
-	https://github.com/nothings/stb/blob/master/stb_image_write.h */
-	input = state->Input;
-	cur   = input + DEFLATE_BLOCK_SIZE;
-
-	/* Compress current block of data */
-	/* Use > instead of >=, because also try match at one byte after current */
-	while (len > MIN_MATCH_LEN) {
-		hash   = Deflate_Hash(cur);
-		maxLen = min(len, MAX_MATCH_LEN);
-
-		bestLen = MIN_MATCH_LEN - 1; /* Match must be at least 3 bytes */
-		bestPos = 0;
-
-		/* Find longest match starting at this byte */
-		/* Only explore up to 5 previous matches, to avoid slow performance */
-		/* (i.e prefer quickly saving maps/screenshots to completely optimal filesize) */
-		pos = state->Head[hash];
-		for (depth = 0; pos != 0 && depth < 5; depth++) {
-			matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
-			if (matchLen > bestLen) { bestLen = matchLen; bestPos = pos; }
-			pos = state->Prev[pos];
+	/* Sort symbols by frequency (insertion sort, as at most 286 symbols) */
+	for (i = 1; i < n; i++) {
+		sym = syms[i];
+		for (j = i; j > 0 && freqs[syms[j - 1]] > freqs[sym]; j--) { syms[j] = syms[j - 1]; }
+		syms[j] = sym;
+	}
+	for (i = 0; i < n; i++) { nodes[i] = freqs[syms[i]]; }
+
+	/* Build huffman tree using two queues. Leaves are already sorted by weight, */
+	/*  and internal nodes are created in order of increasing weight */
+	leaf = 0; node = n;
+	for (next = n; next < n * 2 - 1; next++) {
+		for (j = 0, sum = 0; j < 2; j++) {
+			if (leaf < n && (node == next || nodes[leaf] <= nodes[node])) {
+				pick = leaf++;
+			} else {
+				pick = node++;
+			}
+			parents[pick] = next;
+			sum += nodes[pick];
 		}
+		nodes[next] = sum;
+	}
 
-		/* Insert this entry into the hash chain */
-		pos = (int)(cur - input);
-		oldHead = state->Head[hash];
-		state->Head[hash] = pos;
-		state->Prev[pos]  = oldHead;
-
-		/* Lazy evaluation: Find longest match starting at next byte */
-		/* If that's longer than the longest match at current byte, throwaway this match */
-		if (bestPos) {
-			nextHash = Deflate_Hash(cur + 1);
-			nextPos  = state->Head[nextHash];
-			maxLen   = min(len - 1, MAX_MATCH_LEN);
-
-			for (depth = 0; nextPos != 0 && depth < 5; depth++) {
-				matchLen = Deflate_MatchLen(&input[nextPos], cur + 1, maxLen);
-				if (matchLen > bestLen) { bestPos = 0; break; }
-				nextPos = state->Prev[nextPos];
-			}
+	/* Calculate depth of each node, from the root down */
+	nodes[n * 2 - 2] = 0;
+	for (i = n * 2 - 3; i >= 0; i--) { nodes[i] = nodes[parents[i]] + 1; }
+
+	for (i = 0; i <= maxBits; i++) blCount[i] = 0;
+	for (i = 0; i < n; i++) { blCount[min(nodes[i], maxBits)]++; }
+
+	/* Codewords longer than maxBits were shortened above, which may oversubscribe the code */
+	/* Lengthen the longest codewords shorter than maxBits until the code is valid again */
+	total = 0;
+	for (i = maxBits; i > 0; i--) total += (cc_uint32)blCount[i] << (maxBits - i);
+
+	for (; total != (1UL << maxBits); total--) {
+		blCount[maxBits]--;
+		for (i = maxBits - 1; i > 0; i--) {
+			if (!blCount[i]) continue;
+			blCount[i]--; blCount[i + 1] += 2;
+			break;
 		}
+	}
+
+	/* Least frequent symbols get the longest codewords */
+	for (i = maxBits, j = 0; i > 0; i--) {
+		for (sum = blCount[i]; sum > 0; sum--) { lens[syms[j++]] = i; }
+	}
+}
+
+/* Writes out all the data in Output to the destination stream */
+static cc_result Deflate_FlushOutput(struct DeflateState* state) {
+	cc_result res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	state->NextOut  = state->Output;
+	state->AvailOut = DEFLATE_OUT_SIZE;
+	return res;
+}
 
-		if (bestPos) {
-			Deflate_LenDist(state, bestLen, pos - bestPos);
-			len -= bestLen; cur += bestLen;
+/* Writes out bits in buffer, padding the last byte with 0s if necessary */
+static void Deflate_AlignBits(struct DeflateState* state) {
+	Deflate_FlushBits(state);
+	if (state->NumBits) {
+		state->NumBits = 8;
+		Deflate_FlushBits(state);
+	}
+}
+
+/* Writes the recorded symbols using the current huffman tables */
+static cc_result Deflate_WriteSymbols(struct DeflateState* state) {
+	int i, lit, dist, code;
+	cc_result res;
+
+	for (i = 0; i < state->NumSyms; i++) {
+		lit  = state->SymLens[i];
+		dist = state->SymDists[i];
+
+		if (!dist) {
+			Deflate_PushLit(state, lit);
 		} else {
-			Deflate_Lit(state, *cur);
-			len--; cur++;
+			code = deflate_lenCodes[lit];
+			Deflate_PushLit(state, code + 257);
+			Deflate_PushBits(state, lit + MIN_MATCH_LEN - deflate_len[code], len_bits[code]);
+			Deflate_FlushBits(state);
+
+			/* Distance codeword and extra bits may need up to 28 bits */
+			code = Deflate_DistCode(dist);
+			Deflate_PushDist(state, code);
+			Deflate_FlushBits(state);
+			Deflate_PushBits(state, dist - deflate_dist[code], dist_bits[code]);
 		}
+		Deflate_FlushBits(state);
 
-		/* leave room for a few bytes and literals at end */
-		if (state->AvailOut >= 20) continue;
-		res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-		state->NextOut  = state->Output;
-		state->AvailOut = DEFLATE_OUT_SIZE;
-		if (res) return res;
+		/* leave room for a few more symbols */
+		if (state->AvailOut >= 16) continue;
+		if ((res = Deflate_FlushOutput(state))) return res;
 	}
 
-	/* literals for last few bytes */
-	while (len > 0) {
-		Deflate_Lit(state, *cur);
-		len--; cur++;
+	Deflate_PushLit(state, 256);
+	Deflate_FlushBits(state);
+	return 0;
+}
+
+/* Run length encodes the codeword bit lengths of the literals/lengths and distances */
+/* Returns the number of codelen symbols used to do so */
+static int Deflate_EncodeLens(const cc_uint8* lens, int count, cc_uint8* syms, cc_uint8* extra, cc_uint16* freqs) {
+	int i, run, len, n = 0;
+
+	for (i = 0; i < count; i += run) {
+		len = lens[i];
+		for (run = 1; i + run < count && lens[i + run] == len; run++) { }
+		len = run;
+
+		if (!lens[i]) {
+			/* Repeat 0 for 11 to 138 times, or for 3 to 10 times */
+			for (; len >= 11; len -= extra[n++] + 11) {
+				syms[n] = 18; extra[n] = min(len, 138) - 11;
+			}
+			if (len >= 3) {
+				syms[n] = 17; extra[n++] = len - 3; len = 0;
+			}
+		} else {
+			/* Repeat previous length for 3 to 6 times */
+			syms[n] = lens[i]; extra[n++] = 0; len--;
+			for (; len >= 3; len -= extra[n++] + 3) {
+				syms[n] = 16; extra[n] = min(len, 6) - 3;
+			}
+		}
+		for (; len > 0; len--) { syms[n] = lens[i]; extra[n++] = 0; }
 	}
 
-	res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-	state->NextOut  = state->Output;
-	state->AvailOut = DEFLATE_OUT_SIZE;
+	for (i = 0; i < INFLATE_MAX_CODELENS; i++) freqs[i] = 0;
+	for (i = 0; i < n; i++) freqs[syms[i]]++;
+	return n;
+}
 
+static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens);
+static const cc_uint8 codelen_extra[3] = { 2, 3, 7 };
+
+/* Encodes the recorded symbols as a single DEFLATE block, using whichever type of block is smallest */
+static cc_result Deflate_WriteBlock(struct DeflateState* state, const cc_uint8* data, int len, cc_bool final) {
+	cc_uint8 lens[DEFLATE_MAX_LITS + DEFLATE_MAX_DISTS];
+	cc_uint8 clSyms[DEFLATE_MAX_LITS + DEFLATE_MAX_DISTS], clExtra[DEFLATE_MAX_LITS + DEFLATE_MAX_DISTS];
+	cc_uint8  clLens[INFLATE_MAX_CODELENS], clBitlens[INFLATE_MAX_CODELENS];
+	cc_uint16 clFreqs[INFLATE_MAX_CODELENS], clCodewords[INFLATE_MAX_CODELENS];
+	cc_uint32 extraBits = 0, fixedBits, dynamicBits, storedBits;
+	int numLits, numDists, numCodeLens, numClSyms;
+	int i, sym;
+	cc_result res;
+
+	/* Make sure there's enough room in output for the block header */
+	if (state->AvailOut < 1024 && (res = Deflate_FlushOutput(state))) return res;
+	state->LitsFreqs[256] = 1;
+
+	Deflate_CalcLengths(state->LitsFreqs,  DEFLATE_MAX_LITS,  DEFLATE_MAX_BITS, lens);
+	Deflate_CalcLengths(state->DistsFreqs, DEFLATE_MAX_DISTS, DEFLATE_MAX_BITS, lens + DEFLATE_MAX_LITS);
+	for (numLits  = DEFLATE_MAX_LITS;  numLits  > 257 && !lens[numLits - 1]; numLits--)  { }
+	for (numDists = DEFLATE_MAX_DISTS; numDists > 1 && !lens[DEFLATE_MAX_LITS + numDists - 1]; numDists--) { }
+
+	/* Literal/length and distance codeword lengths are encoded together */
+	for (i = 0; i < numDists; i++) lens[numLits + i] = lens[DEFLATE_MAX_LITS + i];
+	numClSyms = Deflate_EncodeLens(lens, numLits + numDists, clSyms, clExtra, clFreqs);
+	Deflate_CalcLengths(clFreqs, INFLATE_MAX_CODELENS, DEFLATE_MAX_CODELEN_BITS, clLens);
+	for (numCodeLens = INFLATE_MAX_CODELENS; numCodeLens > 4 && !clLens[codelens_order[numCodeLens - 1]]; numCodeLens--) { }
+
+	/* Length and distance extra bits are the same for fixed and dynamic blocks */
+	for (i = 0; i < DEFLATE_MAX_LITS - 257; i++) extraBits += state->LitsFreqs[i + 257] * len_bits[i];
+	for (i = 0; i < DEFLATE_MAX_DISTS; i++)      extraBits += state->DistsFreqs[i]      * dist_bits[i];
+
+	fixedBits   = 3 + extraBits;
+	dynamicBits = 3 + 5 + 5 + 4 + 3 * numCodeLens + extraBits;
+	for (i = 0; i < DEFLATE_MAX_LITS; i++) {
+		fixedBits += state->LitsFreqs[i] * fixed_lits[i];
+		if (i < numLits) dynamicBits += state->LitsFreqs[i] * lens[i];
+	}
+	for (i = 0; i < DEFLATE_MAX_DISTS; i++) {
+		fixedBits += state->DistsFreqs[i] * fixed_dists[i];
+		if (i < numDists) dynamicBits += state->DistsFreqs[i] * lens[numLits + i];
+	}
+	for (i = 0; i < numClSyms; i++) {
+		sym = clSyms[i];
+		dynamicBits += clLens[sym] + (sym >= 16 ? codelen_extra[sym - 16] : 0);
+	}
+	/* Stored blocks start on a byte boundary, followed by 16 bit length and 16 bit ones complement of length */
+	storedBits = ((state->NumBits + 3 + 7) & ~7) - state->NumBits + 32 + len * 8;
+
+	if (storedBits < fixedBits && storedBits < dynamicBits) {
+		Deflate_PushBits(state, final, 3); /* block type STORED */
+		Deflate_AlignBits(state);
+		Deflate_PushBits(state, len, 16);
+		Deflate_FlushBits(state);
+		Deflate_PushBits(state, len ^ 0xFFFF, 16);
+		Deflate_FlushBits(state);
+
+		if ((res = Deflate_FlushOutput(state))) return res;
+		return Stream_Write(state->Dest, data, len);
+	}
+
+	if (fixedBits <= dynamicBits) {
+		Deflate_PushBits(state, final | (1 << 1), 3); /* block type FIXED */
+		Deflate_BuildTable(fixed_lits,  INFLATE_MAX_LITS,  state->LitsCodewords,  state->LitsLens);
+		Deflate_BuildTable(fixed_dists, INFLATE_MAX_DISTS, state->DistsCodewords, state->DistsLens);
+		return Deflate_WriteSymbols(state);
+	}
+
+	Deflate_PushBits(state, final | (2 << 1), 3); /* block type DYNAMIC */
+	Deflate_PushBits(state, numLits  - 257, 5);
+	Deflate_PushBits(state, numDists - 1,   5);
+	Deflate_PushBits(state, numCodeLens - 4, 4);
+	Deflate_FlushBits(state);
+
+	for (i = 0; i < numCodeLens; i++) {
+		Deflate_PushBits(state, clLens[codelens_order[i]], 3);
+		Deflate_FlushBits(state);
+	}
+
+	Deflate_BuildTable(clLens, INFLATE_MAX_CODELENS, clCodewords, clBitlens);
+	for (i = 0; i < numClSyms; i++) {
+		sym = clSyms[i];
+		Deflate_PushBits(state, clCodewords[sym], clBitlens[sym]);
+		if (sym >= 16) { Deflate_PushBits(state, clExtra[i], codelen_extra[sym - 16]); }
+		Deflate_FlushBits(state);
+	}
+
+	Deflate_BuildTable(lens,           numLits,  state->LitsCodewords,  state->LitsLens);
+	Deflate_BuildTable(lens + numLits, numDists, state->DistsCodewords, state->DistsLens);
+	return Deflate_WriteSymbols(state);
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Deflate stream------------------------------------------------------*
+*#########################################################################################################################*/
+/* Moves "current block" to "previous block", adjusting state if needed. */
+static void Deflate_MoveBlock(struct DeflateState* state) {
+	int i, pos;
+	Mem_Copy(state->Input, state->Input + DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
+	state->InputPosition = DEFLATE_BLOCK_SIZE;
+
+	/* adjust hash table offsets, removing offsets that are no longer in data at all */
+	for (i = 0; i < Array_Elems(state->Head); i++) {
+		state->Head[i] = state->Head[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Head[i] - DEFLATE_BLOCK_SIZE);
+	}
+	/* hash chain links move along with the data they are for */
+	for (i = 0; i < DEFLATE_BLOCK_SIZE; i++) {
+		pos = state->Prev[i + DEFLATE_BLOCK_SIZE];
+		state->Prev[i] = pos < DEFLATE_BLOCK_SIZE ? 0 : (pos - DEFLATE_BLOCK_SIZE);
+		state->Prev[i + DEFLATE_BLOCK_SIZE] = 0;
+	}
+}
+
+/* Compresses current block of data */
+static cc_result Deflate_FlushBlock(struct DeflateState* state, int len, cc_bool final) {
+	cc_result res;
+	state->NumSyms = 0;
+	Mem_Set(state->LitsFreqs,  0, sizeof(state->LitsFreqs));
+	Mem_Set(state->DistsFreqs, 0, sizeof(state->DistsFreqs));
+
+	if (state->Lazy) {
+		Deflate_MatchLazy(state, len);
+	} else {
+		Deflate_MatchGreedy(state, len);
+	}
+
+	res = Deflate_WriteBlock(state, state->Input + DEFLATE_BLOCK_SIZE, len, final);
 	Deflate_MoveBlock(state);
 	return res;
 }
@@ -958,33 +1365,48 @@ static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data
 		data += len;
 
 		if (state->InputPosition == DEFLATE_BUFFER_SIZE) {
-			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE);
+			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE, false);
 			if (res) return res;
 		}
 	}
 	return 0;
 }
 
-/* Flushes any buffered data, then writes terminating symbol */
+/* Flushes any buffered data as the final block */
 static cc_result Deflate_StreamClose(struct Stream* stream) {
 	struct DeflateState* state;
 	cc_result res;
 
 	state = (struct DeflateState*)stream->meta.inflate;
-	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE);
+	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE, true);
 	if (res) return res;
 
-	/* Write huffman encoded "literal 256" to terminate symbols */
-	Deflate_PushLit(state, 256);
+	/* In case last byte still has a few extra bits */
+	Deflate_AlignBits(state);
+	return Deflate_FlushOutput(state);
+}
+
+/* Compresses buffered data as a non-final block, then pads output to a byte boundary with an empty stored block */
+static cc_result Deflate_SyncFlush(struct DeflateState* state) {
+	cc_result res = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE, false);
+	if (res) return res;
+
+	Deflate_PushBits(state, 0, 3); /* final block FALSE, block type STORED */
+	Deflate_AlignBits(state);
+	Deflate_PushBits(state, 0x0000, 16);
+	Deflate_FlushBits(state);
+	Deflate_PushBits(state, 0xFFFF, 16);
 	Deflate_FlushBits(state);
+	return Deflate_FlushOutput(state);
+}
 
-	/* In case last byte still has a few extra bits */
-	if (state->NumBits) {
-		while (state->NumBits < 8) { Deflate_PushBits(state, 0, 1); }
-		Deflate_FlushBits(state);
-	}
+/* Primes the "previous block" with the given data, so that matches can refer back to it */
+static void Deflate_SetDictionary(struct DeflateState* state, const cc_uint8* data, int len) {
+	cc_uint8* end = state->Input + DEFLATE_BLOCK_SIZE;
+	len = min(len, DEFLATE_BLOCK_SIZE);
 
-	return Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	Mem_Copy(end - len, data, len);
+	Deflate_InsertRange(state, end - len, len, end);
 }
 
 /* Constructs a huffman encoding table (for values to codewords) */
@@ -1007,6 +1429,14 @@ static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codew
 	}
 }
 
+void Deflate_SetLevel(struct DeflateState* state, int level) {
+	const struct DeflateLevelConfig* cfg = &deflate_levels[level];
+	state->MaxChain = cfg->maxChain;
+	state->NiceLen  = cfg->niceLen;
+	state->LazyLen  = cfg->lazyLen;
+	state->Lazy     = cfg->lazy;
+}
+
 void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
 	Stream_Init(stream);
 	stream->meta.inflate = state;
@@ -1021,11 +1451,11 @@ void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struc
 	state->NextOut  = state->Output;
 	state->AvailOut = DEFLATE_OUT_SIZE;
 	state->Dest     = underlying;
-	state->WroteHeader = false;
 
 	Mem_Set(state->Head, 0, sizeof(state->Head));
 	Mem_Set(state->Prev, 0, sizeof(state->Prev));
-	Deflate_BuildTable(fixed_lits, INFLATE_MAX_LITS, state->LitsCodewords, state->LitsLens);
+	Deflate_SetLevel(state, DEFLATE_LEVEL_DEFAULT);
+	Deflate_InitCodes();
 }
 
 
@@ -1045,15 +1475,8 @@ static cc_result GZip_StreamClose(struct Stream* stream) {
 
 static cc_result GZip_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
 	struct GZipState* state = (struct GZipState*)stream->meta.inflate;
-	cc_uint32 i, crc32 = state->Crc32;
 	state->Size += count;
-
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
-	}
-
-	state->Crc32 = crc32;
+	state->Crc32 = Utils_Crc32Update(state->Crc32, data, count);
 	return Deflate_StreamWrite(stream, data, count, modified);
 }
 
@@ -1123,6 +1546,362 @@ void ZLib_MakeStream(struct Stream* stream, struct ZLibState* state, struct Stre
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------Parallel GZip (compress)------------------------------------------------*
+*#########################################################################################################################*/
+/* Input is split into chunks, which worker threads each compress into a series of DEFLATE blocks. (like pigz) */
+/* Each chunk uses the end of the previous chunk's input as its dictionary, and all but the last chunk end */
+/*  with an empty stored block so that they finish on a byte boundary. The compressed chunks can therefore */
+/*  just be written out in order, with their CRC32s combined, to produce a single GZIP member. */
+#define PGZ_CHUNK_SIZE (DEFLATE_BLOCK_SIZE * 16)
+#define PGZ_DICT_SIZE  DEFLATE_BLOCK_SIZE
+/* Compressed size of a chunk in the worst case, where every DEFLATE block is a stored block */
+#define PGZ_MAX_OUT_SIZE (PGZ_CHUNK_SIZE + (PGZ_CHUNK_SIZE / DEFLATE_BLOCK_SIZE + 2) * 8)
+/* Max number of chunks queued or being compressed at once, for each worker */
+#define PGZ_CHUNKS_PER_WORKER 2
+
+enum PGZChunkState { PGZ_CHUNK_QUEUED, PGZ_CHUNK_COMPRESSING, PGZ_CHUNK_COMPRESSED };
+struct PGZChunk {
+	struct PGZChunk* next;
+	cc_uint8* data; /* Dictionary, followed by input data */
+	cc_uint8* out;  /* Compressed data */
+	cc_uint32 dictSize, size, outSize, crc32;
+	cc_uint8 state;
+	cc_bool last;
+	cc_result res;
+};
+/* Thread_Run can't pass an argument, so threads pick up their stream's state from here when starting */
+static struct GZipParallelState* pgz_starting;
+
+static cc_result PGZ_OutWrite(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	if (count > s->meta.mem.left) return ERR_END_OF_STREAM;
+	Mem_Copy(s->meta.mem.cur, data, count);
+
+	s->meta.mem.cur  += count;
+	s->meta.mem.left -= count;
+	*modified = count;
+	return 0;
+}
+
+static void PGZ_Compress(struct GZipParallelState* s, struct PGZChunk* chunk, struct DeflateState* state) {
+	struct Stream out, comp;
+	cc_result res;
+
+	chunk->crc32 = Utils_CRC32(chunk->data + chunk->dictSize, chunk->size);
+	chunk->out   = (cc_uint8*)Mem_TryAlloc(PGZ_MAX_OUT_SIZE, 1);
+	if (!chunk->out) { chunk->res = ERR_OUT_OF_MEMORY; return; }
+
+	Stream_Init(&out);
+	out.Write = PGZ_OutWrite;
+	out.meta.mem.cur  = chunk->out;
+	out.meta.mem.left = PGZ_MAX_OUT_SIZE;
+
+	Deflate_MakeStream(&comp, state, &out);
+	Deflate_SetLevel(state, s->Level);
+	Deflate_SetDictionary(state, chunk->data, chunk->dictSize);
+
+	res = Stream_Write(&comp, chunk->data + chunk->dictSize, chunk->size);
+	if (!res) res = chunk->last ? comp.Close(&comp) : Deflate_SyncFlush(state);
+
+	chunk->outSize = PGZ_MAX_OUT_SIZE - out.meta.mem.left;
+	chunk->res     = res;
+	/* Input data is no longer needed (next chunk has its own copy of the dictionary) */
+	Mem_Free(chunk->data);
+	chunk->data = NULL;
+}
+
+static void PGZ_WriteFooter(struct GZipParallelState* s) {
+	cc_uint8 data[8];
+	Stream_SetU32_LE(&data[0], s->Crc32);
+	Stream_SetU32_LE(&data[4], s->Written);
+	if (!s->Result) s->Result = Stream_Write(s->Dest, data, sizeof(data));
+}
+
+/* Writes out the given compressed chunk, then frees it */
+static void PGZ_WriteChunk(struct GZipParallelState* s, struct PGZChunk* chunk) {
+	cc_uint32 total;
+	cc_bool last = chunk->last;
+
+	if (!s->Result) s->Result = chunk->res;
+	if (!s->Result) s->Result = Stream_Write(s->Dest, chunk->out, chunk->outSize);
+
+	s->Crc32    = Utils_Crc32Combine(s->Crc32, chunk->crc32, chunk->size);
+	s->Written += chunk->size;
+	Mem_Free(chunk->data);
+	Mem_Free(chunk->out);
+	Mem_Free(chunk);
+
+	if (s->Workers) {
+		Mutex_Lock(s->Mutex);
+		total = s->Total;
+		s->Pending--;
+		Mutex_Unlock(s->Mutex);
+		Waitable_Signal(s->FreedWaitable);
+	} else {
+		total = s->Total;
+	}
+
+	if (s->Progress) s->Progress(s->Obj, s->Written, total);
+	if (!last) return;
+
+	PGZ_WriteFooter(s);
+	s->Done = true;
+}
+
+static struct PGZChunk* PGZ_NextQueued(struct PGZChunk* chunk) {
+	for (; chunk && chunk->state != PGZ_CHUNK_QUEUED; chunk = chunk->next) { }
+	return chunk;
+}
+
+static void PGZ_WorkerMain(void) {
+	struct GZipParallelState* s = pgz_starting;
+	struct DeflateState* state;
+	struct PGZChunk* chunk;
+	Waitable_Signal(s->StartedWaitable);
+
+	Mutex_Lock(s->Mutex);
+	state = s->States[s->Started++];
+
+	for (;;) {
+		chunk = PGZ_NextQueued(s->Head);
+		if (!chunk && s->Closed) break;
+
+		if (!chunk) {
+			Mutex_Unlock(s->Mutex);
+			Waitable_Wait(s->QueuedWaitable);
+			Mutex_Lock(s->Mutex);
+			continue;
+		}
+
+		chunk->state = PGZ_CHUNK_COMPRESSING;
+		/* Signals from Waitable_Signal may get merged together, so wake up another worker if needed */
+		if (PGZ_NextQueued(chunk->next)) Waitable_Signal(s->QueuedWaitable);
+		Mutex_Unlock(s->Mutex);
+
+		PGZ_Compress(s, chunk, state);
+		Mutex_Lock(s->Mutex);
+		chunk->state = PGZ_CHUNK_COMPRESSED;
+		Waitable_Signal(s->CompressedWaitable);
+	}
+	Mutex_Unlock(s->Mutex);
+	/* Wake up another worker, so that it can exit too */
+	Waitable_Signal(s->QueuedWaitable);
+}
+
+/* Writes out compressed chunks in the same order they were queued in */
+static void PGZ_WriterMain(void) {
+	struct GZipParallelState* s = pgz_starting;
+	struct PGZChunk* chunk;
+	Waitable_Signal(s->StartedWaitable);
+
+	while (!s->Done) {
+		Mutex_Lock(s->Mutex);
+		chunk = s->Head;
+
+		if (chunk && chunk->state == PGZ_CHUNK_COMPRESSED) {
+			s->Head = chunk->next;
+			if (!s->Head) s->Tail = NULL;
+		} else {
+			chunk = NULL;
+		}
+		Mutex_Unlock(s->Mutex);
+
+		if (chunk) {
+			PGZ_WriteChunk(s, chunk);
+		} else {
+			Waitable_Wait(s->CompressedWaitable);
+		}
+	}
+}
+
+static void PGZ_Submit(struct GZipParallelState* s, struct PGZChunk* chunk) {
+	if (!s->Workers) {
+		s->Total += chunk->size;
+		PGZ_Compress(s, chunk, s->States[0]);
+		PGZ_WriteChunk(s, chunk);
+		return;
+	}
+
+	Mutex_Lock(s->Mutex);
+	s->Total += chunk->size;
+	s->Pending++;
+	if (s->Tail) {
+		s->Tail->next = chunk;
+	} else {
+		s->Head = chunk;
+	}
+	s->Tail = chunk;
+	if (chunk->last) s->Closed = true;
+	Mutex_Unlock(s->Mutex);
+	Waitable_Signal(s->QueuedWaitable);
+}
+
+static int PGZ_PendingCount(struct GZipParallelState* s) {
+	int pending;
+	Mutex_Lock(s->Mutex);
+	pending = s->Pending;
+	Mutex_Unlock(s->Mutex);
+	return pending;
+}
+
+/* Allocates a new chunk, using the end of the given chunk's input data as its dictionary */
+static cc_result PGZ_AllocChunk(struct GZipParallelState* s, struct PGZChunk* prev) {
+	struct PGZChunk* chunk;
+	cc_uint8* prevEnd;
+
+	/* First chunk is allocated before the worker threads are started, so there is nothing queued yet */
+	cc_bool queued = prev && s->Workers;
+
+	/* Limit how many chunks are queued at once, so the input doesn't end up entirely duplicated in memory */
+	while (queued && PGZ_PendingCount(s) >= s->Workers * PGZ_CHUNKS_PER_WORKER) {
+		Waitable_Wait(s->FreedWaitable);
+	}
+
+	for (;;) {
+		chunk = (struct PGZChunk*)Mem_TryAllocCleared(1, sizeof(struct PGZChunk));
+		if (chunk) chunk->data = (cc_uint8*)Mem_TryAlloc(PGZ_DICT_SIZE + PGZ_CHUNK_SIZE, 1);
+		if (chunk && chunk->data) break;
+		Mem_Free(chunk);
+
+		/* Wait for queued chunks to be compressed and written out, and then try again */
+		if (!queued || !PGZ_PendingCount(s)) return ERR_OUT_OF_MEMORY;
+		Waitable_Wait(s->FreedWaitable);
+	}
+
+	if (prev) {
+		chunk->dictSize = min(prev->size + prev->dictSize, PGZ_DICT_SIZE);
+		prevEnd = prev->data + prev->dictSize + prev->size;
+		Mem_Copy(chunk->data, prevEnd - chunk->dictSize, chunk->dictSize);
+	}
+	s->Cur = chunk;
+	return 0;
+}
+
+static cc_result PGZ_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	struct GZipParallelState* s = (struct GZipParallelState*)stream->meta.inflate;
+	struct PGZChunk* chunk;
+	cc_uint32 len;
+	cc_result res;
+	*modified = 0;
+
+	while (count > 0) {
+		chunk = s->Cur;
+		len   = min(count, PGZ_CHUNK_SIZE - chunk->size);
+		Mem_Copy(chunk->data + chunk->dictSize + chunk->size, data, len);
+
+		chunk->size += len;
+		*modified   += len;
+		data        += len;
+		count       -= len;
+		if (chunk->size < PGZ_CHUNK_SIZE) continue;
+
+		/* Must copy dictionary before chunk is queued, as a worker may free it at any time afterwards */
+		if ((res = PGZ_AllocChunk(s, chunk))) return res;
+		PGZ_Submit(s, chunk);
+	}
+	return 0;
+}
+
+static void PGZ_Close(struct GZipParallelState* s) {
+	struct PGZChunk* chunk = s->Cur;
+	if (!chunk) return;
+
+	s->Cur      = NULL;
+	chunk->last = true;
+	PGZ_Submit(s, chunk);
+}
+
+static cc_result PGZ_StreamClose(struct Stream* stream) {
+	PGZ_Close((struct GZipParallelState*)stream->meta.inflate);
+	return 0;
+}
+
+static void PGZ_FreeStates(struct GZipParallelState* s) {
+	int i;
+	for (i = 0; i < GZIP_MAX_WORKERS; i++) {
+		Mem_Free(s->States[i]);
+		s->States[i] = NULL;
+	}
+}
+
+static void PGZ_StartThread(struct GZipParallelState* s, void** handle, Thread_StartFunc func, int stackSize, const char* name) {
+	pgz_starting = s;
+	Thread_Run(handle, func, stackSize, name);
+	/* Make sure thread has picked up the state, before pgz_starting gets changed again */
+	Waitable_Wait(s->StartedWaitable);
+}
+
+cc_result GZipParallel_MakeStream(struct Stream* stream, struct GZipParallelState* s, struct Stream* underlying,
+									int level, int workers, GZip_ProgressFunc progress, void* obj) {
+	static const cc_uint8 header[10] = { 0x1F, 0x8B, 0x08 }; /* GZip header */
+	cc_result res;
+	int i;
+
+#ifdef CC_BUILD_COOPTHREADED
+	workers = 0;
+#endif
+	Mem_Set(s, 0, sizeof(*s));
+	s->Workers  = min(workers, GZIP_MAX_WORKERS);
+	s->Level    = level;
+	s->Dest     = underlying;
+	s->Progress = progress;
+	s->Obj      = obj;
+
+	res = Stream_Write(underlying, header, sizeof(header));
+	if (res) return res;
+
+	/* Use as many workers as there is memory for */
+	for (i = 0; i < max(s->Workers, 1); i++) {
+		s->States[i] = (struct DeflateState*)Mem_TryAlloc(1, sizeof(struct DeflateState));
+		if (!s->States[i]) break;
+	}
+	if (!i) return ERR_OUT_OF_MEMORY;
+	s->Workers = min(s->Workers, i);
+
+	if ((res = PGZ_AllocChunk(s, NULL))) { PGZ_FreeStates(s); return res; }
+
+	Stream_Init(stream);
+	stream->Write = PGZ_StreamWrite;
+	stream->Close = PGZ_StreamClose;
+	stream->meta.inflate = s;
+	if (!s->Workers) return 0;
+
+	s->Mutex = Mutex_Create();
+	s->QueuedWaitable     = Waitable_Create();
+	s->CompressedWaitable = Waitable_Create();
+	s->FreedWaitable      = Waitable_Create();
+	s->StartedWaitable    = Waitable_Create();
+
+	for (i = 0; i < s->Workers; i++) {
+		PGZ_StartThread(s, &s->Threads[i], PGZ_WorkerMain, 128 * 1024, "GZip worker");
+	}
+	PGZ_StartThread(s, &s->Threads[s->Workers], PGZ_WriterMain, 64 * 1024, "GZip writer");
+	return 0;
+}
+
+cc_bool GZipParallel_IsDone(struct GZipParallelState* s) { return s->Done; }
+
+cc_result GZipParallel_Finish(struct GZipParallelState* s) {
+	int i;
+	/* Make sure all the input data gets compressed */
+	PGZ_Close(s);
+
+	if (s->Mutex) {
+		for (i = 0; i <= s->Workers; i++) { Thread_Join(s->Threads[i]); }
+
+		Mutex_Free(s->Mutex);
+		Waitable_Free(s->QueuedWaitable);
+		Waitable_Free(s->CompressedWaitable);
+		Waitable_Free(s->FreedWaitable);
+		Waitable_Free(s->StartedWaitable);
+		s->Mutex = NULL;
+	}
+
+	PGZ_FreeStates(s);
+	return s->Result;
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------ZipReader--------------------------------------------------------*
 *#########################################################################################################################*/
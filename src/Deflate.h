@@ -85,8 +85,8 @@ CC_API void Inflate_MakeStream2(struct Stream* stream, struct InflateState* stat
 #define DEFLATE_BLOCK_SIZE  16384
 #define DEFLATE_BUFFER_SIZE 32768
 #define DEFLATE_OUT_SIZE 8192
-#define DEFLATE_HASH_SIZE 0x1000UL
-#define DEFLATE_HASH_MASK 0x0FFFUL
+#define DEFLATE_HASH_BITS 14
+#define DEFLATE_HASH_SIZE (1UL << DEFLATE_HASH_BITS)
 struct DeflateState {
 	cc_uint32 Bits;         /* Holds bits across byte boundaries */
 	cc_uint32 NumBits;      /* Number of bits in Bits buffer */
@@ -96,8 +96,16 @@ struct DeflateState {
 	cc_uint32 AvailOut;   /* Max number of bytes that can be written to Output buffer */
 	struct Stream* Dest; /* Destination that Output buffer is written to */
 
+	cc_uint16 MaxChain, NiceLen, LazyLen; /* Match finding settings (see Deflate_SetLevel) */
+	cc_bool Lazy;                         /* Whether to look for a longer match at the next byte */
+	int NumSyms;                          /* Number of symbols recorded for the current block */
+
 	cc_uint16 LitsCodewords[INFLATE_MAX_LITS]; /* Codewords for each value */
 	cc_uint8 LitsLens[INFLATE_MAX_LITS];       /* Bit lengths of each codeword */
+	cc_uint16 DistsCodewords[INFLATE_MAX_DISTS];
+	cc_uint8 DistsLens[INFLATE_MAX_DISTS];
+	cc_uint16 LitsFreqs[INFLATE_MAX_LITS];     /* Number of times each value is used in current block */
+	cc_uint16 DistsFreqs[INFLATE_MAX_DISTS];
 	
 	cc_uint8 Input[DEFLATE_BUFFER_SIZE];
 	cc_uint8 Output[DEFLATE_OUT_SIZE];
@@ -105,11 +113,18 @@ struct DeflateState {
 	cc_uint16 Prev[DEFLATE_BUFFER_SIZE];
 	/* NOTE: The largest possible value that can get */
 	/*  stored in Head/Prev is <= DEFLATE_BUFFER_SIZE */
-	cc_bool WroteHeader;
+	cc_uint8 SymLens[DEFLATE_BLOCK_SIZE];   /* Literal, or match length - 3 */
+	cc_uint16 SymDists[DEFLATE_BLOCK_SIZE]; /* Match distance, or 0 for literals */
 };
+
+enum DeflateLevel { DEFLATE_LEVEL_FAST, DEFLATE_LEVEL_DEFAULT, DEFLATE_LEVEL_BEST, DEFLATE_LEVEL_COUNT };
+extern const char* const Deflate_LevelNames[DEFLATE_LEVEL_COUNT];
 /* Compresses input data using DEFLATE, then writes compressed output to another stream. Write only stream. */
 /* DEFLATE compression is pure compressed data, there is no header or footer. */
 CC_API void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying);
+/* Sets how much effort is spent on finding matches, trading off speed against compressed size. */
+/* NOTE: Defaults to DEFLATE_LEVEL_DEFAULT. Should be called before any data is written. */
+CC_API void Deflate_SetLevel(struct DeflateState* state, int level);
 
 struct GZipState { struct DeflateState Base; cc_uint32 Crc32, Size; };
 /* Compresses input data using GZIP, then writes compressed output to another stream. Write only stream. */
@@ -123,6 +138,47 @@ struct ZLibState { struct DeflateState Base; cc_uint32 Adler32; };
 CC_API  void ZLib_MakeStream(      struct Stream* stream, struct ZLibState* state, struct Stream* underlying);
 typedef void (*FP_ZLib_MakeStream)(struct Stream* stream, struct ZLibState* state, struct Stream* underlying);
 
+#define GZIP_MAX_WORKERS 16
+/* Called whenever more data has been compressed, with how many bytes of input have been compressed so far */
+/*  and how many bytes have been written to the stream so far. NOTE: This is called from a background thread. */
+typedef void (*GZip_ProgressFunc)(void* obj, cc_uint32 compressed, cc_uint32 total);
+struct PGZChunk;
+struct GZipParallelState {
+	struct DeflateState* States[GZIP_MAX_WORKERS]; /* Compressor state for each worker */
+	void* Threads[GZIP_MAX_WORKERS + 1];           /* Worker threads, followed by the writer thread */
+	int Workers, Started, Level, Pending;          /* Pending is number of chunks queued but not written out yet */
+	void* Mutex;
+	void* QueuedWaitable;     /* Signalled when a chunk is queued */
+	void* CompressedWaitable; /* Signalled when a chunk has been compressed */
+	void* FreedWaitable;      /* Signalled when a chunk has been written out and freed */
+	void* StartedWaitable;    /* Signalled when a thread has started */
+
+	struct PGZChunk* Head; /* Chunks that have been queued, but not written out yet (oldest first) */
+	struct PGZChunk* Tail;
+	struct PGZChunk* Cur;  /* Chunk that is currently being filled with input data */
+	cc_bool Closed;
+	volatile cc_bool Done;
+
+	struct Stream* Dest;
+	cc_uint32 Crc32, Total, Written;
+	cc_result Result;
+	GZip_ProgressFunc Progress;
+	void* Obj;
+};
+/* Compresses input data using GZIP on worker threads, then writes compressed output to another stream. Write only stream. */
+/* Input is split into chunks that are compressed independently, so output is slightly larger than GZip_MakeStream. */
+/* Writing data only copies it, but waits if too many chunks are still waiting to be compressed. */
+/*   Use GZipParallel_IsDone to check when the output is complete, then GZipParallel_Finish to free resources. */
+/* NOTE: If workers is 0, data is compressed on the calling thread. */
+cc_result GZipParallel_MakeStream(struct Stream* stream, struct GZipParallelState* state, struct Stream* underlying,
+									int level, int workers, GZip_ProgressFunc progress, void* obj);
+/* Whether all input data has been compressed and written to the underlying stream. */
+cc_bool GZipParallel_IsDone(struct GZipParallelState* state);
+/* Waits until all input data has been compressed and written, then frees all resources. */
+/* Returns the first error that occurred while compressing or writing data, if any. */
+/* NOTE: If the stream has not been closed yet, remaining input is still compressed as if it had been. */
+cc_result GZipParallel_Finish(struct GZipParallelState* state);
+
 /* Minimal data needed to describe an entry in a .zip archive */
 struct ZipEntry { cc_uint32 CompressedSize, UncompressedSize, LocalHeaderOffset; };
 /* Callback function to process the data in a .zip archive entry */
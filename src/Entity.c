@@ -21,6 +21,7 @@
 #include "Errors.h"
 #include "Utils.h"
 #include "EntityRenderers.h"
+#include "TexturePack.h"
 
 const char* const NameMode_Names[NAME_MODE_COUNT]   = { "None", "Hovered", "All", "AllHovered", "AllUnscaled" };
 const char* const ShadowMode_Names[SHADOW_MODE_COUNT] = { "None", "SnapToBlock", "Circle", "CircleAll" };
@@ -351,7 +352,27 @@ static void LogInvalidSkin(cc_result res, const cc_string* skin, const cc_uint8*
 	Logger_WarnFunc(&msg);
 }
 
+/* Applies the previously downloaded skin from the texture cache, if there is one */
+static void ApplyCachedSkin(struct Entity* e, const cc_string* url, cc_string* skin) {
+	struct Stream stream, buffered;
+	cc_uint8 buffer[4096];
+	struct Bitmap bmp;
+	cc_result res;
+	if (!TextureCache_Open(url, &stream)) return;
+
+	Stream_ReadonlyBuffered(&buffered, &stream, buffer, sizeof(buffer));
+	bmp.scan0 = NULL;
+
+	if ((res = ApplySkin(e, &bmp, &buffered, skin))) {
+		Logger_SysWarn2(res, "decoding cached skin", skin);
+	}
+	Mem_Free(bmp.scan0);
+	/* No point logging error for closing readonly file */
+	(void)stream.Close(&stream);
+}
+
 static void Entity_CheckSkin(struct Entity* e) {
+	cc_string url; char urlBuffer[URL_MAX_SIZE];
 	struct Entity* first;
 	struct HttpRequest item;
 	struct Stream mem;
@@ -370,7 +391,12 @@ static void Entity_CheckSkin(struct Entity* e) {
 		flags = e == &LocalPlayer_Instances[0].Base ? HTTP_FLAG_NOCACHE : 0;
 
 		if (!first) {
-			e->_skinReqID     = Http_AsyncGetSkin(&skin, flags);
+			String_InitArray(url, urlBuffer);
+			Http_GetSkinUrl(&skin, &url);
+
+			/* Show the cached skin straight away, while checking if it has changed since */
+			ApplyCachedSkin(e, &url, &skin);
+			e->_skinReqID     = TextureCache_Download(&url, flags);
 			e->SkinFetchState = SKIN_FETCH_DOWNLOADING;
 		} else {
 			Entity_CopySkin(e, first);
@@ -381,15 +407,20 @@ static void Entity_CheckSkin(struct Entity* e) {
 
 	if (!Http_GetResult(e->_skinReqID, &item)) return;
 
-	if (!item.success) { 
-		Entity_SetSkinAll(e, true);
-	} else {
+	if (item.success) {
 		Stream_ReadonlyMemory(&mem, item.data, item.size);
 
 		if ((res = ApplySkin(e, &bmp, &mem, &skin))) {
 			LogInvalidSkin(res, &skin, item.data, item.size);
+		} else {
+			TextureCache_Update(&item);
 		}
 		Mem_Free(bmp.scan0);
+	} else if (e->TextureId) {
+		/* Cached skin is still up to date (304), or couldn't be checked */
+		e->SkinFetchState = SKIN_FETCH_COMPLETED;
+	} else {
+		Entity_SetSkinAll(e, true);
 	}
 	HttpRequest_Free(&item);
 }
@@ -11,17 +11,69 @@
 #include "Chat.h"
 #include "ExtMath.h"
 #include "Options.h"
-#include "Queue.h"
 
-
-struct LightNode {
-	IVec3 coords; /* 12 bytes */
-	cc_uint8 brightness; /* 1 byte */
-	/* char padding[3]; */
+/* Light nodes are packed into 64 bits as X, Z, Y (16 bits each), then brightness and whether lamp light */
+typedef cc_uint64 LightNode;
+#define LIGHTNODE_LAMP_FLAG ((cc_uint64)1 << 56)
+#define LightNode_Make(x, y, z, brightness) \
+	((cc_uint64)(x) | ((cc_uint64)(z) << 16) | ((cc_uint64)(y) << 32) | ((cc_uint64)(brightness) << 48))
+#define LightNode_X(node) ((int)((node)         & 0xFFFF))
+#define LightNode_Z(node) ((int)(((node) >> 16) & 0xFFFF))
+#define LightNode_Y(node) ((int)(((node) >> 32) & 0xFFFF))
+#define LightNode_Brightness(node) ((cc_uint8)(((node) >> 48) & 0xFF))
+
+/* Ring buffer of light nodes, which only grows in the rare case that it becomes full */
+struct LightRing {
+	LightNode* nodes;
+	int mask; /* capacity - 1, as capacity is always a power of two */
+	int head, count;
 };
+#define LIGHTRING_INITIAL_CAPACITY 4096
+
+static void LightRing_Init(struct LightRing* ring) {
+	ring->nodes = NULL;
+	ring->mask  = -1;
+	ring->head  = 0;
+	ring->count = 0;
+}
+
+static void LightRing_Free(struct LightRing* ring) {
+	Mem_Free(ring->nodes);
+	LightRing_Init(ring);
+}
+
+static CC_NOINLINE void LightRing_Grow(struct LightRing* ring) {
+	int i, capacity = ring->mask + 1;
+	LightNode* nodes;
+	capacity = capacity ? capacity * 2 : LIGHTRING_INITIAL_CAPACITY;
+	nodes    = (LightNode*)Mem_Alloc(capacity, sizeof(LightNode), "light queue");
+
+	/* Unwrap the existing nodes to the start of the new buffer */
+	for (i = 0; i < ring->count; i++) {
+		nodes[i] = ring->nodes[(ring->head + i) & ring->mask];
+	}
+	Mem_Free(ring->nodes);
+
+	ring->nodes = nodes;
+	ring->mask  = capacity - 1;
+	ring->head  = 0;
+}
 
-static struct Queue lightQueue;
-static struct Queue unlightQueue;
+static void LightRing_Push(struct LightRing* ring, LightNode node) {
+	if (ring->count > ring->mask) LightRing_Grow(ring);
+	ring->nodes[(ring->head + ring->count) & ring->mask] = node;
+	ring->count++;
+}
+
+static LightNode LightRing_Pop(struct LightRing* ring) {
+	LightNode node = ring->nodes[ring->head];
+	ring->head = (ring->head + 1) & ring->mask;
+	ring->count--;
+	return node;
+}
+
+static struct LightRing lightQueue;
+static struct LightRing unlightQueue;
 
 /* Top face, X face, Z face, bottomY face*/
 #define PALETTE_SHADES 4
@@ -45,7 +97,15 @@ static cc_uint8* chunkLightingDataFlags;
 #define CHUNK_UNCALCULATED 0
 #define CHUNK_SELF_CALCULATED 1
 #define CHUNK_ALL_CALCULATED 2
+/* Light data for each chunk, or NULL when every cell in the chunk has the same light data */
 static LightingChunk* chunkLightingData;
+/* Light data for every cell in each chunk that has no per-cell light data */
+static cc_uint8* chunkLightingUniform;
+/* Number of bits used for each cell in the per-cell light data of each chunk */
+/* 8 bits is the light data itself, otherwise the per-cell light data starts with a palette of */
+/*  (1 << bits) light data values, followed by the index into that palette for each cell */
+static cc_uint8* chunkLightingBits;
+#define LIGHT_DENSE_BITS 8
 
 #define MakePaletteIndex(lampLevel, lavaLevel) ((lampLevel << FANCY_LIGHTING_LAMP_SHIFT) | lavaLevel)
 /* Fill in a palette with values based on the current light colors, shaded by the given shade value and lightened by the given ambientColor */
@@ -102,6 +162,7 @@ static void FreePalettes(void) {
 }
 
 static int chunksCount;
+static void CalculateAllChunksLighting(void);
 static void AllocState(void) {
 	ClassicLighting_AllocState();
 	InitPalettes();
@@ -109,8 +170,11 @@ static void AllocState(void) {
 
 	chunkLightingDataFlags = (cc_uint8*)Mem_AllocCleared(chunksCount, sizeof(cc_uint8), "light flags");
 	chunkLightingData = (LightingChunk*)Mem_AllocCleared(chunksCount, sizeof(LightingChunk), "light chunks");
-	Queue_Init(&lightQueue, sizeof(struct LightNode));
-	Queue_Init(&unlightQueue, sizeof(struct LightNode));
+	chunkLightingUniform = (cc_uint8*)Mem_AllocCleared(chunksCount, sizeof(cc_uint8), "light uniform");
+	chunkLightingBits = (cc_uint8*)Mem_AllocCleared(chunksCount, sizeof(cc_uint8), "light bits");
+	LightRing_Init(&lightQueue);
+	LightRing_Init(&unlightQueue);
+	CalculateAllChunksLighting();
 }
 
 static void FreeState(void) {
@@ -128,10 +192,14 @@ static void FreeState(void) {
 
 	Mem_Free(chunkLightingDataFlags);
 	Mem_Free(chunkLightingData);
+	Mem_Free(chunkLightingUniform);
+	Mem_Free(chunkLightingBits);
 	chunkLightingDataFlags = NULL;
 	chunkLightingData = NULL;
-	Queue_Clear(&lightQueue);
-	Queue_Clear(&unlightQueue);
+	chunkLightingUniform = NULL;
+	chunkLightingBits = NULL;
+	LightRing_Free(&lightQueue);
+	LightRing_Free(&unlightQueue);
 }
 
 /* Converts chunk x/y/z coordinates to the corresponding index in chunks array/list */
@@ -141,6 +209,35 @@ static void FreeState(void) {
 /* Converts global x/y/z coordinates to the corresponding index in a chunk */
 #define GlobalCoordsToChunkCoordsIndex(x, y, z) (LocalCoordsToIndex(x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK))
 
+/* Returns the light data at the given index in a chunk, regardless of how the chunk's light data is stored */
+static CC_INLINE cc_uint8 GetLightData(int chunkIndex, int localIndex) {
+	cc_uint8* data = chunkLightingData[chunkIndex];
+	int bits, bit;
+
+	if (!data) return chunkLightingUniform[chunkIndex];
+	bits = chunkLightingBits[chunkIndex];
+	if (bits == LIGHT_DENSE_BITS) return data[localIndex];
+
+	bit = localIndex * bits;
+	return data[((data[(1 << bits) + (bit >> 3)] >> (bit & 7)) & ((1 << bits) - 1))];
+}
+
+/* Converts the light data of a chunk into one byte of light data per cell, so that cells can be changed */
+static cc_bool ExpandChunk(int chunkIndex) {
+	cc_uint8* data = (cc_uint8*)Mem_TryAlloc(CHUNK_SIZE_3, sizeof(cc_uint8));
+	int i;
+	if (!data) return false;
+
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		data[i] = GetLightData(chunkIndex, i);
+	}
+
+	Mem_Free(chunkLightingData[chunkIndex]);
+	chunkLightingData[chunkIndex] = data;
+	chunkLightingBits[chunkIndex] = LIGHT_DENSE_BITS;
+	return true;
+}
+
 /* Sets the light level at this cell. Does NOT check that the cell is in bounds. */
 static void SetBrightness(cc_uint8 brightness, int x, int y, int z, cc_bool isLamp, cc_bool refreshChunk) {
 	cc_uint8 clearMask, shift = isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0, prevValue;
@@ -149,14 +246,18 @@ static void SetBrightness(cc_uint8 brightness, int x, int y, int z, cc_bool isLa
 	int cz = z >> CHUNK_SHIFT, lz = z & CHUNK_MASK;
 	int chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
 	int localIndex = LocalCoordsToIndex(lx, ly, lz);
-
-	if (chunkLightingData[chunkIndex] == NULL) {
-		chunkLightingData[chunkIndex] = (cc_uint8*)Mem_TryAllocCleared(CHUNK_SIZE_3, sizeof(cc_uint8));
-	}
+	cc_uint8 cur;
 
 	/* 00001111 if lamp, otherwise 11110000*/
 	clearMask = ~(FANCY_LIGHTING_MAX_LEVEL << shift);
 
+	/* Only need one byte of light data per cell once a cell changes */
+	if (chunkLightingData[chunkIndex] == NULL || chunkLightingBits[chunkIndex] != LIGHT_DENSE_BITS) {
+		cur = GetLightData(chunkIndex, localIndex);
+		if (((cur & clearMask) | (brightness << shift)) == cur) return;
+		if (!ExpandChunk(chunkIndex)) return;
+	}
+
 	if (refreshChunk) {
 		prevValue = chunkLightingData[chunkIndex][localIndex];
 
@@ -183,14 +284,76 @@ static cc_uint8 GetBrightness(int x, int y, int z, cc_bool isLamp) {
 	int cx = x >> CHUNK_SHIFT, lx = x & CHUNK_MASK;
 	int cy = y >> CHUNK_SHIFT, ly = y & CHUNK_MASK;
 	int cz = z >> CHUNK_SHIFT, lz = z & CHUNK_MASK;
-	int chunkIndex = ChunkCoordsToIndex(cx, cy, cz), localIndex;
-
-	if (chunkLightingData[chunkIndex] == NULL) { return 0; }
-	localIndex = LocalCoordsToIndex(lx, ly, lz);
+	int chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
+	cc_uint8 lightData = GetLightData(chunkIndex, LocalCoordsToIndex(lx, ly, lz));
 
 	return isLamp ?
-		chunkLightingData[chunkIndex][localIndex] >> FANCY_LIGHTING_LAMP_SHIFT :
-		chunkLightingData[chunkIndex][localIndex] & FANCY_LIGHTING_MAX_LEVEL;
+		lightData >> FANCY_LIGHTING_LAMP_SHIFT :
+		lightData & FANCY_LIGHTING_MAX_LEVEL;
+}
+
+#define PackedChunkSize(bits) ((1 << (bits)) + CHUNK_SIZE_3 * (bits) / 8)
+
+/* Reduces the memory used by the per-cell light data of a chunk when there are only a few different light data values */
+/* (i.e. frees it if every cell has the same light data, or packs it into 1, 2 or 4 bits per cell) */
+static void CompactChunk(int chunkIndex) {
+	cc_uint8* data = chunkLightingData[chunkIndex];
+	cc_uint8* packed;
+	/* lookup stores 1 + index of the light data in the palette, or 0 if not in the palette yet */
+	cc_uint8 lookup[256];
+	cc_uint8 palette[16];
+	int i, bit, count = 0, bits;
+	if (!data || chunkLightingBits[chunkIndex] != LIGHT_DENSE_BITS) return;
+
+	Mem_Set(lookup, 0, sizeof(lookup));
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		if (lookup[data[i]]) continue;
+		if (count == Array_Elems(palette)) return;
+
+		palette[count++] = data[i];
+		lookup[data[i]]  = count;
+	}
+
+	if (count == 1) {
+		chunkLightingUniform[chunkIndex] = data[0];
+		chunkLightingData[chunkIndex]    = NULL;
+		Mem_Free(data);
+		return;
+	}
+
+	bits   = count <= 2 ? 1 : (count <= 4 ? 2 : 4);
+	packed = (cc_uint8*)Mem_TryAllocCleared(PackedChunkSize(bits), sizeof(cc_uint8));
+	if (!packed) return;
+	Mem_Copy(packed, palette, count);
+
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		bit = i * bits;
+		packed[(1 << bits) + (bit >> 3)] |= (lookup[data[i]] - 1) << (bit & 7);
+	}
+
+	chunkLightingData[chunkIndex] = packed;
+	chunkLightingBits[chunkIndex] = bits;
+	Mem_Free(data);
+}
+
+void FancyLighting_GetMemoryUsage(int* denseChunks, int* packedChunks, int* uniformChunks, int* bytes) {
+	int i;
+	*denseChunks = 0; *packedChunks = 0; *uniformChunks = 0; *bytes = 0;
+	if (!chunkLightingData) return;
+
+	for (i = 0; i < chunksCount; i++) {
+		if (!chunkLightingData[i]) {
+			(*uniformChunks)++;
+		} else if (chunkLightingBits[i] == LIGHT_DENSE_BITS) {
+			(*denseChunks)++;
+			*bytes += CHUNK_SIZE_3;
+		} else {
+			(*packedChunks)++;
+			*bytes += PackedChunkSize(chunkLightingBits[i]);
+		}
+	}
+	/* Pointer to the light data, and the flags, uniform light data and bits of each chunk */
+	*bytes += chunksCount * (sizeof(LightingChunk) + 3);
 }
 
 
@@ -215,50 +378,46 @@ static cc_bool CanLightPass(BlockID thisBlock, Face face) {
 	return !Block_IsFaceHidden(BLOCK_STONE, thisBlock, face);
 }
 
-#define Light_TrySpreadInto(axis, AXIS, dir, limit, isLamp, thisFace, thatFace) \
-	if (ln.coords.axis dir ## = limit && \
-		CanLightPass(thisBlock, FACE_ ## AXIS ## thisFace) && \
-		CanLightPass(World_GetBlock(ln.coords.x, ln.coords.y, ln.coords.z), FACE_ ## AXIS ## thatFace) && \
-		GetBrightness(ln.coords.x, ln.coords.y, ln.coords.z, isLamp) < ln.brightness) { \
-		Queue_Enqueue(&lightQueue, &ln); \
-	} \
+/* When spreading is restricted to a single chunk, light that would spread */
+/*  outside of that chunk is instead added to the spilled queue */
+#define Light_TrySpreadInto(nx, ny, nz, thisFace, thatFace) \
+	if (CanLightPass(thisBlock, thisFace) && CanLightPass(World_GetBlock(nx, ny, nz), thatFace)) { \
+		if (chunk && ((nx) >> CHUNK_SHIFT != chunk->x || (ny) >> CHUNK_SHIFT != chunk->y || (nz) >> CHUNK_SHIFT != chunk->z)) { \
+			LightRing_Push(spilled, LightNode_Make(nx, ny, nz, brightness) | lampFlag); \
+		} else if (GetBrightness(nx, ny, nz, isLamp) < brightness) { \
+			LightRing_Push(queue, LightNode_Make(nx, ny, nz, brightness)); \
+		} \
+	}
 
-static void FlushLightQueue(cc_bool isLamp, cc_bool refreshChunk) {
-	struct LightNode ln;
-	cc_uint8 brightnessHere;
+static void FlushLightQueue(struct LightRing* queue, cc_bool isLamp, cc_bool refreshChunk, 
+							const IVec3* chunk, struct LightRing* spilled) {
+	cc_uint64 lampFlag = isLamp ? LIGHTNODE_LAMP_FLAG : 0;
+	cc_uint8 brightness;
 	BlockID thisBlock;
+	LightNode node;
+	int x, y, z;
 
-	while (lightQueue.count > 0) {
-		ln = *(struct LightNode*)(Queue_Dequeue(&lightQueue));
-
-		brightnessHere = GetBrightness(ln.coords.x, ln.coords.y, ln.coords.z, isLamp);
+	while (queue->count > 0) {
+		node = LightRing_Pop(queue);
+		x = LightNode_X(node); y = LightNode_Y(node); z = LightNode_Z(node);
+		brightness = LightNode_Brightness(node);
 
 		/* If this cell is already more lit, we can assume this cell and its neighbors have been accounted for */
-		if (brightnessHere >= ln.brightness) { continue; }
-		if (ln.brightness == 0) { continue; }
-
-		SetBrightness(ln.brightness, ln.coords.x, ln.coords.y, ln.coords.z, isLamp, refreshChunk);
-
-		thisBlock = World_GetBlock(ln.coords.x, ln.coords.y, ln.coords.z);
-		ln.brightness--;
-		if (ln.brightness == 0) continue;
-
-		ln.coords.x--;
-		Light_TrySpreadInto(x, X, > , 0, isLamp, MAX, MIN)
-		ln.coords.x += 2;
-		Light_TrySpreadInto(x, X, < , World.MaxX, isLamp, MIN, MAX)
-		ln.coords.x--;
-
-		ln.coords.y--;
-		Light_TrySpreadInto(y, Y, >, 0, isLamp, MAX, MIN)
-		ln.coords.y += 2;
-		Light_TrySpreadInto(y, Y, <, World.MaxY, isLamp, MIN, MAX)
-		ln.coords.y--;
-
-		ln.coords.z--;
-		Light_TrySpreadInto(z, Z, > , 0, isLamp, MAX, MIN)
-		ln.coords.z += 2;
-		Light_TrySpreadInto(z, Z, < , World.MaxZ, isLamp, MIN, MAX)
+		if (GetBrightness(x, y, z, isLamp) >= brightness) { continue; }
+		if (brightness == 0) { continue; }
+
+		SetBrightness(brightness, x, y, z, isLamp, refreshChunk);
+
+		thisBlock = World_GetBlock(x, y, z);
+		brightness--;
+		if (brightness == 0) continue;
+
+		if (x > 0)          { Light_TrySpreadInto(x - 1, y, z, FACE_XMAX, FACE_XMIN) }
+		if (x < World.MaxX) { Light_TrySpreadInto(x + 1, y, z, FACE_XMIN, FACE_XMAX) }
+		if (y > 0)          { Light_TrySpreadInto(x, y - 1, z, FACE_YMAX, FACE_YMIN) }
+		if (y < World.MaxY) { Light_TrySpreadInto(x, y + 1, z, FACE_YMIN, FACE_YMAX) }
+		if (z > 0)          { Light_TrySpreadInto(x, y, z - 1, FACE_ZMAX, FACE_ZMIN) }
+		if (z < World.MaxZ) { Light_TrySpreadInto(x, y, z + 1, FACE_ZMIN, FACE_ZMAX) }
 	}
 }
 
@@ -267,19 +426,24 @@ cc_uint8 GetBlockBrightness(BlockID curBlock, cc_bool isLamp) {
 	return Blocks.Brightness[curBlock] & FANCY_LIGHTING_MAX_LEVEL;
 }
 
-static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
+/* Spreads light from all the light casting blocks in the given chunk */
+/* If spilled is non NULL, light is only spread within the chunk, and light spreading */
+/*  into other chunks is instead added to spilled (so that it can be spread later) */
+static void CalculateChunkLightingSelf(struct LightRing* queue, int chunkIndex, int cx, int cy, int cz, 
+										struct LightRing* spilled) {
 	int x, y, z;
 	/* Block coordinates */
 	int chunkStartX, chunkStartY, chunkStartZ, chunkEndX, chunkEndY, chunkEndZ;
 	cc_uint8 brightness;
 	BlockID curBlock;
+	IVec3 chunk;
 	chunkStartX = cx * CHUNK_SIZE;
 	chunkStartY = cy * CHUNK_SIZE;
 	chunkStartZ = cz * CHUNK_SIZE;
 	chunkEndX = chunkStartX + CHUNK_SIZE;
 	chunkEndY = chunkStartY + CHUNK_SIZE;
 	chunkEndZ = chunkStartZ + CHUNK_SIZE;
-	struct LightNode entry;
+	chunk.x = cx; chunk.y = cy; chunk.z = cz;
 
 	if (chunkEndX > World.Width ) { chunkEndX = World.Width;  }
 	if (chunkEndY > World.Height) { chunkEndY = World.Height; }
@@ -296,16 +460,14 @@ static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
 					brightness = GetBlockBrightness(curBlock, false);
 
 					if (brightness > 0) {
-						entry = (struct LightNode){ { x, y, z }, brightness };
-						Queue_Enqueue(&lightQueue, &entry);
-						FlushLightQueue(false, false);
+						LightRing_Push(queue, LightNode_Make(x, y, z, brightness));
+						FlushLightQueue(queue, false, false, spilled ? &chunk : NULL, spilled);
 					}
 					else {
 						/* If no lava brightness, it must use lamp brightness */
 						brightness = Blocks.Brightness[curBlock] >> FANCY_LIGHTING_LAMP_SHIFT;
-						entry = (struct LightNode){ { x, y, z }, brightness };
-						Queue_Enqueue(&lightQueue, &entry);
-						FlushLightQueue(true, false);
+						LightRing_Push(queue, LightNode_Make(x, y, z, brightness));
+						FlushLightQueue(queue, true, false,  spilled ? &chunk : NULL, spilled);
 					}
 				}
 
@@ -346,99 +508,171 @@ static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 				curChunkIndex = ChunkCoordsToIndex(x, y, z);
 
 				if (chunkLightingDataFlags[curChunkIndex] == CHUNK_UNCALCULATED) {
-					CalculateChunkLightingSelf(curChunkIndex, x, y, z);
+					CalculateChunkLightingSelf(&lightQueue, curChunkIndex, x, y, z, NULL);
 				}
 			}
 		}
 	}
 	chunkLightingDataFlags[chunkIndex] = CHUNK_ALL_CALCULATED;
+	CompactChunk(chunkIndex);
+}
+
+
+/*########################################################################################################################*
+*----------------------------------------------------Parallel lighting----------------------------------------------------*
+*#########################################################################################################################*/
+/* Lighting for the whole map is calculated upfront in two phases: */
+/*  1) Each worker thread (and the main thread) spreads light within the chunks it is given, */
+/*     setting aside any light that would spread into a neighbouring chunk */
+/*  2) The light set aside is then spread normally on the main thread */
+/* As light always ends up as the brightest value that can reach a cell, */
+/*  this produces the same result as calculating every chunk in order */
+#define LIGHT_MAX_WORKERS 16
+struct LightWorker {
+	struct LightRing queue, spilled;
+};
+/* NOTE: One more than the maximum workers, as the main thread spreads light too */
+static struct LightWorker lightWorkers[LIGHT_MAX_WORKERS + 1];
+static void* lightWorkersMutex;
+static int nextLightWorker, nextLightChunk;
+
+static void LightWorker_Run(void) {
+	struct LightWorker* worker;
+	int chunkIndex, cx, cy, cz;
+
+	Mutex_Lock(lightWorkersMutex);
+	{
+		worker = &lightWorkers[nextLightWorker++];
+	}
+	Mutex_Unlock(lightWorkersMutex);
+
+	for (;;) {
+		Mutex_Lock(lightWorkersMutex);
+		{
+			chunkIndex = nextLightChunk++;
+		}
+		Mutex_Unlock(lightWorkersMutex);
+		if (chunkIndex >= chunksCount) return;
+
+		cx = chunkIndex % World.ChunksX;
+		cz = (chunkIndex / World.ChunksX) % World.ChunksZ;
+		cy = chunkIndex / (World.ChunksX * World.ChunksZ);
+		CalculateChunkLightingSelf(&worker->queue, chunkIndex, cx, cy, cz, &worker->spilled);
+	}
+}
+
+static void CalculateAllChunksLighting(void) {
+	void* threads[LIGHT_MAX_WORKERS];
+	struct LightRing* spilled;
+	LightNode node;
+	int i, workers;
+
+	/* Without any worker threads, lighting is calculated lazily as chunks are built instead, */
+	/*  as calculating the whole map on just the main thread would delay the first frame */
+	workers = Options_GetInt(OPT_LIGHTING_THREADS, 0, LIGHT_MAX_WORKERS, 
+							min(Thread_ProcessorCount() - 1, LIGHT_MAX_WORKERS));
+	if (!workers || !World_HasBlocks()) return;
+
+	lightWorkersMutex = Mutex_Create();
+	nextLightWorker   = 0;
+	nextLightChunk    = 0;
+
+	for (i = 0; i <= workers; i++) {
+		LightRing_Init(&lightWorkers[i].queue);
+		LightRing_Init(&lightWorkers[i].spilled);
+	}
+	for (i = 0; i < workers; i++) {
+		Thread_Run(&threads[i], LightWorker_Run, 128 * 1024, "Lighting");
+	}
+
+	/* Main thread would otherwise just be waiting for the workers */
+	LightWorker_Run();
+	for (i = 0; i < workers; i++) {
+		Thread_Join(threads[i]);
+	}
+	Mutex_Free(lightWorkersMutex);
+
+	/* Now spread the light that crossed chunk borders */
+	for (i = 0; i <= workers; i++) {
+		spilled = &lightWorkers[i].spilled;
+
+		while (spilled->count > 0) {
+			node = LightRing_Pop(spilled);
+			LightRing_Push(&lightQueue, node & ~LIGHTNODE_LAMP_FLAG);
+			FlushLightQueue(&lightQueue, (node & LIGHTNODE_LAMP_FLAG) != 0, false, NULL, NULL);
+		}
+		LightRing_Free(&lightWorkers[i].queue);
+		LightRing_Free(spilled);
+	}
+
+	Mem_Set(chunkLightingDataFlags, CHUNK_ALL_CALCULATED, chunksCount);
+	for (i = 0; i < chunksCount; i++) {
+		CompactChunk(i);
+	}
 }
 
 
-#define Light_TryUnSpreadInto(axis, dir, limit, AXIS, thisFace, thatFace) \
-		if (neighborCoords.axis dir ## = limit && \
-			CanLightPass(thisBlock, FACE_ ## AXIS ## thisFace) && \
-			CanLightPass(World_GetBlock(neighborCoords.x, neighborCoords.y, neighborCoords.z), FACE_ ## AXIS ## thatFace) \
-		) \
-		{ \
-			neighborBrightness = GetBrightness(neighborCoords.x, neighborCoords.y, neighborCoords.z, isLamp); \
-			neighborBlockBrightness = GetBlockBrightness(World_GetBlock(neighborCoords.x, neighborCoords.y, neighborCoords.z), isLamp); \
-			/* This spot is a light caster, mark this spot as needing to be re-spread */ \
-			if (neighborBlockBrightness > 0) { \
-				otherNode = (struct LightNode){ { neighborCoords.x, neighborCoords.y, neighborCoords.z }, neighborBlockBrightness }; \
-				Queue_Enqueue(&lightQueue, &otherNode); \
+/*########################################################################################################################*
+*----------------------------------------------------Lighting updates-----------------------------------------------------*
+*#########################################################################################################################*/
+#define Light_TryUnSpreadInto(nx, ny, nz, thisFace, thatFace) \
+	if (CanLightPass(thisBlock, thisFace) && CanLightPass(World_GetBlock(nx, ny, nz), thatFace)) { \
+		neighborBrightness      = GetBrightness(nx, ny, nz, isLamp); \
+		neighborBlockBrightness = GetBlockBrightness(World_GetBlock(nx, ny, nz), isLamp); \
+		/* This spot is a light caster, mark this spot as needing to be re-spread */ \
+		if (neighborBlockBrightness > 0) { \
+			LightRing_Push(&lightQueue, LightNode_Make(nx, ny, nz, neighborBlockBrightness)); \
+		} \
+		if (neighborBrightness > 0) { \
+			/* This neighbor is darker than cur spot, darken it*/ \
+			if (neighborBrightness < brightness) { \
+				SetBrightness(0, nx, ny, nz, isLamp, true); \
+				LightRing_Push(&unlightQueue, LightNode_Make(nx, ny, nz, neighborBrightness)); \
 			} \
-			if (neighborBrightness > 0) { \
-				/* This neighbor is darker than cur spot, darken it*/ \
-				if (neighborBrightness < curNode.brightness) { \
-					SetBrightness(0, neighborCoords.x, neighborCoords.y, neighborCoords.z, isLamp, true); \
-					otherNode = (struct LightNode){ { neighborCoords.x, neighborCoords.y, neighborCoords.z }, neighborBrightness }; \
-					Queue_Enqueue(&unlightQueue, &otherNode); \
-				} \
-				/* This neighbor is brighter or same, mark this spot as needing to be re-spread */ \
-				else { \
-					/* But only if the neighbor actually *can* spread to this block */ \
-					if ( \
-						CanLightPass(thisBlockTrue, FACE_ ## AXIS ## thisFace) && \
-						CanLightPass(World_GetBlock(neighborCoords.x, neighborCoords.y, neighborCoords.z), FACE_ ## AXIS ## thatFace) \
-					) \
-					{ \
-						otherNode = curNode; \
-						otherNode.brightness = neighborBrightness-1; \
-						Queue_Enqueue(&lightQueue, &otherNode); \
-					} \
-				} \
+			/* This neighbor is brighter or same, mark this spot as needing to be re-spread */ \
+			/* But only if the neighbor actually *can* spread to this block */ \
+			else if (CanLightPass(thisBlockTrue, thisFace) && CanLightPass(World_GetBlock(nx, ny, nz), thatFace)) { \
+				LightRing_Push(&lightQueue, LightNode_Make(x, y, z, neighborBrightness - 1)); \
 			} \
 		} \
+	}
 
 /* Spreads darkness out from this point and relights any necessary areas afterward */
 static void CalcUnlight(int x, int y, int z, cc_uint8 brightness, cc_bool isLamp) {
 	int count = 0;
-	struct LightNode curNode, otherNode;
 	cc_uint8 neighborBrightness, neighborBlockBrightness;
-	IVec3 neighborCoords;
 	BlockID thisBlockTrue, thisBlock;
+	LightNode node;
 
 	SetBrightness(0, x, y, z, isLamp, true);
-	curNode = (struct LightNode){ { x, y, z }, brightness };
-	Queue_Enqueue(&unlightQueue, &curNode);
+	LightRing_Push(&unlightQueue, LightNode_Make(x, y, z, brightness));
 
 	while (unlightQueue.count > 0) {
-		curNode = *(struct LightNode*)(Queue_Dequeue(&unlightQueue));
-		neighborCoords = curNode.coords;
+		node = LightRing_Pop(&unlightQueue);
+		x = LightNode_X(node); y = LightNode_Y(node); z = LightNode_Z(node);
+		brightness = LightNode_Brightness(node);
 
-		thisBlockTrue = World_GetBlock(neighborCoords.x, neighborCoords.y, neighborCoords.z);
+		thisBlockTrue = World_GetBlock(x, y, z);
 		/* For the original cell in the queue, assume this block is air
 		so that light can unspread "out" of it in the case of a solid blocks. */
 		thisBlock = count == 0 ? BLOCK_AIR : thisBlockTrue;
 
 		count++;
 
-		neighborCoords.x--;
-		Light_TryUnSpreadInto(x, >, 0, X, MAX, MIN)
-		neighborCoords.x += 2;
-		Light_TryUnSpreadInto(x, <, World.MaxX, X, MIN, MAX)
-		neighborCoords.x--;
-
-		neighborCoords.y--;
-		Light_TryUnSpreadInto(y, >, 0, Y, MAX, MIN)
-		neighborCoords.y += 2;
-		Light_TryUnSpreadInto(y, <, World.MaxY, Y, MIN, MAX)
-		neighborCoords.y--;
-
-		neighborCoords.z--;
-		Light_TryUnSpreadInto(z, >, 0, Z, MAX, MIN)
-		neighborCoords.z += 2;
-		Light_TryUnSpreadInto(z, <, World.MaxZ, Z, MIN, MAX)
+		if (x > 0)          { Light_TryUnSpreadInto(x - 1, y, z, FACE_XMAX, FACE_XMIN) }
+		if (x < World.MaxX) { Light_TryUnSpreadInto(x + 1, y, z, FACE_XMIN, FACE_XMAX) }
+		if (y > 0)          { Light_TryUnSpreadInto(x, y - 1, z, FACE_YMAX, FACE_YMIN) }
+		if (y < World.MaxY) { Light_TryUnSpreadInto(x, y + 1, z, FACE_YMIN, FACE_YMAX) }
+		if (z > 0)          { Light_TryUnSpreadInto(x, y, z - 1, FACE_ZMAX, FACE_ZMIN) }
+		if (z < World.MaxZ) { Light_TryUnSpreadInto(x, y, z + 1, FACE_ZMIN, FACE_ZMAX) }
 	}
 
-	FlushLightQueue(isLamp, true);
+	FlushLightQueue(&lightQueue, isLamp, true, NULL, NULL);
 }
 static void CalcBlockChange(int x, int y, int z, BlockID oldBlock, BlockID newBlock, cc_bool isLamp) {
 	cc_uint8 oldBlockLightLevel = GetBlockBrightness(oldBlock, isLamp);
 	cc_uint8 newBlockLightLevel = GetBlockBrightness(newBlock, isLamp);
 	cc_uint8 oldLightLevelHere = GetBrightness(x, y, z, isLamp);
-	struct LightNode entry;
 
 	/* Cell has no lighting and new block doesn't cast light and blocks all light, no change */
 	if (!oldLightLevelHere && !newBlockLightLevel && IsFullOpaque(newBlock)) return;
@@ -446,9 +680,8 @@ static void CalcBlockChange(int x, int y, int z, BlockID oldBlock, BlockID newBl
 	/* Cell is darker than the new block, only brighter case */
 	if (oldLightLevelHere < newBlockLightLevel) {
 		/* brighten this spot, recalculate lighting */
-		entry = (struct LightNode){ { x, y, z }, newBlockLightLevel };
-		Queue_Enqueue(&lightQueue, &entry);
-		FlushLightQueue(isLamp, true);
+		LightRing_Push(&lightQueue, LightNode_Make(x, y, z, newBlockLightLevel));
+		FlushLightQueue(&lightQueue, isLamp, true, NULL, NULL);
 		return;
 	}
 
@@ -493,13 +726,9 @@ static PackedCol Color_Core(int x, int y, int z, int paletteFace) {
 	chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
 	CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
 
-	/* There might be no light data in this chunk even after it was calculated */
-	if (chunkLightingData[chunkIndex] == NULL) {
-		lightData = 0;
-	} else {
-		chunkCoordsIndex = GlobalCoordsToChunkCoordsIndex(x, y, z);
-		lightData = chunkLightingData[chunkIndex][chunkCoordsIndex];
-	}
+	/* There might be no per-cell light data in this chunk even after it was calculated */
+	chunkCoordsIndex = GlobalCoordsToChunkCoordsIndex(x, y, z);
+	lightData = GetLightData(chunkIndex, chunkCoordsIndex);
 
 	/* This cell is exposed to sunlight */
 	if (y > ClassicLighting_GetLightHeight(x, z)) {
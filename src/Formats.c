@@ -26,13 +26,86 @@ static struct MapImporter* imp_tail;
 /*########################################################################################################################*
 *--------------------------------------------------------General----------------------------------------------------------*
 *#########################################################################################################################*/
-static cc_result Map_ReadBlocks(struct Stream* stream) {
+/* Replaces every block with its corresponding block in the given table */
+static void Map_ConvertBlocks(BlockRaw* blocks, int count, const BlockRaw* table) {
+	int i;
+	/* Bulk convert 4 blocks at once */
+	for (i = 0; i < (count & ~3); i += 4) {
+		*blocks = table[*blocks]; blocks++;
+		*blocks = table[*blocks]; blocks++;
+		*blocks = table[*blocks]; blocks++;
+		*blocks = table[*blocks]; blocks++;
+	}
+	for (; i < count; i++) {
+		*blocks = table[*blocks]; blocks++;
+	}
+}
+
+#ifdef CC_BUILD_CHUNKEDWORLD
+/* Converts the blocks into chunks as they are read, so only CHUNK_SIZE rows of blocks are in memory at once */
+static cc_result Map_ReadBlocks(struct Stream* stream, const BlockRaw* table) {
+	BlockRaw* blocks;
+	int y, count;
+	cc_result res = 0;
+
+	if (!World_AllocChunks(World.Width, World.Height, World.Length)) return ERR_OUT_OF_MEMORY;
+	blocks = (BlockRaw*)Mem_TryAlloc(World.OneY, CHUNK_SIZE);
+	if (!blocks) return ERR_OUT_OF_MEMORY;
+
+	for (y = 0; y < World.Height; y += CHUNK_SIZE) {
+		count = min(World.Height - y, CHUNK_SIZE) * World.OneY;
+		if ((res = Stream_Read(stream, blocks, count))) break;
+
+		if (table) Map_ConvertBlocks(blocks, count, table);
+		if (!World_ConvertChunkLayer(y >> CHUNK_SHIFT, blocks)) { res = ERR_OUT_OF_MEMORY; break; }
+	}
+
+	Mem_Free(blocks);
+	return res;
+}
+#else
+static cc_result Map_ReadBlocks(struct Stream* stream, const BlockRaw* table) {
+	cc_result res;
 	World.Volume = World.Width * World.Length * World.Height;
 	World.Blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
 
 	if (!World.Blocks) return ERR_OUT_OF_MEMORY;
-	return Stream_Read(stream, World.Blocks, World.Volume);
+	if ((res = Stream_Read(stream, World.Blocks, World.Volume))) return res;
+
+	if (table) Map_ConvertBlocks(World.Blocks, World.Volume, table);
+	return 0;
 }
+#endif
+
+#ifdef CC_BUILD_CHUNKEDWORLD
+/* Writes either the lower or upper 8 bits of every block in the world */
+static cc_result Map_WriteBlocks(struct Stream* stream, int shift) {
+	BlockRaw buffer[4096];
+	BlockID row[4096];
+	int x, y, z, i, count;
+	cc_result res;
+
+	for (y = 0; y < World.Height; y++) {
+		for (z = 0; z < World.Length; z++) {
+			for (x = 0; x < World.Width; x += count) {
+				count = min(World.Width - x, (int)Array_Elems(row));
+				World_GetBlockRow(x, y, z, count, row);
+
+				for (i = 0; i < count; i++) buffer[i] = (BlockRaw)(row[i] >> shift);
+				if ((res = Stream_Write(stream, buffer, count))) return res;
+			}
+		}
+	}
+	return 0;
+}
+#define Map_WriteLowerBlocks(stream) Map_WriteBlocks(stream, 0)
+#define Map_WriteUpperBlocks(stream) Map_WriteBlocks(stream, 8)
+#define Map_HasUpperBlocks() (World.IDMask > 0xFF)
+#else
+#define Map_WriteLowerBlocks(stream) Stream_Write(stream, World.Blocks,  World.Volume)
+#define Map_WriteUpperBlocks(stream) Stream_Write(stream, World.Blocks2, World.Volume)
+#define Map_HasUpperBlocks() (World.Blocks != World.Blocks2)
+#endif
 
 static cc_result Map_SkipGZipHeader(struct Stream* stream) {
 	struct GZipHeader gzHeader;
@@ -70,7 +143,8 @@ cc_result Map_LoadFrom(const cc_string* path) {
 	Game_Reset();
 	
 	spawn_point = &update;
-	res = Stream_OpenFile(&stream, path);
+	/* Mapping the file lets importers decompress straight out of the OS's file cache */
+	res = Stream_OpenMapped(&stream, path);
 	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
 
 	imp = MapImporter_Find(path);
@@ -136,14 +210,17 @@ static const cc_uint8 Lvl_table[256] = {
 static cc_result Lvl_ReadCustomBlocks(struct Stream* stream) {	
 	cc_uint8 chunk[LVL_CHUNKSIZE * LVL_CHUNKSIZE * LVL_CHUNKSIZE];
 	cc_uint8 hasCustom;
-	int baseIndex, index, xx, yy, zz;
+	int xx, yy, zz;
 	cc_result res;
 	int x, y, z, i;
+#ifndef CC_BUILD_CHUNKEDWORLD
+	int baseIndex, index;
 
 	/* skip bounds checks when we know chunk is entirely inside map */
 	int adjWidth  = World.Width  & ~0x0F;
 	int adjHeight = World.Height & ~0x0F;
 	int adjLength = World.Length & ~0x0F;
+#endif
 
 	for (y = 0; y < World.Height; y += LVL_CHUNKSIZE) {
 		for (z = 0; z < World.Length; z += LVL_CHUNKSIZE) {
@@ -152,6 +229,16 @@ static cc_result Lvl_ReadCustomBlocks(struct Stream* stream) {
 				if ((res = stream->ReadU8(stream, &hasCustom))) return res;
 				if (hasCustom != 1) continue;
 				if ((res = Stream_Read(stream, chunk, sizeof(chunk)))) return res;
+#ifdef CC_BUILD_CHUNKEDWORLD
+				/* Map_ReadBlocks has already converted the blocks into chunks */
+				for (i = 0; i < sizeof(chunk); i++) {
+					xx = x + (i & 0xF); yy = y + ((i >> 8) & 0xF); zz = z + ((i >> 4) & 0xF);
+					if (!World_Contains(xx, yy, zz) || World_GetBlock(xx, yy, zz) != LVL_CUSTOMTILE) continue;
+
+					World_SetBlock(xx, yy, zz, chunk[i]);
+					if (!World_HasBlocks()) return ERR_OUT_OF_MEMORY;
+				}
+#else
 				baseIndex = World_Pack(x, y, z);
 
 				if ((x + LVL_CHUNKSIZE) <= adjWidth && (y + LVL_CHUNKSIZE) <= adjHeight && (z + LVL_CHUNKSIZE) <= adjLength) {
@@ -170,6 +257,7 @@ static cc_result Lvl_ReadCustomBlocks(struct Stream* stream) {
 						World.Blocks[index] = World.Blocks[index] == LVL_CUSTOMTILE ? chunk[i] : World.Blocks[index];
 					}
 				}
+#endif
 			}
 		}
 	}
@@ -180,10 +268,8 @@ static cc_result Lvl_ReadCustomBlocks(struct Stream* stream) {
 /* Used by MCSharp/MCLawl/MCForge/MCDzienny/MCGalaxy */
 static cc_result Lvl_Load(struct Stream* stream) {
 	cc_uint8 header[18];
-	cc_uint8* blocks;
 	cc_uint8 section;
 	cc_result res;
-	int i;
 
 	struct Stream compStream;
 	struct InflateState state;
@@ -205,18 +291,7 @@ static cc_result Lvl_Load(struct Stream* stream) {
 	spawn_point->pitch = Math_Packed2Deg(header[15]);
 	/* (2) pervisit, perbuild permissions */
 
-	if ((res = Map_ReadBlocks(&compStream))) return res;
-	blocks = World.Blocks;
-	/* Bulk convert 4 blocks at once */
-	for (i = 0; i < (World.Volume & ~3); i += 4) {
-		*blocks = Lvl_table[*blocks]; blocks++;
-		*blocks = Lvl_table[*blocks]; blocks++;
-		*blocks = Lvl_table[*blocks]; blocks++;
-		*blocks = Lvl_table[*blocks]; blocks++;
-	}
-	for (; i < World.Volume; i++) {
-		*blocks = Lvl_table[*blocks]; blocks++;
-	}
+	if ((res = Map_ReadBlocks(&compStream, Lvl_table))) return res;
 
 	/* 0xBD section type is not present in older .lvl files */
 	res = compStream.ReadU8(&compStream, &section);
@@ -304,7 +379,7 @@ static cc_result Fcm_Load(struct Stream* stream) {
 		if ((res = Fcm_ReadString(&compStream))) return res; /* Value */
 	}
 
-	return Map_ReadBlocks(&compStream);
+	return Map_ReadBlocks(&compStream, NULL);
 }
 
 
@@ -1282,7 +1357,7 @@ static cc_result Dat_LoadFormat1(struct Stream* stream) {
 	World.Width  = Stream_GetU16_BE(header +  8);
 	World.Length = Stream_GetU16_BE(header + 10);
 	World.Height = Stream_GetU16_BE(header + 12);
-	return Map_ReadBlocks(stream);
+	return Map_ReadBlocks(stream, NULL);
 }
 
 static cc_result Dat_LoadFormat2(struct Stream* stream) {
@@ -1603,15 +1678,15 @@ cc_result Cw_Save(struct Stream* stream) {
 	cur = Nbt_WriteArray(cur, "BlockArray", World.Volume);
 
 	if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
-	if ((res = Stream_Write(stream, World.Blocks, World.Volume)))  return res;
+	if ((res = Map_WriteLowerBlocks(stream)))                      return res;
 
 #ifdef EXTENDED_BLOCKS
-	if (World.Blocks != World.Blocks2) {
+	if (Map_HasUpperBlocks()) {
 		cur = buffer;
 		cur = Nbt_WriteArray(cur, "BlockArray2", World.Volume);
 
 		if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
-		if ((res = Stream_Write(stream, World.Blocks2, World.Volume))) return res;
+		if ((res = Map_WriteUpperBlocks(stream)))                      return res;
 	}
 #endif
 
@@ -1711,7 +1786,7 @@ cc_result Schematic_Save(struct Stream* stream) {
 		Stream_SetU32_BE(&tmp[74], World.Volume);
 	}
 	if ((res = Stream_Write(stream, tmp, sizeof(sc_begin)))) return res;
-	if ((res = Stream_Write(stream, World.Blocks, World.Volume))) return res;
+	if ((res = Map_WriteLowerBlocks(stream)))                return res;
 
 	Mem_Copy(tmp, sc_data, sizeof(sc_data));
 	{
@@ -40,6 +40,8 @@
 #include "SystemFonts.h"
 #include "Formats.h"
 #include "EntityRenderers.h"
+#include "Benchmark.h"
+#include "Profiler.h"
 
 struct _GameData Game;
 cc_uint64 Game_FrameStart;
@@ -50,7 +52,7 @@ int Game_ViewDistance     = DEFAULT_VIEWDIST;
 int Game_UserViewDistance = DEFAULT_VIEWDIST;
 int Game_MaxViewDistance  = DEFAULT_MAX_VIEWDIST;
 
-int     Game_FpsLimit, Game_Vertices;
+int     Game_FpsLimit, Game_Vertices, Game_DrawCalls;
 cc_bool Game_SimpleArmsAnim;
 static cc_bool gameRunning;
 
@@ -452,6 +454,8 @@ static void Game_Load(void) {
 	Game_AddComponent(&AxisLinesRenderer_Component);
 	Game_AddComponent(&Formats_Component);
 	Game_AddComponent(&EntityRenderers_Component);
+	Game_AddComponent(&Benchmark_Component);
+	Game_AddComponent(&Profiler_Component);
 
 	LoadPlugins();
 	for (comp = comps_head; comp; comp = comp->next) {
@@ -487,22 +491,48 @@ static void UpdateViewMatrix(void) {
 	FrustumCulling_CalcFrustumEquations(&Gfx.Projection, &Gfx.View);
 }
 
+static void RenderTranslucent(float delta) {
+	Profiler_Begin(PROFILE_MAP_TRANSLUCENT);
+	MapRenderer_RenderTranslucent(delta);
+	Profiler_End(PROFILE_MAP_TRANSLUCENT);
+}
+
 static void Render3DFrame(float delta, float t) {
 	Vec3 pos;
 	Gfx_LoadMatrix(MATRIX_PROJECTION, &Gfx.Projection);
 	Gfx_LoadMatrix(MATRIX_VIEW,       &Gfx.View);
-	if (EnvRenderer_ShouldRenderSkybox()) EnvRenderer_RenderSkybox();
+	if (EnvRenderer_ShouldRenderSkybox()) {
+		Profiler_Begin(PROFILE_SKY);
+		EnvRenderer_RenderSkybox();
+		Profiler_End(PROFILE_SKY);
+	}
 
 	AxisLinesRenderer_Render();
+	Profiler_Begin(PROFILE_ENTITIES);
 	Entities_RenderModels(delta, t);
 	EntityNames_Render();
+	Profiler_End(PROFILE_ENTITIES);
 
+	Profiler_Begin(PROFILE_PARTICLES);
 	Particles_Render(t);
+	Profiler_End(PROFILE_PARTICLES);
+
+	Profiler_Begin(PROFILE_SKY);
 	EnvRenderer_RenderSky();
 	EnvRenderer_RenderClouds();
+	Profiler_End(PROFILE_SKY);
+
+	Profiler_Begin(PROFILE_MAP_UPDATE);
+	if (Benchmark_Enabled) {
+		Benchmark_UpdateMap(delta);
+	} else {
+		MapRenderer_Update(delta);
+	}
+	Profiler_End(PROFILE_MAP_UPDATE);
 
-	MapRenderer_Update(delta);
+	Profiler_Begin(PROFILE_MAP_NORMAL);
 	MapRenderer_RenderNormal(delta);
+	Profiler_End(PROFILE_MAP_NORMAL);
 	EnvRenderer_RenderMapSides();
 
 	EntityShadows_Render();
@@ -513,11 +543,11 @@ static void Render3DFrame(float delta, float t) {
 	/* Render water over translucent blocks when under the water outside the map for proper alpha blending */
 	pos = Camera.CurrentPos;
 	if (pos.y < Env.EdgeHeight && (pos.x < 0 || pos.z < 0 || pos.x > World.Width || pos.z > World.Length)) {
-		MapRenderer_RenderTranslucent(delta);
+		RenderTranslucent(delta);
 		EnvRenderer_RenderMapEdges();
 	} else {
 		EnvRenderer_RenderMapEdges();
-		MapRenderer_RenderTranslucent(delta);
+		RenderTranslucent(delta);
 	}
 
 	/* Need to render again over top of translucent block, as the selection outline */
@@ -621,7 +651,9 @@ static CC_INLINE void Game_DrawFrame(float delta, float t) {
 	}
 
 	Gfx_Begin2D(Game.Width, Game.Height);
+	Profiler_Begin(PROFILE_GUI);
 	Gui_RenderGui(delta);
+	Profiler_End(PROFILE_GUI);
 	OnscreenKeyboard_Draw3D();
 /* TODO find a better solution than this */
 #ifdef CC_BUILD_3DS
@@ -668,7 +700,8 @@ static CC_INLINE void Game_RenderFrame(double delta) {
 	Gfx_BeginFrame();
 	Gfx_BindIb(Gfx_defaultIb);
 	Game.Time += delta;
-	Game_Vertices = 0;
+	Game_Vertices  = 0;
+	Game_DrawCalls = 0;
 
 	if (Input.Sources & INPUT_SOURCE_GAMEPAD) Gamepad_Tick(delta);
 	Camera.Active->UpdateMouse(Entities.CurPlayer, delta);
@@ -679,7 +712,10 @@ static CC_INLINE void Game_RenderFrame(double delta) {
 		InputHandler_SetFOV(Camera.ZoomFov);
 	}
 
+	Profiler_Begin(PROFILE_TASKS);
 	PerformScheduledTasks(delta);
+	Profiler_End(PROFILE_TASKS);
+	if (Benchmark_Enabled) Benchmark_BeginFrame();
 	entTask = tasks[entTaskI];
 	t = (float)(entTask.accumulator / entTask.interval);
 	LocalPlayer_SetInterpPosition(Entities.CurPlayer, t);
@@ -719,6 +755,8 @@ static CC_INLINE void Game_RenderFrame(double delta) {
 
 	if (Game_ScreenshotRequested) Game_TakeScreenshot();
 	Gfx_EndFrame();
+	if (Benchmark_Enabled) Benchmark_EndFrame();
+	Profiler_EndFrame(delta);
 }
 
 static void Game_Free(void* obj) {
@@ -47,6 +47,8 @@ extern int Game_UserViewDistance;
 extern int     Game_FpsLimit;
 extern cc_bool Game_SimpleArmsAnim;
 extern int     Game_Vertices;
+/* Number of map draw calls issued in the current frame */
+extern int     Game_DrawCalls;
 
 extern cc_bool Game_ClassicMode;
 extern cc_bool Game_ClassicHacks;
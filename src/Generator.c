@@ -7,6 +7,8 @@
 #include "Utils.h"
 #include "Game.h"
 #include "Window.h"
+#include "Options.h"
+#include "Benchmark.h"
 
 const struct MapGenerator* Gen_Active;
 BlockRaw* Gen_Blocks;
@@ -231,12 +233,193 @@ static float CombinedNoise_Calc(const struct CombinedNoise* n, float x, float y)
 }
 
 
+/*########################################################################################################################*
+*------------------------------------------------Batched noise generation-------------------------------------------------*
+*#########################################################################################################################*/
+/* Evaluates noise for a row of X coordinates that all share the same Y coordinate. */
+/* Since Y is the same for every point, its floor and fade only need to be calculated once per octave, */
+/*  and with SSE2 the remaining per point arithmetic is performed on 4 points at once. */
+/* NOTE: The arithmetic is performed in exactly the same order as ImprovedNoise_Calc, */
+/*  so the results are bit for bit identical to evaluating each point individually. */
+#define NOISE_ROW_SIZE 64
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISE_SSE2
+/* Grad components for each hash value, i.e. the unpacked values of xFlags and yFlags */
+static const float gradX[16] = { 1,-1, 1,-1, 1,-1, 1,-1, 0, 0, 0, 0, 1, 0,-1, 0 };
+static const float gradY[16] = { 1, 1,-1,-1, 0, 0, 0, 0, 1,-1, 1,-1, 1,-1, 1,-1 };
+
+static void ImprovedNoise_AddRow4(const cc_uint8* p, const float* xs, float freq, int Y, float y, float v,
+								float amplitude, float* sum) {
+	int xFloors[4];
+	float gx22[4], gy22[4], gx12[4], gy12[4];
+	float gx21[4], gy21[4], gx11[4], gy11[4];
+	__m128 x, u, xm1, g22, g12, g21, g11, c1, c2, res;
+	__m128i xFloor;
+	int i, X, A, B, hash;
+
+	x = _mm_mul_ps(_mm_loadu_ps(xs), _mm_set1_ps(freq));
+	/* x >= 0 ? (int)x : (int)x - 1 */
+	xFloor = _mm_cvttps_epi32(x);
+	xFloor = _mm_add_epi32(xFloor, _mm_castps_si128(_mm_cmplt_ps(x, _mm_setzero_ps())));
+	_mm_storeu_si128((__m128i*)xFloors, xFloor);
+	x = _mm_sub_ps(x, _mm_cvtepi32_ps(xFloor));
+
+	/* Fade(x) */
+	u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(x, x), x), 
+		_mm_add_ps(_mm_mul_ps(x, _mm_sub_ps(_mm_mul_ps(x, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10)));
+
+	/* Permutation table lookups can't be vectorised with just SSE2 */
+	for (i = 0; i < 4; i++) {
+		X = xFloors[i] & 0xFF;
+		A = p[X] + Y; B = p[X + 1] + Y;
+
+		hash = p[p[A]]     & 0xF; gx22[i] = gradX[hash]; gy22[i] = gradY[hash];
+		hash = p[p[B]]     & 0xF; gx12[i] = gradX[hash]; gy12[i] = gradY[hash];
+		hash = p[p[A + 1]] & 0xF; gx21[i] = gradX[hash]; gy21[i] = gradY[hash];
+		hash = p[p[B + 1]] & 0xF; gx11[i] = gradX[hash]; gy11[i] = gradY[hash];
+	}
+	xm1 = _mm_sub_ps(x, _mm_set1_ps(1));
+
+#define NOISE_GRAD(gx, gy, xx, yy) _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx), xx), _mm_mul_ps(_mm_loadu_ps(gy), _mm_set1_ps(yy)))
+	g22 = NOISE_GRAD(gx22, gy22, x,   y);
+	g12 = NOISE_GRAD(gx12, gy12, xm1, y);
+	c1  = _mm_add_ps(g22, _mm_mul_ps(u, _mm_sub_ps(g12, g22)));
+
+	g21 = NOISE_GRAD(gx21, gy21, x,   y - 1);
+	g11 = NOISE_GRAD(gx11, gy11, xm1, y - 1);
+	c2  = _mm_add_ps(g21, _mm_mul_ps(u, _mm_sub_ps(g11, g21)));
+
+	res = _mm_add_ps(c1, _mm_mul_ps(_mm_set1_ps(v), _mm_sub_ps(c2, c1)));
+	_mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), _mm_mul_ps(res, _mm_set1_ps(amplitude))));
+}
+#endif
+
+/* Adds the noise at (xs[i] * freq, y) multiplied by amplitude to sum[i], for each point in the row */
+static void ImprovedNoise_AddRow(const cc_uint8* p, const float* xs, float freq, float y, 
+								float amplitude, float* sum, int count) {
+	int i = 0;
+#ifdef NOISE_SSE2
+	int yFloor, Y;
+	float yFrac, v;
+
+	yFloor = y >= 0 ? (int)y : (int)y - 1;
+	Y      = yFloor & 0xFF;
+	yFrac  = y - yFloor;
+	v      = yFrac * yFrac * yFrac * (yFrac * (yFrac * 6 - 15) + 10); /* Fade(y) */
+
+	for (; i + 4 <= count; i += 4) {
+		ImprovedNoise_AddRow4(p, xs + i, freq, Y, yFrac, v, amplitude, sum + i);
+	}
+#endif
+	for (; i < count; i++) {
+		sum[i] += ImprovedNoise_Calc(p, xs[i] * freq, y) * amplitude;
+	}
+}
+
+/* Calculates OctaveNoise_Calc(n, xs[i], y) for each point in the row */
+static void OctaveNoise_CalcRow(const struct OctaveNoise* n, const float* xs, float y, float* out, int count) {
+	float amplitude = 1, freq = 1;
+	int i;
+	for (i = 0; i < count; i++) { out[i] = 0; }
+
+	for (i = 0; i < n->octaves; i++) {
+		ImprovedNoise_AddRow(n->p[i], xs, freq, y * freq, amplitude, out, count);
+		amplitude *= 2.0f;
+		freq *= 0.5f;
+	}
+}
+
+/* Calculates CombinedNoise_Calc(n, xs[i], y) for each point in the row */
+/* NOTE: count must be <= NOISE_ROW_SIZE */
+static void CombinedNoise_CalcRow(const struct CombinedNoise* n, const float* xs, float y, float* out, int count) {
+	float offsetXs[NOISE_ROW_SIZE];
+	int i;
+	OctaveNoise_CalcRow(&n->noise2, xs, y, offsetXs, count);
+
+	for (i = 0; i < count; i++) { offsetXs[i] += xs[i]; }
+	OctaveNoise_CalcRow(&n->noise1, offsetXs, y, out, count);
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Parallel row stages---------------------------------------------------*
+*#########################################################################################################################*/
+/* Generation stages where each column only depends on its own coordinates are split into */
+/*  batches of rows along the Z axis, which are then processed by several threads at once. */
+/* The output is therefore identical, regardless of how many threads are used. */
+typedef void (*GenRowsFunc)(int zBeg, int zEnd);
+#define GEN_ROWS_PER_BATCH 16
+#define GEN_MAX_WORKERS    16
+
+static int gen_workers;
+static GenRowsFunc rows_func;
+static int rows_next, rows_done;
+static void* rows_mutex;
+
+static void Rows_Lock(void)   { if (rows_mutex) Mutex_Lock(rows_mutex);   }
+static void Rows_Unlock(void) { if (rows_mutex) Mutex_Unlock(rows_mutex); }
+
+static void Rows_Work(void) {
+	int zBeg, zEnd;
+	for (;;) {
+		Rows_Lock();
+		zBeg = rows_next;
+		zEnd = min(zBeg + GEN_ROWS_PER_BATCH, World.Length);
+		rows_next = zEnd;
+		Rows_Unlock();
+		if (zBeg >= zEnd) return;
+
+		rows_func(zBeg, zEnd);
+		Rows_Lock();
+		rows_done += zEnd - zBeg;
+		Gen_CurrentProgress = (float)rows_done / World.Length;
+		Rows_Unlock();
+	}
+}
+
+/* Calls the given function on every row of the map, using worker threads when possible */
+static void Gen_ProcessRows(GenRowsFunc func) {
+#ifndef CC_BUILD_COOPTHREADED
+	void* threads[GEN_MAX_WORKERS];
+	int i;
+#endif
+	rows_func = func;
+	rows_next = 0; rows_done = 0;
+	Gen_CurrentProgress = 0.0f;
+
+#ifndef CC_BUILD_COOPTHREADED
+	if (gen_workers) {
+		rows_mutex = Mutex_Create();
+		for (i = 0; i < gen_workers; i++) {
+			Thread_Run(&threads[i], Rows_Work, 128 * 1024, "Map gen worker");
+		}
+
+		/* The map gen thread processes rows too, instead of just sitting idle */
+		Rows_Work();
+		for (i = 0; i < gen_workers; i++) {
+			Thread_Join(threads[i]);
+		}
+
+		Mutex_Free(rows_mutex);
+		rows_mutex = NULL;
+		return;
+	}
+#endif
+	Rows_Work();
+}
+
+
 /*########################################################################################################################*
 *----------------------------------------------------Notchy map gen-------------------------------------------------------*
 *#########################################################################################################################*/
-static int waterLevel, minHeight;
+static int waterLevel, minHeight, minStoneY;
 static cc_int16* heightmap;
 static RNGState rnd;
+/* Noise used by the column independent stages, which is shared between row worker threads */
+static struct CombinedNoise heightNoise1, heightNoise2;
+static struct OctaveNoise heightNoise3, strataNoise, sandNoise, gravelNoise;
 
 static void NotchyGen_FillOblateSpheroid(int x, int y, int z, float radius, BlockRaw block) {
 	int xBeg = Math_Floor(max(x - radius, 0));
@@ -264,74 +447,186 @@ static void NotchyGen_FillOblateSpheroid(int x, int y, int z, float radius, Bloc
 	}
 }
 
-#define STACK_FAST 8192
+/* Stack of cells to start filling spans from, which is reused by every flood fill */
+static int* flood_stack;
+static int flood_limit;
+
+/* Pushes the first cell of each run of air in the given line between x1 and x2 (inclusive) */
+static int NotchyGen_PushSpans(int line, int x1, int x2, int count) {
+	cc_bool inRun = false;
+	int x;
+
+	for (x = x1; x <= x2; x++) {
+		if (Gen_Blocks[line + x] != BLOCK_AIR) { inRun = false; continue; }
+		if (inRun) continue;
+
+		if (count == flood_limit) {
+			flood_limit *= 2;
+			flood_stack  = (int*)Mem_Realloc(flood_stack, flood_limit, 4, "flood fill stack");
+		}
+		flood_stack[count++] = line + x;
+		inRun = true;
+	}
+	return count;
+}
+
+/* Fills all air reachable from the given cell, moving along X and Z or downwards */
+/* NOTE: Fills whole runs of air along X at once, rather than one cell at a time */
 static void NotchyGen_FloodFill(int index, BlockRaw block) {
-	int* stack;
-	int stack_default[STACK_FAST]; /* avoid allocating memory if possible */
-	int count = 0, limit = STACK_FAST;
-	int x, y, z;
+	int count = 0, line;
+	int x, x1, x2, y, z;
 
-	stack = stack_default;
 	if (index < 0) return; /* y below map, don't bother starting */
-	stack[count++] = index;
+	flood_stack[count++] = index;
 
 	while (count) {
-		index = stack[--count];
-
+		index = flood_stack[--count];
 		if (Gen_Blocks[index] != BLOCK_AIR) continue;
-		Gen_Blocks[index] = block;
 
-		x = index  % World.Width;
-		y = index  / World.OneY;
-		z = (index / World.Width) % World.Length;
+		/* Index of the x = 0 cell in this line */
+		line = index - index % World.Width;
+		x    = index - line;
+		y    = index / World.OneY;
+		z    = (index / World.Width) % World.Length;
 
-		/* need to increase stack */
-		if (count >= limit - FACE_COUNT) {
-			Utils_Resize((void**)&stack, &limit, 4, STACK_FAST, STACK_FAST);
-		}
+		for (x1 = x; x1 > 0          && Gen_Blocks[line + x1 - 1] == BLOCK_AIR; x1--) { }
+		for (x2 = x; x2 < World.MaxX && Gen_Blocks[line + x2 + 1] == BLOCK_AIR; x2++) { }
+		Mem_Set(Gen_Blocks + line + x1, block, x2 - x1 + 1);
 
-		if (x > 0)          { stack[count++] = index - 1; }
-		if (x < World.MaxX) { stack[count++] = index + 1; }
-		if (z > 0)          { stack[count++] = index - World.Width; }
-		if (z < World.MaxZ) { stack[count++] = index + World.Width; }
-		if (y > 0)          { stack[count++] = index - World.OneY; }
+		if (z > 0)          count = NotchyGen_PushSpans(line - World.Width, x1, x2, count);
+		if (z < World.MaxZ) count = NotchyGen_PushSpans(line + World.Width, x1, x2, count);
+		if (y > 0)          count = NotchyGen_PushSpans(line - World.OneY,  x1, x2, count);
 	}
-	if (limit > STACK_FAST) Mem_Free(stack);
 }
 
 
-static void NotchyGen_CreateHeightmap(void) {
+static int NotchyGen_AdjustHeight(float height) {
+	height *= 0.5f;
+	if (height < 0) height *= 0.8f;
+	return (int)(height + waterLevel);
+}
+
+/* Calculates the heights of the given row one column at a time, returning the lowest height */
+/* NOTE: Only used to compare against NotchyGen_HeightmapRow in benchmark mode */
+static int NotchyGen_HeightmapRowScalar(int z, cc_int16* heights) {
 	float hLow, hHigh, height;
-	int hIndex = 0, adjHeight;
-	int x, z;
-	struct CombinedNoise n1, n2;
-	struct OctaveNoise n3;
+	int x, adjHeight, rowMin = World.Height;
 
-	CombinedNoise_Init(&n1, &rnd, 8, 8);
-	CombinedNoise_Init(&n2, &rnd, 8, 8);	
-	OctaveNoise_Init(&n3, &rnd, 6);
+	for (x = 0; x < World.Width; x++) {
+		hLow   = CombinedNoise_Calc(&heightNoise1, x * 1.3f, z * 1.3f) / 6 - 4;
+		height = hLow;
 
-	Gen_CurrentState = "Building heightmap";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+		if (OctaveNoise_Calc(&heightNoise3, (float)x, (float)z) <= 0) {
+			hHigh = CombinedNoise_Calc(&heightNoise2, x * 1.3f, z * 1.3f) / 5 + 6;
+			height = max(hLow, hHigh);
+		}
 
-		for (x = 0; x < World.Width; x++) {
-			hLow   = CombinedNoise_Calc(&n1, x * 1.3f, z * 1.3f) / 6 - 4;
-			height = hLow;
+		adjHeight = NotchyGen_AdjustHeight(height);
+		rowMin    = min(adjHeight, rowMin);
+		heights[x] = adjHeight;
+	}
+	return rowMin;
+}
 
-			if (OctaveNoise_Calc(&n3, (float)x, (float)z) <= 0) {
-				hHigh = CombinedNoise_Calc(&n2, x * 1.3f, z * 1.3f) / 5 + 6;
-				height = max(hLow, hHigh);
-			}
+/* Calculates the heights of the given row using batched noise, returning the lowest height */
+static int NotchyGen_HeightmapRow(int z, cc_int16* heights) {
+	float xs[NOISE_ROW_SIZE], scaledXs[NOISE_ROW_SIZE], highXs[NOISE_ROW_SIZE];
+	float hLow[NOISE_ROW_SIZE], hHigh[NOISE_ROW_SIZE], selector[NOISE_ROW_SIZE];
+	int highCols[NOISE_ROW_SIZE];
+	int x, i, j, count, highCount;
+	int adjHeight, rowMin = World.Height;
+
+	for (x = 0; x < World.Width; x += NOISE_ROW_SIZE) {
+		count = min(World.Width - x, NOISE_ROW_SIZE);
+		for (i = 0; i < count; i++) {
+			xs[i] = (float)(x + i); scaledXs[i] = (x + i) * 1.3f;
+		}
 
-			height *= 0.5f;
-			if (height < 0) height *= 0.8f;
+		CombinedNoise_CalcRow(&heightNoise1, scaledXs, z * 1.3f, hLow, count);
+		OctaveNoise_CalcRow(&heightNoise3, xs, (float)z, selector, count);
 
-			adjHeight = (int)(height + waterLevel);
-			minHeight = min(adjHeight, minHeight);
-			heightmap[hIndex++] = adjHeight;
+		/* High noise is only needed for the columns where selector noise is <= 0 */
+		for (i = 0, highCount = 0; i < count; i++) {
+			hLow[i] = hLow[i] / 6 - 4;
+			if (selector[i] > 0) continue;
+
+			highCols[highCount] = i;
+			highXs[highCount++] = scaledXs[i];
+		}
+		CombinedNoise_CalcRow(&heightNoise2, highXs, z * 1.3f, hHigh, highCount);
+
+		for (i = 0; i < highCount; i++) {
+			j = highCols[i];
+			hLow[j] = max(hLow[j], hHigh[i] / 5 + 6);
+		}
+
+		for (i = 0; i < count; i++) {
+			adjHeight = NotchyGen_AdjustHeight(hLow[i]);
+			rowMin    = min(adjHeight, rowMin);
+			heights[x + i] = adjHeight;
 		}
 	}
+	return rowMin;
+}
+
+static void NotchyGen_HeightmapRows(int zBeg, int zEnd) {
+	int z, rowMin, rowsMin = World.Height;
+
+	for (z = zBeg; z < zEnd; z++) {
+		rowMin  = NotchyGen_HeightmapRow(z, heightmap + z * World.Width);
+		rowsMin = min(rowMin, rowsMin);
+	}
+
+	Rows_Lock();
+	minHeight = min(rowsMin, minHeight);
+	Rows_Unlock();
+}
+
+/* Logs how long generating the heightmap takes with scalar noise and with batched noise */
+static void NotchyGen_BenchmarkHeightmap(void) {
+	float scalarMS, batchedMS, scalarRate, batchedRate;
+	cc_uint64 beg, end;
+	cc_int16* row;
+	int z, columns;
+	cc_bool same = true;
+
+	row = (cc_int16*)Mem_TryAlloc(World.Width, 2);
+	if (!row) return;
+	Gen_CurrentState = "Benchmarking heightmap";
+
+	beg = Stopwatch_Measure();
+	for (z = 0; z < World.Length; z++) {
+		NotchyGen_HeightmapRowScalar(z, heightmap + z * World.Width);
+	}
+	end = Stopwatch_Measure();
+	scalarMS = Stopwatch_ElapsedMicroseconds(beg, end) / 1000.0f;
+
+	beg = Stopwatch_Measure();
+	for (z = 0; z < World.Length; z++) {
+		NotchyGen_HeightmapRow(z, row);
+		if (!Mem_Equal(row, heightmap + z * World.Width, World.Width * 2)) same = false;
+	}
+	end = Stopwatch_Measure();
+	batchedMS = Stopwatch_ElapsedMicroseconds(beg, end) / 1000.0f;
+	Mem_Free(row);
+
+	columns     = World.Width * World.Length;
+	scalarRate  = columns / max(scalarMS,  0.001f);
+	batchedRate = columns / max(batchedMS, 0.001f);
+
+	Platform_Log3("Heightmap: %i columns, %f3 ms scalar, %f3 ms batched", &columns, &scalarMS, &batchedMS);
+	Platform_Log2("Heightmap: %f1 columns/ms scalar, %f1 columns/ms batched", &scalarRate, &batchedRate);
+	if (!same) Platform_LogConst("Heightmap: batched noise does NOT match scalar noise");
+}
+
+static void NotchyGen_CreateHeightmap(void) {
+	CombinedNoise_Init(&heightNoise1, &rnd, 8, 8);
+	CombinedNoise_Init(&heightNoise2, &rnd, 8, 8);	
+	OctaveNoise_Init(&heightNoise3, &rnd, 6);
+	if (Benchmark_Enabled) NotchyGen_BenchmarkHeightmap();
+
+	Gen_CurrentState = "Building heightmap";
+	Gen_ProcessRows(NotchyGen_HeightmapRows);
 }
 
 static int NotchyGen_CreateStrataFast(void) {
@@ -363,23 +658,21 @@ static int NotchyGen_CreateStrataFast(void) {
 	return max(stoneHeight, 1);
 }
 
-static void NotchyGen_CreateStrata(void) {
-	int dirtThickness, dirtHeight;
-	int minStoneY, stoneHeight;
-	int hIndex = 0, maxY = World.MaxY, index = 0;
-	int x, y, z;
-	struct OctaveNoise n;
-
-	/* Try to bulk fill bottom of the map if possible */
-	minStoneY = NotchyGen_CreateStrataFast();
-	OctaveNoise_Init(&n, &rnd, 8);
-
-	Gen_CurrentState = "Creating strata";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+static void NotchyGen_StrataRows(int zBeg, int zEnd) {
+	float xs[NOISE_ROW_SIZE], noise[NOISE_ROW_SIZE];
+	int dirtThickness, dirtHeight, stoneHeight;
+	int hIndex = zBeg * World.Width, maxY = World.MaxY, index = 0;
+	int x, y, z, i;
 
+	for (z = zBeg; z < zEnd; z++) {
 		for (x = 0; x < World.Width; x++) {
-			dirtThickness = (int)(OctaveNoise_Calc(&n, (float)x, (float)z) / 24 - 4);
+			/* Calculate noise for the next batch of columns all at once */
+			if (!(x % NOISE_ROW_SIZE)) {
+				for (i = 0; i < NOISE_ROW_SIZE; i++) { xs[i] = (float)(x + i); }
+				OctaveNoise_CalcRow(&strataNoise, xs, (float)z, noise, min(World.Width - x, NOISE_ROW_SIZE));
+			}
+
+			dirtThickness = (int)(noise[x % NOISE_ROW_SIZE] / 24 - 4);
 			dirtHeight    = heightmap[hIndex++];
 			stoneHeight   = dirtHeight + dirtThickness;
 
@@ -400,6 +693,15 @@ static void NotchyGen_CreateStrata(void) {
 	}
 }
 
+static void NotchyGen_CreateStrata(void) {
+	/* Try to bulk fill bottom of the map if possible */
+	minStoneY = NotchyGen_CreateStrataFast();
+	OctaveNoise_Init(&strataNoise, &rnd, 8);
+
+	Gen_CurrentState = "Creating strata";
+	Gen_ProcessRows(NotchyGen_StrataRows);
+}
+
 static void NotchyGen_CarveCaves(void) {
 	int cavesCount, caveLen;
 	float caveX, caveY, caveZ;
@@ -540,19 +842,12 @@ static void NotchyGen_FloodFillLava(void) {
 	}
 }
 
-static void NotchyGen_CreateSurfaceLayer(void) {	
-	int hIndex = 0, index;
+static void NotchyGen_SurfaceRows(int zBeg, int zEnd) {
+	int hIndex = zBeg * World.Width, index;
 	BlockRaw above;
 	int x, y, z;
-	struct OctaveNoise n1, n2;
-
-	OctaveNoise_Init(&n1, &rnd, 8);
-	OctaveNoise_Init(&n2, &rnd, 8);
-
-	Gen_CurrentState = "Creating surface";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
 
+	for (z = zBeg; z < zEnd; z++) {
 		for (x = 0; x < World.Width; x++) {
 			y = heightmap[hIndex++];
 			if (y < 0 || y >= World.Height) continue;
@@ -561,15 +856,23 @@ static void NotchyGen_CreateSurfaceLayer(void) {
 			above = y >= World.MaxY ? BLOCK_AIR : Gen_Blocks[index + World.OneY];
 
 			/* TODO: update heightmap */
-			if (above == BLOCK_STILL_WATER && (OctaveNoise_Calc(&n2, (float)x, (float)z) > 12)) {
+			if (above == BLOCK_STILL_WATER && (OctaveNoise_Calc(&gravelNoise, (float)x, (float)z) > 12)) {
 				Gen_Blocks[index] = BLOCK_GRAVEL;
 			} else if (above == BLOCK_AIR) {
-				Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&n1, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
+				Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&sandNoise, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
 			}
 		}
 	}
 }
 
+static void NotchyGen_CreateSurfaceLayer(void) {
+	OctaveNoise_Init(&sandNoise,   &rnd, 8);
+	OctaveNoise_Init(&gravelNoise, &rnd, 8);
+
+	Gen_CurrentState = "Creating surface";
+	Gen_ProcessRows(NotchyGen_SurfaceRows);
+}
+
 static void NotchyGen_PlantFlowers(void) {
 	int numPatches;
 	BlockRaw block;
@@ -698,7 +1001,18 @@ static cc_bool NotchyGen_Prepare(void) {
 	minHeight  = World.Height;
 
 	heightmap  = (cc_int16*)Mem_TryAlloc(World.Width * World.Length, 2);
-	return heightmap != NULL;
+	/* Enough for most flood fills, without needing to grow the stack */
+	flood_limit = max(World.Width, World.Length) * 8;
+	flood_stack = (int*)Mem_TryAlloc(flood_limit, 4);
+	gen_workers = Options_GetInt(OPT_GEN_THREADS, 0, GEN_MAX_WORKERS, 
+								min(Thread_ProcessorCount() - 1, GEN_MAX_WORKERS));
+	if (heightmap && flood_stack) return true;
+
+	Mem_Free(heightmap);
+	Mem_Free(flood_stack);
+	heightmap   = NULL;
+	flood_stack = NULL;
+	return false;
 }
 
 static void NotchyGen_Generate(void) {
@@ -721,8 +1035,10 @@ static void NotchyGen_Generate(void) {
 	GEN_COOP_END
 
 	Mem_Free(heightmap);
-	heightmap = NULL;
-	gen_done  = true;
+	Mem_Free(flood_stack);
+	heightmap   = NULL;
+	flood_stack = NULL;
+	gen_done    = true;
 }
 
 const struct MapGenerator NotchyGen = {
@@ -737,6 +1053,13 @@ const struct MapGenerator NotchyGen = {
 BlockRaw* Tree_Blocks;
 RNGState* Tree_Rnd;
 
+#ifdef CC_BUILD_CHUNKEDWORLD
+/* Tree_Blocks is NULL when growing trees in an already loaded world */
+#define TreeGen_IsAir(x, y, z, index) (Tree_Blocks ? Tree_Blocks[index] == BLOCK_AIR : World_GetBlock(x, y, z) == BLOCK_AIR)
+#else
+#define TreeGen_IsAir(x, y, z, index) (Tree_Blocks[index] == BLOCK_AIR)
+#endif
+
 cc_bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 	int baseHeight = treeHeight - 4;
 	int index;
@@ -749,7 +1072,7 @@ cc_bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 
 				if (!World_Contains(x, y, z)) return false;
 				index = World_Pack(x, y, z);
-				if (Tree_Blocks[index] != BLOCK_AIR) return false;
+				if (!TreeGen_IsAir(x, y, z, index)) return false;
 			}
 		}
 	}
@@ -761,7 +1084,7 @@ cc_bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 
 				if (!World_Contains(x, y, z)) return false;
 				index = World_Pack(x, y, z);
-				if (Tree_Blocks[index] != BLOCK_AIR) return false;
+				if (!TreeGen_IsAir(x, y, z, index)) return false;
 			}
 		}
 	}
@@ -4,10 +4,16 @@
 #include "Errors.h"
 #include "Window.h"
 
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTGPU_SSE2
+#endif
+
 static cc_bool faceCulling;
 static int width, height; 
 static struct Bitmap fb_bmp;
 static float vp_hwidth, vp_hheight;
+static float guard_width, guard_height;
 static int sc_maxX, sc_maxY;
 
 static PackedCol* colorBuffer;
@@ -20,6 +26,11 @@ static cc_bool depthTest  = true;
 static cc_bool depthWrite = true;
 static GfxResourceID white_square;
 
+static void FlushTriangles(void);
+static void CreateWorkers(void);
+static void FreeWorkers(void);
+static void FreeBins(void);
+
 void Gfx_RestoreState(void) {
 	InitDefaultResources();
 
@@ -28,6 +39,7 @@ void Gfx_RestoreState(void) {
 	BitmapCol pixels[1] = { BITMAPCOLOR_WHITE };
 	Bitmap_Init(bmp, 1, 1, pixels);
 	white_square = Gfx_CreateTexture(&bmp, 0, false);
+	Gfx_BindTexture(white_square);
 }
 
 void Gfx_FreeState(void) {
@@ -40,10 +52,12 @@ void Gfx_Create(void) {
 	Gfx.MaxTexHeight = 4096;
 	Gfx.Created      = true;
 	
+	CreateWorkers();
 	Gfx_RestoreState();
 }
 
 static void DestroyBuffers(void) {
+	FreeBins();
 	Window_FreeFramebuffer(&fb_bmp);
 	Mem_Free(depthBuffer);
 	depthBuffer = NULL;
@@ -52,6 +66,7 @@ static void DestroyBuffers(void) {
 void Gfx_Free(void) { 
 	Gfx_FreeState();
 	DestroyBuffers();
+	FreeWorkers();
 }
 
 
@@ -60,24 +75,23 @@ typedef struct CCTexture {
 	BitmapCol pixels[];
 } CCTexture;
 
+// NOTE: Only valid to read from when drawing textured triangles
 static CCTexture* curTexture;
-static BitmapCol* curTexPixels;
-static int curTexWidth, curTexHeight;
 		
 void Gfx_BindTexture(GfxResourceID texId) {
 	if (!texId) texId = white_square;
-	CCTexture* tex = texId;
-
-	curTexture   = tex;
-	curTexPixels = tex->pixels;
-	curTexWidth  = tex->width;
-	curTexHeight = tex->height;
+	curTexture = (CCTexture*)texId;
 }
 		
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	GfxResourceID data = *texId;
+	// Texture might still be used by triangles waiting to be drawn
+	if (data) FlushTriangles();
 	if (data) Mem_Free(data);
 	*texId = NULL;
+
+	// Don't leave a dangling pointer to the deleted texture
+	if (data && data == curTexture) curTexture = white_square;
 }
 		
 static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8 flags, cc_bool mipmaps) {
@@ -92,6 +106,7 @@ static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8
 void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps) {
 	CCTexture* tex = (CCTexture*)texId;
 	cc_uint32* dst = (tex->pixels + x) + y * tex->width;
+	FlushTriangles();
 	CopyTextureData(dst, tex->width * 4, part, rowWidth << 2);
 }
 
@@ -124,6 +139,7 @@ void Gfx_SetAlphaArgBlend(cc_bool enabled) { }
 
 void Gfx_ClearBuffers(GfxBuffers buffers) {
 	int i, size = width * height;
+	FlushTriangles();
 
 	if (buffers & GFX_BUFFER_COLOR) {
 		for (i = 0; i < size; i++) colorBuffer[i] = clearColor;
@@ -279,47 +295,298 @@ typedef struct Vector4 { float x, y, z, w; } Vector4;
 typedef struct Vector3 { float x, y, z; } Vector3;
 typedef struct Vector2 { float x, y; } Vector2;
 
-static void TransformVertex(int index, Vector4* frag, Vector2* uv, PackedCol* color) {
+// Vertex in clip space, before perspective division
+typedef struct ClipVertex { float x, y, z, w, u, v; } ClipVertex;
+
+static void TransformVertex(int index, ClipVertex* vertex) {
 	// TODO: avoid the multiply, just add down in DrawTriangles
 	char* ptr = (char*)gfx_vertices + index * gfx_stride;
 	Vector3* pos = (Vector3*)ptr;
 
-	Vector4 coord;
-	coord.x = pos->x * mvp.row1.x + pos->y * mvp.row2.x + pos->z * mvp.row3.x + mvp.row4.x;
-	coord.y = pos->x * mvp.row1.y + pos->y * mvp.row2.y + pos->z * mvp.row3.y + mvp.row4.y;
-	coord.z = pos->x * mvp.row1.z + pos->y * mvp.row2.z + pos->z * mvp.row3.z + mvp.row4.z;
-	coord.w = pos->x * mvp.row1.w + pos->y * mvp.row2.w + pos->z * mvp.row3.w + mvp.row4.w;
+	vertex->x = pos->x * mvp.row1.x + pos->y * mvp.row2.x + pos->z * mvp.row3.x + mvp.row4.x;
+	vertex->y = pos->x * mvp.row1.y + pos->y * mvp.row2.y + pos->z * mvp.row3.y + mvp.row4.y;
+	vertex->z = pos->x * mvp.row1.z + pos->y * mvp.row2.z + pos->z * mvp.row3.z + mvp.row4.z;
+	vertex->w = pos->x * mvp.row1.w + pos->y * mvp.row2.w + pos->z * mvp.row3.w + mvp.row4.w;
+}
 
-	float invW = 1.0f / coord.w;
-	frag->x = vp_hwidth  * (1 + coord.x * invW);
-	frag->y = vp_hheight * (1 - coord.y * invW);
-	frag->z = coord.z * invW;
-	frag->w = invW;
+static void LoadVertexAttribs(int index, ClipVertex* vertex, PackedCol* color) {
+	char* ptr = (char*)gfx_vertices + index * gfx_stride;
 
 	if (gfx_format != VERTEX_FORMAT_TEXTURED) {
 		struct VertexColoured* v = (struct VertexColoured*)ptr;
 		*color = v->Col;
+		vertex->u = 0;
+		vertex->v = 0;
 	} else {
 		struct VertexTextured* v = (struct VertexTextured*)ptr;
 		*color = v->Col;
-		uv->x  = (v->U + texOffsetX) * invW;
-		uv->y  = (v->V + texOffsetY) * invW;
+		vertex->u = v->U + texOffsetX;
+		vertex->v = v->V + texOffsetY;
 	}
 }
+
+static void ProjectVertex(const ClipVertex* vertex, Vector4* frag, Vector2* uv) {
+	float invW = 1.0f / vertex->w;
+	frag->x = vp_hwidth  * (1 + vertex->x * invW);
+	frag->y = vp_hheight * (1 - vertex->y * invW);
+	frag->z = vertex->z * invW;
+	frag->w = invW;
+
+	uv->x = vertex->u * invW;
+	uv->y = vertex->v * invW;
+}
 	
-static int MultiplyColours(PackedCol vColor, BitmapCol tColor) {
-	int a1 = PackedCol_A(vColor), a2 = BitmapCol_A(tColor);
-	int a  = ( a1 * a2 ) / 255;
-	int r1 = PackedCol_R(vColor), r2 = BitmapCol_R(tColor);
-	int r  = ( r1 * r2 ) / 255;
-	int g1 = PackedCol_G(vColor), g2 = BitmapCol_G(tColor);
-	int g  = ( g1 * g2 ) / 255;
-	int b1 = PackedCol_B(vColor), b2 = BitmapCol_B(tColor);
-	int b  = ( b1 * b2 ) / 255;
-	return PackedCol_Make(r, g, b, a);
-}
-
-static void DrawTriangle(Vector4 frag1, Vector4 frag2, Vector4 frag3,
+// Exactly calculates x / 255 for any x in 0 to 255 * 255
+#define Div255(x) (((x) + 1 + ((x) >> 8)) >> 8)
+
+static BitmapCol MultiplyColours(BitmapCol vColor, BitmapCol tColor) {
+	int a = Div255(BitmapCol_A(vColor) * BitmapCol_A(tColor));
+	int r = Div255(BitmapCol_R(vColor) * BitmapCol_R(tColor));
+	int g = Div255(BitmapCol_G(vColor) * BitmapCol_G(tColor));
+	int b = Div255(BitmapCol_B(vColor) * BitmapCol_B(tColor));
+	return BitmapCol_Make(r, g, b, a);
+}
+
+// Returns the index of the texel at the given perspective corrected texture coordinates
+// NOTE: Relies on all textures having power of two dimensions
+static CC_INLINE int TexelIndex(float u, float v, int widthMask, int heightMask, int widthShift) {
+	float x = u * (widthMask  + 1);
+	float y = v * (heightMask + 1);
+	int texX = (int)x; texX -= (float)texX > x; // floor
+	int texY = (int)y; texY -= (float)texY > y;
+	return ((texY & heightMask) << widthShift) | (texX & widthMask);
+}
+
+/*########################################################################################################################*
+*-------------------------------------------------------Tile binning------------------------------------------------------*
+*#########################################################################################################################*/
+// Triangles aren't drawn immediately, but are instead set up and then added to the bin
+//  of each screen tile they overlap. When the bins are flushed (e.g. at end of frame),
+//  each tile has all of its triangles drawn in submission order by a single thread,
+//  so different tiles can be drawn in parallel without needing any locking
+#define TILE_SHIFT 6
+#define TILE_SIZE  (1 << TILE_SHIFT)
+#define MAX_BINNED_TRIANGLES 16384
+
+enum TriangleFlags {
+	TRI_TEXTURED   = 0x01, TRI_ALPHA_TEST  = 0x02, TRI_ALPHA_BLEND = 0x04,
+	TRI_DEPTH_TEST = 0x08, TRI_DEPTH_WRITE = 0x10, TRI_COLOR_WRITE = 0x20
+};
+
+// Barycentric coordinates and attributes are stored as plane equations, so that
+//  they can be incrementally stepped instead of recalculated for every pixel
+// NOTE: ic2 is derived from ic0 and ic1, attributes are 'a3 + ic0 * da0 + ic1 * da1'
+typedef struct Triangle {
+	int minX, minY, maxX, maxY;
+	float x3, y3;
+	float ic0_dx, ic0_dy, ic1_dx, ic1_dy;
+	float z3, dz0, dz1;
+	float w3, dw0, dw1;
+	float u3, du0, du1;
+	float v3, dv0, dv1;
+	BitmapCol color; // NOTE: Vertex colour is converted to BitmapCol format upfront
+	int flags;
+	BitmapCol* texPixels;
+	int texWidthMask, texHeightMask, texWidthShift;
+} Triangle;
+
+typedef struct TileBin {
+	cc_uint16* items;
+	int count, capacity;
+} TileBin;
+
+static Triangle* triangles;
+static int numTriangles;
+static TileBin* tileBins;
+static int* activeTiles;
+static int tilesX, tilesY;
+
+static void DrawTile(int tile);
+static void FlushTriangles(void);
+
+#ifndef CC_BUILD_COOPTHREADED
+#define RASTER_MAX_WORKERS 16
+static void* raster_threads[RASTER_MAX_WORKERS];
+static int raster_workers;
+static void* raster_mutex;
+static void* raster_work;
+static void* raster_done;
+static volatile cc_bool raster_stopping;
+// Tiles in activeTiles that workers can draw, and how many have been drawn so far
+static int raster_count, raster_next, raster_drawn;
+
+static void RunTiles(void) {
+	int tile;
+	cc_bool more, last;
+
+	for (;;) 
+	{
+		Mutex_Lock(raster_mutex);
+		tile = raster_next < raster_count ? activeTiles[raster_next++] : -1;
+		more = raster_next < raster_count;
+		Mutex_Unlock(raster_mutex);
+
+		if (tile < 0) return;
+		// Signals may have been coalesced, so make sure another worker wakes up too
+		if (more) Waitable_Signal(raster_work);
+		DrawTile(tile);
+
+		Mutex_Lock(raster_mutex);
+		last = ++raster_drawn == raster_count;
+		Mutex_Unlock(raster_mutex);
+		if (last) Waitable_Signal(raster_done);
+	}
+}
+
+static void RasterWorker_Run(void) {
+	for (;;) 
+	{
+		Waitable_Wait(raster_work);
+		if (raster_stopping) { Waitable_Signal(raster_work); return; }
+		RunTiles();
+	}
+}
+
+static void DrawTilesThreaded(int count) {
+	cc_bool finished;
+
+	Mutex_Lock(raster_mutex);
+	raster_count = count;
+	raster_next  = 0;
+	raster_drawn = 0;
+	Mutex_Unlock(raster_mutex);
+
+	Waitable_Signal(raster_work);
+	RunTiles();
+
+	for (;;)
+	{
+		Mutex_Lock(raster_mutex);
+		finished = raster_drawn == raster_count;
+		Mutex_Unlock(raster_mutex);
+
+		if (finished) break;
+		Waitable_Wait(raster_done);
+	}
+
+	Mutex_Lock(raster_mutex);
+	raster_count = 0;
+	raster_next  = 0;
+	Mutex_Unlock(raster_mutex);
+}
+
+static void CreateWorkers(void) {
+	int i;
+	raster_workers = Options_GetInt(OPT_SOFTGPU_THREADS, 0, RASTER_MAX_WORKERS, 
+									min(Thread_ProcessorCount() - 1, RASTER_MAX_WORKERS));
+	if (!raster_workers) return;
+
+	raster_stopping = false;
+	raster_mutex    = Mutex_Create();
+	raster_work     = Waitable_Create();
+	raster_done     = Waitable_Create();
+
+	for (i = 0; i < raster_workers; i++) 
+	{
+		Thread_Run(&raster_threads[i], RasterWorker_Run, 256 * 1024, "Rasteriser");
+	}
+}
+
+static void FreeWorkers(void) {
+	int i;
+	if (!raster_workers) return;
+
+	raster_stopping = true;
+	Waitable_Signal(raster_work);
+	for (i = 0; i < raster_workers; i++) 
+	{
+		Thread_Join(raster_threads[i]);
+	}
+
+	Mutex_Free(raster_mutex);
+	Waitable_Free(raster_work);
+	Waitable_Free(raster_done);
+	raster_workers = 0;
+}
+#else
+static void CreateWorkers(void) { }
+static void FreeWorkers(void)   { }
+#endif
+
+static void AllocBins(void) {
+	tilesX = (width  + TILE_SIZE - 1) >> TILE_SHIFT;
+	tilesY = (height + TILE_SIZE - 1) >> TILE_SHIFT;
+
+	tileBins    = (TileBin*)Mem_AllocCleared(tilesX * tilesY, sizeof(TileBin), "tile bins");
+	activeTiles = (int*)Mem_Alloc(tilesX * tilesY, sizeof(int), "active tiles");
+	triangles   = (Triangle*)Mem_Alloc(MAX_BINNED_TRIANGLES, sizeof(Triangle), "triangles");
+}
+
+static void FreeBins(void) {
+	int i;
+	FlushTriangles();
+
+	for (i = 0; i < tilesX * tilesY; i++) 
+	{
+		Mem_Free(tileBins[i].items);
+	}
+	Mem_Free(tileBins);
+	Mem_Free(activeTiles);
+	Mem_Free(triangles);
+
+	tileBins    = NULL;
+	activeTiles = NULL;
+	triangles   = NULL;
+	tilesX = 0; tilesY = 0;
+}
+
+static void BinTriangle(int index) {
+	Triangle* t = &triangles[index];
+	int minTX = t->minX >> TILE_SHIFT, maxTX = t->maxX >> TILE_SHIFT;
+	int minTY = t->minY >> TILE_SHIFT, maxTY = t->maxY >> TILE_SHIFT;
+
+	for (int ty = minTY; ty <= maxTY; ty++)
+		for (int tx = minTX; tx <= maxTX; tx++)
+	{
+		TileBin* bin = &tileBins[ty * tilesX + tx];
+		if (bin->count == bin->capacity) {
+			bin->capacity = max(256, bin->capacity * 2);
+			bin->items    = (cc_uint16*)Mem_Realloc(bin->items, bin->capacity, 2, "tile bin");
+		}
+		bin->items[bin->count++] = (cc_uint16)index;
+	}
+}
+
+static void FlushTriangles(void) {
+	int i, count = 0;
+	if (!numTriangles) return;
+
+	for (i = 0; i < tilesX * tilesY; i++) 
+	{
+		if (tileBins[i].count) activeTiles[count++] = i;
+	}
+
+#ifndef CC_BUILD_COOPTHREADED
+	if (raster_workers) {
+		DrawTilesThreaded(count);
+	} else
+#endif
+	{
+		for (i = 0; i < count; i++) DrawTile(activeTiles[i]);
+	}
+
+	for (i = 0; i < count; i++) 
+	{
+		tileBins[activeTiles[i]].count = 0;
+	}
+	numTriangles = 0;
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Rasterisation-----------------------------------------------------*
+*#########################################################################################################################*/
+static void SetupTriangle(Vector4 frag1, Vector4 frag2, Vector4 frag3,
 						Vector2 uv1, Vector2 uv2, Vector2 uv3, PackedCol color) {
 	int x1 = (int)frag1.x, y1 = (int)frag1.y;
 	int x2 = (int)frag2.x, y2 = (int)frag2.y;
@@ -329,102 +596,420 @@ static void DrawTriangle(Vector4 frag1, Vector4 frag2, Vector4 frag3,
 	int maxX = max(x1, max(x2, x3));
 	int maxY = max(y1, max(y2, y3));
 
-	// TODO backface culling
-	if (faceCulling) {
-		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
-		int sign = (x2 - x1) * (y3 - y1) - (x3 - x1) * (y2 - y1);
-		if (sign > 0) return;
-	}
-
 	// Reject triangles completely outside
 	if (minX < 0 && maxX < 0 || minX >= width  && maxX >= width ) return;
 	if (minY < 0 && maxY < 0 || minY >= height && maxY >= height) return;
+	if (!triangles) return;
+
+	// Reject degenerate triangles, which don't cover any pixels
+	int area = (y2 - y3) * (x1 - x3) + (x3 - x2) * (y1 - y3);
+	if (!area) return;
+
+	if (numTriangles == MAX_BINNED_TRIANGLES) FlushTriangles();
+	int index   = numTriangles++;
+	Triangle* t = &triangles[index];
 
 	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, sc_maxX);
-	minY = max(minY, 0); maxY = min(maxY, sc_maxY);
+	t->minX = max(minX, 0); t->maxX = min(maxX, sc_maxX);
+	t->minY = max(minY, 0); t->maxY = min(maxY, sc_maxY);
 
 	// NOTE: W in frag variables below is actually 1/W 
-	float factor = 1.0f / ((y2 - y3) * (x1 - x3) + (x3 - x2) * (y1 - y3));
-	
-	// TODO proper clipping
-	if (frag1.w <= 0 || frag2.w <= 0 || frag3.w <= 0) return;
-	
-	for (int y = minY; y <= maxY; y++) {
-		float yy = y + 0.5f;
-		for (int x = minX; x <= maxX; x++) {
-			float xx = x + 0.5f;
-			
-			float ic0 = ((y2 - y3) * (xx - x3) + (x3 - x2) * (yy - y3)) * factor;
-			if (ic0 < 0 || ic0 > 1) continue;
-			float ic1 = ((y3 - y1) * (xx - x3) + (x1 - x3) * (yy - y3)) * factor;
-			if (ic1 < 0 || ic1 > 1) continue;
-			float ic2 = 1.0f - ic0 - ic1;
-			if (ic2 < 0 || ic2 > 1) continue;
-
-			int index = y * width + x;
-			float w = 1 / (ic0 * frag1.w + ic1 * frag2.w + ic2 * frag3.w);
-			float z = (ic0 * frag1.z + ic1 * frag2.z + ic2 * frag3.z) * w;
-
-			if (depthTest && (z < 0 || z > depthBuffer[index])) continue;
-			if (!colWrite) {
-				if (depthWrite) depthBuffer[index] = z;
-				continue;
-			}
-
-			PackedCol fragColor = color;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
-				float u = (ic0 * uv1.x + ic1 * uv2.x + ic2 * uv3.x) * w;
-				float v = (ic0 * uv1.y + ic1 * uv2.y + ic2 * uv3.y) * w;
-				int texX = ((int)(Math_AbsF(u - Math_Floor(u)) * curTexWidth )) % curTexWidth; // TODO avoid slow %
-				int texY = ((int)(Math_AbsF(v - Math_Floor(v)) * curTexHeight)) % curTexHeight;
-				int texIndex = texY * curTexWidth + texX;
-
-				fragColor = MultiplyColours(fragColor, curTexPixels[texIndex]);
-			}
-
-			int R = PackedCol_R(fragColor);
-			int G = PackedCol_G(fragColor);
-			int B = PackedCol_B(fragColor);
-			int A = PackedCol_A(fragColor);
-
-			if (gfx_alphaBlend) {
-				PackedCol dst = colorBuffer[index];
-				int dstR = BitmapCol_R(dst);
-				int dstG = BitmapCol_G(dst);
-				int dstB = BitmapCol_B(dst);
-
-				R = (R * A) / 255 + (dstR * (255 - A)) / 255;
-				G = (G * A) / 255 + (dstG * (255 - A)) / 255;
-				B = (B * A) / 255 + (dstB * (255 - A)) / 255;
-			}
-			if (gfx_alphaTest && A < 0x80) continue;
-
-			if (depthWrite) depthBuffer[index] = z;
-			colorBuffer[index] = BitmapCol_Make(R, G, B, 0xFF);
+	float factor = 1.0f / area;
+	t->x3 = x3; t->ic0_dx = (y2 - y3) * factor; t->ic0_dy = (x3 - x2) * factor;
+	t->y3 = y3; t->ic1_dx = (y3 - y1) * factor; t->ic1_dy = (x1 - x3) * factor;
+
+	t->z3 = frag3.z; t->dz0 = frag1.z - frag3.z; t->dz1 = frag2.z - frag3.z;
+	t->w3 = frag3.w; t->dw0 = frag1.w - frag3.w; t->dw1 = frag2.w - frag3.w;
+	t->u3 = uv3.x;   t->du0 = uv1.x - uv3.x;     t->du1 = uv2.x - uv3.x;
+	t->v3 = uv3.y;   t->dv0 = uv1.y - uv3.y;     t->dv1 = uv2.y - uv3.y;
+
+	t->color = BitmapCol_Make(PackedCol_R(color), PackedCol_G(color), PackedCol_B(color), PackedCol_A(color));
+	if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+		t->texPixels     = curTexture->pixels;
+		t->texWidthMask  = curTexture->width  - 1;
+		t->texHeightMask = curTexture->height - 1;
+		t->texWidthShift = Math_ilog2(curTexture->width);
+	}
+	t->flags   = (gfx_format == VERTEX_FORMAT_TEXTURED ? TRI_TEXTURED    : 0)
+				| (gfx_alphaTest  ? TRI_ALPHA_TEST  : 0) | (gfx_alphaBlend ? TRI_ALPHA_BLEND : 0)
+				| (depthTest      ? TRI_DEPTH_TEST  : 0) | (depthWrite     ? TRI_DEPTH_WRITE : 0)
+				| (colWrite       ? TRI_COLOR_WRITE : 0);
+	BinTriangle(index);
+}
+
+// Returns the largest value of a plane equation at the corner pixels of the given rectangle
+static float PlaneMax(float value, float dx, float dy, int w, int h) {
+	if (dx > 0) value += dx * w;
+	if (dy > 0) value += dy * h;
+	return value;
+}
+
+static void DrawPixel(const Triangle* t, float ic0, float ic1, int index) {
+	int flags = t->flags;
+	float ic2 = 1.0f - ic0 - ic1;
+	if (ic0 < 0 || ic1 < 0 || ic2 < 0) return;
+
+	float w = 1 / (t->w3 + ic0 * t->dw0 + ic1 * t->dw1);
+	float z = (t->z3 + ic0 * t->dz0 + ic1 * t->dz1) * w;
+
+	if ((flags & TRI_DEPTH_TEST) && (z < 0 || z > depthBuffer[index])) return;
+	if (!(flags & TRI_COLOR_WRITE)) {
+		if (flags & TRI_DEPTH_WRITE) depthBuffer[index] = z;
+		return;
+	}
+
+	BitmapCol fragColor = t->color;
+	if (flags & TRI_TEXTURED) {
+		float u = (t->u3 + ic0 * t->du0 + ic1 * t->du1) * w;
+		float v = (t->v3 + ic0 * t->dv0 + ic1 * t->dv1) * w;
+		int texIndex = TexelIndex(u, v, t->texWidthMask, t->texHeightMask, t->texWidthShift);
+
+		fragColor = MultiplyColours(fragColor, t->texPixels[texIndex]);
+	}
+
+	int R = BitmapCol_R(fragColor);
+	int G = BitmapCol_G(fragColor);
+	int B = BitmapCol_B(fragColor);
+	int A = BitmapCol_A(fragColor);
+
+	if (flags & TRI_ALPHA_BLEND) {
+		BitmapCol dst = colorBuffer[index];
+		int dstR = BitmapCol_R(dst);
+		int dstG = BitmapCol_G(dst);
+		int dstB = BitmapCol_B(dst);
+
+		R = Div255(R * A) + Div255(dstR * (255 - A));
+		G = Div255(G * A) + Div255(dstG * (255 - A));
+		B = Div255(B * A) + Div255(dstB * (255 - A));
+	}
+	if ((flags & TRI_ALPHA_TEST) && A < 0x80) return;
+
+	if (flags & TRI_DEPTH_WRITE) depthBuffer[index] = z;
+	colorBuffer[index] = BitmapCol_Make(R, G, B, 0xFF);
+}
+
+#ifdef SOFTGPU_SSE2
+#define BITMAPCOLOR_A_INDEX (BITMAPCOLOR_A_SHIFT / 8)
+
+static CC_INLINE __m128i Div255_SSE2(__m128i x) {
+	__m128i one = _mm_set1_epi16(1);
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8);
+}
+
+static CC_INLINE __m128i Floor_SSE2(__m128 x) {
+	__m128i i = _mm_cvttps_epi32(x);
+	// Truncation rounds negative values up, so subtract 1 (i.e. add -1) in that case
+	return _mm_add_epi32(i, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i), x)));
+}
+
+// Replaces the colour channels of each pixel with its alpha channel
+static CC_INLINE __m128i BroadcastAlpha_SSE2(__m128i x) {
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(BITMAPCOLOR_A_INDEX, BITMAPCOLOR_A_INDEX, BITMAPCOLOR_A_INDEX, BITMAPCOLOR_A_INDEX));
+	return _mm_shufflehi_epi16(x, _MM_SHUFFLE(BITMAPCOLOR_A_INDEX, BITMAPCOLOR_A_INDEX, BITMAPCOLOR_A_INDEX, BITMAPCOLOR_A_INDEX));
+}
+
+// Shades 4 consecutive pixels at once, producing the same results as DrawPixel
+static void DrawPixels_SSE2(const Triangle* t, float ic0_row, float ic1_row, int offset, int index) {
+	int flags = t->flags;
+	__m128 zero = _mm_setzero_ps();
+	__m128 offs = _mm_add_ps(_mm_set1_ps((float)offset), _mm_set_ps(3, 2, 1, 0));
+	__m128 ic0  = _mm_add_ps(_mm_set1_ps(ic0_row), _mm_mul_ps(offs, _mm_set1_ps(t->ic0_dx)));
+	__m128 ic1  = _mm_add_ps(_mm_set1_ps(ic1_row), _mm_mul_ps(offs, _mm_set1_ps(t->ic1_dx)));
+	__m128 ic2  = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), ic0), ic1);
+
+	__m128 mask = _mm_and_ps(_mm_cmpnlt_ps(ic0, zero), _mm_cmpnlt_ps(ic1, zero));
+	mask = _mm_and_ps(mask, _mm_cmpnlt_ps(ic2, zero));
+	if (!_mm_movemask_ps(mask)) return;
+
+#define PLANE_SSE2(a3, da0, da1) _mm_add_ps(_mm_add_ps(_mm_set1_ps(a3), _mm_mul_ps(ic0, _mm_set1_ps(da0))), _mm_mul_ps(ic1, _mm_set1_ps(da1)))
+	__m128 w = _mm_div_ps(_mm_set1_ps(1.0f), PLANE_SSE2(t->w3, t->dw0, t->dw1));
+	__m128 z = _mm_mul_ps(PLANE_SSE2(t->z3, t->dz0, t->dz1), w);
+	float* depth = depthBuffer + index;
+	__m128 oldZ  = _mm_loadu_ps(depth);
+
+	if (flags & TRI_DEPTH_TEST) {
+		mask = _mm_and_ps(mask, _mm_cmpnlt_ps(z, zero));
+		mask = _mm_and_ps(mask, _mm_cmpngt_ps(z, oldZ));
+		if (!_mm_movemask_ps(mask)) return;
+	}
+	if (!(flags & TRI_COLOR_WRITE)) {
+		if (flags & TRI_DEPTH_WRITE) _mm_storeu_ps(depth, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, oldZ)));
+		return;
+	}
+
+	__m128i lo, hi, color, vColor = _mm_set1_epi32(t->color);
+	__m128i bytes = _mm_setzero_si128();
+	if (flags & TRI_TEXTURED) {
+		__m128 u = _mm_mul_ps(PLANE_SSE2(t->u3, t->du0, t->du1), w);
+		__m128 v = _mm_mul_ps(PLANE_SSE2(t->v3, t->dv0, t->dv1), w);
+		__m128i texX = Floor_SSE2(_mm_mul_ps(u, _mm_set1_ps((float)(t->texWidthMask  + 1))));
+		__m128i texY = Floor_SSE2(_mm_mul_ps(v, _mm_set1_ps((float)(t->texHeightMask + 1))));
+
+		texX = _mm_and_si128(texX, _mm_set1_epi32(t->texWidthMask));
+		texY = _mm_and_si128(texY, _mm_set1_epi32(t->texHeightMask));
+		texX = _mm_or_si128(texX, _mm_sll_epi32(texY, _mm_cvtsi32_si128(t->texWidthShift)));
+
+		int texIndex[4];
+		_mm_storeu_si128((__m128i*)texIndex, texX);
+		color = _mm_set_epi32(t->texPixels[texIndex[3]], t->texPixels[texIndex[2]],
+							t->texPixels[texIndex[1]], t->texPixels[texIndex[0]]);
+
+		// Multiply each colour channel in 16 bit lanes, as 255 * 255 doesn't fit into 8 bits
+		vColor = _mm_unpacklo_epi8(vColor, bytes);
+		lo = Div255_SSE2(_mm_mullo_epi16(_mm_unpacklo_epi8(color, bytes), vColor));
+		hi = Div255_SSE2(_mm_mullo_epi16(_mm_unpackhi_epi8(color, bytes), vColor));
+	} else {
+		lo = _mm_unpacklo_epi8(vColor, bytes);
+		hi = lo;
+	}
+
+	// Calculated before blending, as alpha test uses the fragment's alpha
+	if (flags & TRI_ALPHA_TEST) {
+		color = _mm_packus_epi16(lo, hi);
+		color = _mm_and_si128(_mm_srli_epi32(color, BITMAPCOLOR_A_SHIFT), _mm_set1_epi32(0xFF));
+		mask  = _mm_and_ps(mask, _mm_castsi128_ps(_mm_cmpgt_epi32(color, _mm_set1_epi32(0x7F))));
+		if (!_mm_movemask_ps(mask)) return;
+	}
+
+	BitmapCol* dst = colorBuffer + index;
+	__m128i oldColor = _mm_loadu_si128((__m128i*)dst);
+	if (flags & TRI_ALPHA_BLEND) {
+		__m128i max = _mm_set1_epi16(255);
+		__m128i alphaLo = BroadcastAlpha_SSE2(lo), alphaHi = BroadcastAlpha_SSE2(hi);
+		__m128i dstLo   = _mm_unpacklo_epi8(oldColor, bytes);
+		__m128i dstHi   = _mm_unpackhi_epi8(oldColor, bytes);
+
+		lo = _mm_add_epi16(Div255_SSE2(_mm_mullo_epi16(lo, alphaLo)), 
+						   Div255_SSE2(_mm_mullo_epi16(dstLo, _mm_sub_epi16(max, alphaLo))));
+		hi = _mm_add_epi16(Div255_SSE2(_mm_mullo_epi16(hi, alphaHi)), 
+						   Div255_SSE2(_mm_mullo_epi16(dstHi, _mm_sub_epi16(max, alphaHi))));
+	}
+
+	color = _mm_or_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32((int)BITMAPCOLOR_A_MASK));
+	_mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_and_si128(_mm_castps_si128(mask), color), 
+												_mm_andnot_si128(_mm_castps_si128(mask), oldColor)));
+	if (flags & TRI_DEPTH_WRITE) _mm_storeu_ps(depth, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, oldZ)));
+}
+#endif
+
+// Narrows the range of pixels in a row to only those which might be on the inner side of an edge
+// NOTE: The range is widened by a pixel to account for floating point error, pixels are still tested individually
+static void ClipSpan(float ic, float dx, int* lo, int* hi) {
+	// Edge barely changes across the row, so not worth clipping against
+	if (Math_AbsF(dx) < 1e-4f) return;
+
+	// Calculate where the edge crosses zero, clamped so it can't overflow an int
+	float edge = -ic / dx;
+	edge = max(edge, -1.0f); edge = min(edge, *hi + 1.0f);
+
+	if (dx > 0) {
+		*lo = max(*lo, (int)edge - 1);
+	} else {
+		*hi = min(*hi, (int)edge + 1);
+	}
+}
+
+static void DrawTriangle(Triangle* t, int tileX, int tileY) {
+	int minX = max(t->minX, tileX), maxX = min(t->maxX, tileX + TILE_SIZE - 1);
+	int minY = max(t->minY, tileY), maxY = min(t->maxY, tileY + TILE_SIZE - 1);
+
+	// Reject triangle if it doesn't overlap any pixel centres in this tile at all
+	float xx  = minX + 0.5f - t->x3, yy = minY + 0.5f - t->y3;
+	float ic0 = xx * t->ic0_dx + yy * t->ic0_dy;
+	float ic1 = xx * t->ic1_dx + yy * t->ic1_dy;
+	int spanX = maxX - minX, spanY = maxY - minY;
+
+	if (PlaneMax(ic0, t->ic0_dx, t->ic0_dy, spanX, spanY) < 0) return;
+	if (PlaneMax(ic1, t->ic1_dx, t->ic1_dy, spanX, spanY) < 0) return;
+	if (PlaneMax(1.0f - ic0 - ic1, -t->ic0_dx - t->ic1_dx, -t->ic0_dy - t->ic1_dy, spanX, spanY) < 0) return;
+
+	for (int y = minY; y <= maxY; y++, ic0 += t->ic0_dy, ic1 += t->ic1_dy) 
+	{
+		int lo = 0, hi = spanX;
+		ClipSpan(ic0, t->ic0_dx, &lo, &hi);
+		ClipSpan(ic1, t->ic1_dx, &lo, &hi);
+		ClipSpan(1.0f - ic0 - ic1, -t->ic0_dx - t->ic1_dx, &lo, &hi);
+
+		int i = lo, index = y * width + minX;
+#ifdef SOFTGPU_SSE2
+		for (; i + 3 <= hi; i += 4) 
+		{
+			DrawPixels_SSE2(t, ic0, ic1, i, index + i);
 		}
+#endif
+		for (; i <= hi; i++) 
+		{
+			DrawPixel(t, ic0 + i * t->ic0_dx, ic1 + i * t->ic1_dx, index + i);
+		}
+	}
+}
+
+static void DrawTile(int tile) {
+	TileBin* bin = &tileBins[tile];
+	int tileX = (tile % tilesX) << TILE_SHIFT;
+	int tileY = (tile / tilesX) << TILE_SHIFT;
+
+	for (int i = 0; i < bin->count; i++)
+	{
+		DrawTriangle(&triangles[bin->items[i]], tileX, tileY);
+	}
+}
+
+/*########################################################################################################################*
+*--------------------------------------------------------Clipping---------------------------------------------------------*
+*#########################################################################################################################*/
+// Triangles crossing the near plane are clipped, so that every vertex has a positive W
+// Triangles are otherwise only clipped when they extend beyond the guard band around
+//  the viewport, which keeps screen coordinates small enough for integer setup maths,
+//  while avoiding clipping for the far more common case of slightly offscreen triangles
+#define GUARD_BAND_SIZE 8192
+#define MAX_CLIP_VERTICES 9
+
+enum ClipFlags {
+	CLIP_LEFT  = 0x01, CLIP_RIGHT  = 0x02, CLIP_BOTTOM  = 0x04, CLIP_TOP  = 0x08,
+	CLIP_NEAR  = 0x10,
+	GUARD_LEFT = 0x20, GUARD_RIGHT = 0x40, GUARD_BOTTOM = 0x80, GUARD_TOP = 0x100
+};
+#define CLIP_VIEWPORT_MASK (CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP | CLIP_NEAR)
+#define CLIP_REQUIRED_MASK (CLIP_NEAR | GUARD_LEFT | GUARD_RIGHT | GUARD_BOTTOM | GUARD_TOP)
+
+static int ClipCode(const ClipVertex* v) {
+	float gx = guard_width, gy = guard_height;
+	int code = 0;
+
+	if (v->x < -v->w) code |= CLIP_LEFT;
+	if (v->x >  v->w) code |= CLIP_RIGHT;
+	if (v->y < -v->w) code |= CLIP_BOTTOM;
+	if (v->y >  v->w) code |= CLIP_TOP;
+	if (v->z < -v->w) code |= CLIP_NEAR;
+
+	if (v->x < -gx * v->w) code |= GUARD_LEFT;
+	if (v->x >  gx * v->w) code |= GUARD_RIGHT;
+	if (v->y < -gy * v->w) code |= GUARD_BOTTOM;
+	if (v->y >  gy * v->w) code |= GUARD_TOP;
+	return code;
+}
+
+// Returns signed distance of a vertex from a clipping plane, negative when outside
+static float ClipDistance(const ClipVertex* v, int plane) {
+	float gx = guard_width, gy = guard_height;
+
+	switch (plane) {
+	case GUARD_LEFT:   return gx * v->w + v->x;
+	case GUARD_RIGHT:  return gx * v->w - v->x;
+	case GUARD_BOTTOM: return gy * v->w + v->y;
+	case GUARD_TOP:    return gy * v->w - v->y;
 	}
+	return v->z + v->w; // CLIP_NEAR
+}
+
+// Sutherland-Hodgman clipping of a convex polygon against a single plane
+static int ClipPolygon(const ClipVertex* in, int count, ClipVertex* out, int plane) {
+	int i, outCount = 0;
+
+	for (i = 0; i < count; i++)
+	{
+		const ClipVertex* a = &in[i];
+		const ClipVertex* b = &in[(i + 1) % count];
+		float aDist = ClipDistance(a, plane);
+		float bDist = ClipDistance(b, plane);
+
+		if (aDist >= 0) out[outCount++] = *a;
+		if ((aDist >= 0) == (bDist >= 0)) continue;
+
+		// Edge crosses the plane, so add the intersection point
+		float t = aDist / (aDist - bDist);
+		ClipVertex* v = &out[outCount++];
+		v->x = a->x + (b->x - a->x) * t;
+		v->y = a->y + (b->y - a->y) * t;
+		v->z = a->z + (b->z - a->z) * t;
+		v->w = a->w + (b->w - a->w) * t;
+		v->u = a->u + (b->u - a->u) * t;
+		v->v = a->v + (b->v - a->v) * t;
+	}
+	return outCount;
+}
+
+static void DrawClipped(const ClipVertex* v1, const ClipVertex* v2, const ClipVertex* v3,
+						int code1, int code2, int code3, PackedCol color) {
+	ClipVertex bufferA[MAX_CLIP_VERTICES], bufferB[MAX_CLIP_VERTICES];
+	ClipVertex* in  = bufferA;
+	ClipVertex* out = bufferB;
+	Vector4 frag[MAX_CLIP_VERTICES];
+	Vector2 uv[MAX_CLIP_VERTICES];
+	int i, plane, count = 3;
+
+	// Reject triangles completely outside one side of the viewport
+	if (code1 & code2 & code3 & CLIP_VIEWPORT_MASK) return;
+	int clip = (code1 | code2 | code3) & CLIP_REQUIRED_MASK;
+
+	if (!clip) {
+		ProjectVertex(v1, &frag[0], &uv[0]);
+		ProjectVertex(v2, &frag[1], &uv[1]);
+		ProjectVertex(v3, &frag[2], &uv[2]);
+		SetupTriangle(frag[0], frag[1], frag[2], uv[0], uv[1], uv[2], color);
+		return;
+	}
+
+	in[0] = *v1; in[1] = *v2; in[2] = *v3;
+	for (plane = CLIP_NEAR; plane <= GUARD_TOP; plane <<= 1)
+	{
+		if (!(clip & plane)) continue;
+		count = ClipPolygon(in, count, out, plane);
+		if (count < 3) return;
+
+		ClipVertex* tmp = in; in = out; out = tmp;
+	}
+
+	for (i = 0; i < count; i++) 
+	{
+		// Vertices exactly on the near plane can still end up with 0 W for orthographic projections
+		if (in[i].w <= 0) return;
+		ProjectVertex(&in[i], &frag[i], &uv[i]);
+	}
+	// Clipped polygon is convex, so can be drawn as a triangle fan
+	for (i = 1; i < count - 1; i++)
+	{
+		SetupTriangle(frag[0], frag[i], frag[i + 1], uv[0], uv[i], uv[i + 1], color);
+	}
+}
+
+// Whether a quad faces away from the camera, calculated in clip space so it is correct
+//  even when vertices are behind the camera (i.e. using the homogeneous determinant)
+static cc_bool IsBackFacing(const ClipVertex* v) {
+#define Det3(a, b, c) (a.x * (b.y * c.w - c.y * b.w) - b.x * (a.y * c.w - c.y * a.w) + c.x * (a.y * b.w - b.y * a.w))
+	// Quad is planar, so summing both triangles avoids issues when one is degenerate
+	float area = Det3(v[0], v[1], v[2]) + Det3(v[2], v[3], v[0]);
+	return area < 0;
 }
 
 void DrawQuads(int startVertex, int verticesCount) {
-	Vector4 frag[4];
-	Vector2 uv[4];
+	ClipVertex vertices[4];
 	PackedCol color[4];
+	int code[4];
 	int j = startVertex;
 
 	// 4 vertices = 1 quad = 2 triangles
 	for (int i = 0; i < verticesCount / 4; i++, j += 4)
 	{
-		TransformVertex(j + 0, &frag[0], &uv[0], &color[0]);
-		TransformVertex(j + 1, &frag[1], &uv[1], &color[1]);
-		TransformVertex(j + 2, &frag[2], &uv[2], &color[2]);
-		TransformVertex(j + 3, &frag[3], &uv[3], &color[3]);
-
-		DrawTriangle(frag[0], frag[1], frag[2], 
-					uv[0], uv[1], uv[2], color[0]);
-
-		DrawTriangle(frag[2], frag[3], frag[0],
-					uv[2], uv[3], uv[0], color[2]);
+		TransformVertex(j + 0, &vertices[0]); code[0] = ClipCode(&vertices[0]);
+		TransformVertex(j + 1, &vertices[1]); code[1] = ClipCode(&vertices[1]);
+		TransformVertex(j + 2, &vertices[2]); code[2] = ClipCode(&vertices[2]);
+		TransformVertex(j + 3, &vertices[3]); code[3] = ClipCode(&vertices[3]);
+
+		// Reject whole quad before doing any further work when possible
+		if (code[0] & code[1] & code[2] & code[3] & CLIP_VIEWPORT_MASK) continue;
+		if (faceCulling && IsBackFacing(vertices)) continue;
+
+		LoadVertexAttribs(j + 0, &vertices[0], &color[0]);
+		LoadVertexAttribs(j + 1, &vertices[1], &color[1]);
+		LoadVertexAttribs(j + 2, &vertices[2], &color[2]);
+		LoadVertexAttribs(j + 3, &vertices[3], &color[3]);
+
+		DrawClipped(&vertices[0], &vertices[1], &vertices[2], 
+					code[0], code[1], code[2], color[0]);
+		DrawClipped(&vertices[2], &vertices[3], &vertices[0], 
+					code[2], code[3], code[0], color[2]);
 	}
 }
 
@@ -453,6 +1038,7 @@ void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
 *#########################################################################################################################*/
 cc_result Gfx_TakeScreenshot(struct Stream* output) {
 	struct Bitmap bmp;
+	FlushTriangles();
 	Bitmap_Init(bmp, width, height, colorBuffer);
 	return Png_Encode(&bmp, output, NULL, false, NULL);
 }
@@ -465,6 +1051,7 @@ void Gfx_BeginFrame(void) { }
 
 void Gfx_EndFrame(void) {
 	Rect2D r = { 0, 0, width, height };
+	FlushTriangles();
 	Window_DrawFramebuffer(r, &fb_bmp);
 }
 
@@ -481,6 +1068,9 @@ void Gfx_OnWindowResize(void) {
 
 	vp_hwidth  = width  / 2.0f;
 	vp_hheight = height / 2.0f;
+	// Guard band limits in normalised device coordinates
+	guard_width  = 1.0f + GUARD_BAND_SIZE / vp_hwidth;
+	guard_height = 1.0f + GUARD_BAND_SIZE / vp_hheight;
 
 	sc_maxX = width  - 1;
 	sc_maxY = height - 1;
@@ -488,6 +1078,7 @@ void Gfx_OnWindowResize(void) {
 	Window_AllocFramebuffer(&fb_bmp);
 	depthBuffer = Mem_Alloc(width * height, 4, "depth buffer");
 	colorBuffer = fb_bmp.scan0;
+	AllocBins();
 }
 
 void Gfx_SetViewport(int x, int y, int w, int h) { }
@@ -43,12 +43,16 @@ struct HttpRequest {
 	char etag[STRING_SIZE];         /* ETag of cached item (if any) */
 	cc_uint8 requestType;           /* See the various REQUEST_TYPE_ */
 	cc_bool success;                /* Whether Result is 0, status is 200, and data is not NULL */
+	cc_uint8 flags;                 /* See the various HTTP_FLAG_ */
 	struct StringsBuffer* cookies;  /* Cookie list sent in requests. May be modified by the response. */
 };
 
 /* Frees all dynamically allocated data from a HTTP request */
 void HttpRequest_Free(struct HttpRequest* request);
 
+/* Retrieves the URL a skin is downloaded from. */
+/* If skinName is a url, that url. (if not, SKIN_SERVER/[skinName].png) */
+void Http_GetSkinUrl(const cc_string* skinName, cc_string* url);
 /* Aschronously performs a http GET request to download a skin. */
 /* If url is a skin, downloads from there. (if not, downloads from SKIN_SERVER/[skinName].png) */
 int Http_AsyncGetSkin(const cc_string* skinName, cc_uint8 flags);
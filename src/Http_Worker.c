@@ -2,6 +2,21 @@
 #ifndef CC_BUILD_WEB
 #include "_HttpBase.h"
 
+/* Android backend stores the current request globally, and CFNetwork backend has only ever been used from one thread */
+#if defined CC_BUILD_ANDROID || defined CC_BUILD_CFNETWORK
+#define HTTP_MAX_WORKERS 1
+#else
+#define HTTP_MAX_WORKERS 8
+#endif
+
+#if defined CC_BUILD_LOWMEM
+#define HTTP_DEF_WORKERS 1
+#else
+#define HTTP_DEF_WORKERS min(4, HTTP_MAX_WORKERS)
+#endif
+/* Maximum number of requests to the same host that may be in progress at once */
+#define HTTP_MAX_HOST_REQUESTS 6
+
 /* Allocates initial data buffer to store response contents */
 static void Http_BufferInit(struct HttpRequest* req) {
 	req->progress  = 0;
@@ -222,8 +237,31 @@ static cc_bool LoadCurlFuncs(void) {
 	return success;
 }
 
-static CURL* curl;
 static cc_bool curlSupported, curlVerbose;
+/* Each worker needs its own easy handle, since a handle can only be used by one thread at a time */
+static CURL* curlHandles[HTTP_MAX_WORKERS];
+static int curlHandlesCount;
+static void* curlHandlesMutex;
+
+/* Retrieves an easy handle that is not in use by any other worker */
+static CURL* CurlHandle_Acquire(void) {
+	CURL* curl;
+	Mutex_Lock(curlHandlesMutex);
+	{
+		curl = curlHandlesCount ? curlHandles[--curlHandlesCount] : _curl_easy_init();
+	}
+	Mutex_Unlock(curlHandlesMutex);
+	return curl;
+}
+
+/* Returns an easy handle, so that it can be reused by later requests (e.g. for keep-alive) */
+static void CurlHandle_Release(CURL* curl) {
+	Mutex_Lock(curlHandlesMutex);
+	{
+		curlHandles[curlHandlesCount++] = curl;
+	}
+	Mutex_Unlock(curlHandlesMutex);
+}
 
 static cc_bool HttpBackend_DescribeError(cc_result res, cc_string* dst) {
 	const char* err;
@@ -239,6 +277,7 @@ static cc_bool HttpBackend_DescribeError(cc_result res, cc_string* dst) {
 static void HttpBackend_Init(void) {
 	static const cc_string msg = String_FromConst("Failed to init libcurl. All HTTP requests will therefore fail.");
 	CURLcode res;
+	CURL* curl;
 
 	if (!LoadCurlFuncs()) { Logger_WarnFunc(&msg); return; }
 	res = _curl_global_init(CURL_GLOBAL_DEFAULT);
@@ -246,6 +285,8 @@ static void HttpBackend_Init(void) {
 	curl = _curl_easy_init();
 	if (!curl) { Logger_SimpleWarn(res, "initing curl_easy"); return; }
 
+	curlHandlesMutex = Mutex_Create();
+	curlHandles[curlHandlesCount++] = curl;
 	curlSupported = true;
 	curlVerbose = Options_GetBool("curl-verbose", false);
 }
@@ -286,7 +327,7 @@ static size_t Http_ProcessData(char *buffer, size_t size, size_t nitems, void* u
 }
 
 /* Sets general curl options for a request */
-static void Http_SetCurlOpts(struct HttpRequest* req) {
+static void Http_SetCurlOpts(CURL* curl, struct HttpRequest* req) {
 	_curl_easy_setopt(curl, CURLOPT_USERAGENT,      GAME_APP_NAME);
 	_curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 	_curl_easy_setopt(curl, CURLOPT_MAXREDIRS,      20L);
@@ -307,13 +348,17 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
 	char urlStr[NATIVE_STR_LEN];
 	void* post_data = req->data;
 	CURLcode res;
+	CURL* curl;
 	if (!curlSupported) return ERR_NOT_SUPPORTED;
 
+	curl = CurlHandle_Acquire();
+	if (!curl) return ERR_OUT_OF_MEMORY;
+
 	req->meta = NULL;
 	Http_SetRequestHeaders(req);
 	_curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->meta);
 
-	Http_SetCurlOpts(req);
+	Http_SetCurlOpts(curl, req);
 	String_EncodeUtf8(urlStr, url);
 	_curl_easy_setopt(curl, CURLOPT_URL, urlStr);
 
@@ -353,6 +398,7 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
 	/* can free now that request has finished */
 	Mem_Free(post_data);
 	_curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, NULL);
+	CurlHandle_Release(curl);
 	return res;
 }
 #elif defined CC_BUILD_HTTPCLIENT
@@ -519,46 +565,75 @@ static cc_result HttpConnection_Write(struct HttpConnection* conn, const cc_uint
 /*########################################################################################################################*
 *-----------------------------------------------------Connection Pool-----------------------------------------------------*
 *#########################################################################################################################*/
+/* NOTE: The pool is shared by all the workers, so entries are marked as in use */
+/*  while a worker is performing a request with them */
 static struct ConnectionPoolEntry {
 	struct HttpConnection conn;
 	cc_string addr;
 	char addrBuffer[STRING_SIZE];
-	cc_bool https;
+	cc_bool https, inUse;
 } connection_pool[10];
+static void* connection_poolMutex;
 
-static cc_result ConnectionPool_Insert(int i, struct HttpConnection** conn, const struct HttpUrl* url) {
-	struct ConnectionPoolEntry* e = &connection_pool[i];
-	*conn = &e->conn;
-
-	String_InitArray(e->addr, e->addrBuffer);
-	String_Copy(&e->addr, &url->address);
-	e->https = url->https;
-	return HttpConnection_Open(&e->conn, url);
-}
-
-static cc_result ConnectionPool_Open(struct HttpConnection** conn, const struct HttpUrl* url) {
+static struct ConnectionPoolEntry* ConnectionPool_Find(const struct HttpUrl* url) {
 	struct ConnectionPoolEntry* e;
-	int i;
+	int i, beg;
 
 	for (i = 0; i < Array_Elems(connection_pool); i++)
 	{
 		e = &connection_pool[i];
-		if (e->conn.valid && e->https == url->https && String_Equals(&e->addr, &url->address)) {
-			*conn = &connection_pool[i].conn;
-			return 0;
-		}
+		if (e->inUse || !e->conn.valid) continue;
+		if (e->https == url->https && String_Equals(&e->addr, &url->address)) return e;
 	}
 
 	for (i = 0; i < Array_Elems(connection_pool); i++)
 	{
 		e = &connection_pool[i];
-		if (!e->conn.valid) return ConnectionPool_Insert(i, conn, url);
+		if (!e->inUse && !e->conn.valid) return e;
 	}
 
 	/* TODO: Should we be consistent in which entry gets evicted? */
-	i = (cc_uint8)Stopwatch_Measure() % Array_Elems(connection_pool);
-	HttpConnection_Close(&connection_pool[i].conn);
-	return ConnectionPool_Insert(i, conn, url);
+	/* There are always more entries than workers, so at least one entry is not in use */
+	beg = (cc_uint8)Stopwatch_Measure() % Array_Elems(connection_pool);
+	for (i = 0; i < Array_Elems(connection_pool); i++)
+	{
+		e = &connection_pool[(beg + i) % Array_Elems(connection_pool)];
+		if (!e->inUse) break;
+	}
+	HttpConnection_Close(&e->conn);
+	return e;
+}
+
+static cc_result ConnectionPool_Open(struct HttpConnection** conn, const struct HttpUrl* url) {
+	struct ConnectionPoolEntry* e;
+	Mutex_Lock(connection_poolMutex);
+	{
+		e = ConnectionPool_Find(url);
+		e->inUse = true;
+	}
+	Mutex_Unlock(connection_poolMutex);
+
+	*conn = &e->conn;
+	if (e->conn.valid) return 0;
+
+	/* Connecting may take a while, so avoid blocking other workers during it */
+	String_InitArray(e->addr, e->addrBuffer);
+	String_Copy(&e->addr, &url->address);
+	e->https = url->https;
+	return HttpConnection_Open(&e->conn, url);
+}
+
+/* Allows the given connection to be reused by other requests */
+static void ConnectionPool_Release(struct HttpConnection* conn) {
+	int i;
+	Mutex_Lock(connection_poolMutex);
+	{
+		for (i = 0; i < Array_Elems(connection_pool); i++)
+		{
+			if (&connection_pool[i].conn == conn) connection_pool[i].inUse = false;
+		}
+	}
+	Mutex_Unlock(connection_poolMutex);
 }
 
 
@@ -886,6 +961,7 @@ static cc_result HttpClient_HandleRedirect(struct HttpClientState* state) {
 *-----------------------------------------------Http backend implementation-----------------------------------------------*
 *#########################################################################################################################*/
 static void HttpBackend_Init(void) {
+	connection_poolMutex = Mutex_Create();
 	SSLBackend_Init(httpsVerify);
 	//httpOnly = true; // TODO: insecure
 }
@@ -898,14 +974,11 @@ static cc_result HttpBackend_PerformRequest(struct HttpClientState* state) {
 	cc_result res;
 
 	res = ConnectionPool_Open(&state->conn, &state->url);
-	if (res) { HttpConnection_Close(state->conn); return res; }
+	if (!res) res = HttpClient_SendRequest(state);
+	if (!res) res = HttpClient_ParseResponse(state);
 
-	res = HttpClient_SendRequest(state);
-	if (res) { HttpConnection_Close(state->conn); return res; }
-
-	res = HttpClient_ParseResponse(state);
 	if (res) HttpConnection_Close(state->conn);
-
+	ConnectionPool_Release(state->conn);
 	return res;
 }
 
@@ -1205,14 +1278,22 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
 #endif
 
 
+struct HttpWorker {
+	void* thread;
+	struct HttpRequest request; /* Request currently being processed (id is 0 if none) */
+	/* Host the current request is to, and whether it has priority (protected by pendingMutex) */
+	char hostBuffer[STRING_SIZE];
+	cc_string host;
+	cc_bool busy, priority;
+};
+static struct HttpWorker workers[HTTP_MAX_WORKERS];
+static int workersCount, workersStarted;
 static void* workerWaitable;
-static void* workerThread;
 
 static void* pendingMutex;
 static struct RequestList pendingReqs;
-
+/* Protects the request of each worker */
 static void* curRequestMutex;
-static struct HttpRequest http_curRequest;
 
 
 /*########################################################################################################################*
@@ -1231,20 +1312,35 @@ cc_bool Http_GetResult(int reqID, struct HttpRequest* item) {
 }
 
 cc_bool Http_GetCurrent(int* reqID, int* progress) {
+	int i;
+	*reqID    = 0;
+	*progress = HTTP_PROGRESS_NOT_WORKING_ON;
+
 	Mutex_Lock(curRequestMutex);
 	{
-		*reqID    = http_curRequest.id;
-		*progress = http_curRequest.progress;
+		for (i = 0; i < workersCount; i++) 
+		{
+			if (!workers[i].request.id) continue;
+			*reqID    = workers[i].request.id;
+			*progress = workers[i].request.progress;
+			break;
+		}
 	}
 	Mutex_Unlock(curRequestMutex);
 	return *reqID != 0;
 }
 
 int Http_CheckProgress(int reqID) {
-	int curReqID, progress;
-	Http_GetCurrent(&curReqID, &progress);
+	int i, progress = HTTP_PROGRESS_NOT_WORKING_ON;
 
-	if (reqID != curReqID) progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	Mutex_Lock(curRequestMutex);
+	{
+		for (i = 0; i < workersCount; i++) 
+		{
+			if (workers[i].request.id == reqID) progress = workers[i].request.progress;
+		}
+	}
+	Mutex_Unlock(curRequestMutex);
 	return progress;
 }
 
@@ -1274,8 +1370,19 @@ void Http_TryCancel(int reqID) {
 /*########################################################################################################################*
 *-----------------------------------------------------Http worker---------------------------------------------------------*
 *#########################################################################################################################*/
+/* Extracts the host from a url (e.g. "static.classicube.net" from "https://static.classicube.net/skins/a.png") */
+static void GetUrlHost(const char* rawUrl, cc_string* host) {
+	cc_string url = String_FromReadonly(rawUrl);
+	cc_string path, addr, resource;
+	int idx = String_IndexOfConst(&url, "://");
+
+	path = idx == -1 ? url : String_UNSAFE_SubstringAt(&url, idx + 3);
+	String_UNSAFE_Separate(&path, '/', &addr, &resource);
+	String_Copy(host, &addr);
+}
+
 /* Sets up state to begin a http request */
-static void PrepareCurrentRequest(struct HttpRequest* req, cc_string* url) {
+static void PrepareCurrentRequest(struct HttpWorker* w, struct HttpRequest* req, cc_string* url) {
 	static const char* verbs[] = { "GET", "HEAD", "POST" };
 	Http_GetUrl(req, url);
 	Platform_Log2("Fetching %s (%c)", url, verbs[req->requestType]);
@@ -1283,8 +1390,8 @@ static void PrepareCurrentRequest(struct HttpRequest* req, cc_string* url) {
 
 	Mutex_Lock(curRequestMutex);
 	{
-		HttpRequest_Copy(&http_curRequest, req);
-		http_curRequest.progress = HTTP_PROGRESS_MAKING_REQUEST;
+		HttpRequest_Copy(&w->request, req);
+		w->request.progress = HTTP_PROGRESS_MAKING_REQUEST;
 	}
 	Mutex_Unlock(curRequestMutex);
 }
@@ -1304,43 +1411,100 @@ static void PerformRequest(struct HttpRequest* req, cc_string* url) {
 	Http_FinishRequest(req);
 }
 
-static void ClearCurrentRequest(void) {
+static void ClearCurrentRequest(struct HttpWorker* w) {
 	Mutex_Lock(curRequestMutex);
 	{
-		http_curRequest.id       = 0;
-		http_curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
+		w->request.id       = 0;
+		w->request.progress = HTTP_PROGRESS_NOT_WORKING_ON;
 	}
 	Mutex_Unlock(curRequestMutex);
 }
 
-static void DoRequest(struct HttpRequest* request) {
+static void DoRequest(struct HttpWorker* w, struct HttpRequest* request) {
 	char urlBuffer[URL_MAX_SIZE]; cc_string url;
 
 	String_InitArray(url, urlBuffer);
-	PrepareCurrentRequest(request, &url);
-	PerformRequest(&http_curRequest, &url);
-	ClearCurrentRequest();
+	PrepareCurrentRequest(w, request, &url);
+	PerformRequest(&w->request, &url);
+	ClearCurrentRequest(w);
 }
 
-static void WorkerLoop(void) {
-	struct HttpRequest request;
-	cc_bool hasRequest;
+/* Whether a worker is allowed to start processing the given request */
+/* NOTE: Must be called while holding pendingMutex */
+static cc_bool CanStartRequest(struct HttpRequest* req, const cc_string* host) {
+	int i, busy = 0, sameHost = 0;
+	/* Priority requests (e.g. texture packs) never wait for other requests */
+	if (req->flags & HTTP_FLAG_PRIORITY) return true;
 
-	for (;;) {
-		hasRequest = false;
+	for (i = 0; i < workersCount; i++) 
+	{
+		if (!workers[i].busy || workers[i].priority) continue;
+		busy++;
+		if (String_CaselessEquals(&workers[i].host, host)) sameHost++;
+	}
 
-		Mutex_Lock(pendingMutex);
+	/* Always keep one worker free for priority requests, so they don't get stuck behind e.g. skins */
+	if (workersCount > 1 && busy >= workersCount - 1) return false;
+	return sameHost < HTTP_MAX_HOST_REQUESTS;
+}
+
+/* Finds the first pending request that can be started, then removes it from the pending list */
+static cc_bool TakePendingRequest(struct HttpWorker* w, struct HttpRequest* request) {
+	cc_string host; char hostBuffer[STRING_SIZE];
+	cc_bool hasRequest = false, morePending = false;
+	int i;
+
+	Mutex_Lock(pendingMutex);
+	{
+		for (i = 0; i < pendingReqs.count; i++) 
 		{
-			if (pendingReqs.count) {
-				HttpRequest_Copy(&request, &pendingReqs.entries[0]);
-				hasRequest = true;
-				RequestList_RemoveAt(&pendingReqs, 0);
-			}
+			String_InitArray(host, hostBuffer);
+			GetUrlHost(pendingReqs.entries[i].url, &host);
+			if (!CanStartRequest(&pendingReqs.entries[i], &host)) continue;
+
+			HttpRequest_Copy(request, &pendingReqs.entries[i]);
+			RequestList_RemoveAt(&pendingReqs, i);
+
+			w->host.length = 0;
+			String_Copy(&w->host, &host);
+			w->busy     = true;
+			w->priority = request->flags & HTTP_FLAG_PRIORITY;
+			hasRequest  = true;
+			break;
 		}
-		Mutex_Unlock(pendingMutex);
+		morePending = hasRequest && pendingReqs.count;
+	}
+	Mutex_Unlock(pendingMutex);
+
+	/* Signals only wake up one worker, so wake up another to process the remaining requests */
+	if (morePending) Waitable_Signal(workerWaitable);
+	return hasRequest;
+}
+
+static void FinishWorkerRequest(struct HttpWorker* w) {
+	Mutex_Lock(pendingMutex);
+	{
+		w->busy     = false;
+		w->priority = false;
+	}
+	Mutex_Unlock(pendingMutex);
+}
 
-		if (hasRequest) {
-			DoRequest(&request);
+static void WorkerLoop(void) {
+	struct HttpWorker* w;
+	struct HttpRequest request;
+
+	/* Thread functions don't have an argument, so claim the next unclaimed worker */
+	Mutex_Lock(pendingMutex);
+	{
+		w = &workers[workersStarted++];
+	}
+	Mutex_Unlock(pendingMutex);
+
+	for (;;) {
+		if (TakePendingRequest(w, &request)) {
+			DoRequest(w, &request);
+			FinishWorkerRequest(w);
 		} else {
 			/* Block until another thread submits a request to do */
 			Platform_LogConst("Going back to sleep...");
@@ -1349,11 +1513,11 @@ static void WorkerLoop(void) {
 	}
 }
 
-/* Adds a req to the list of pending requests, waking up worker thread if needed */
+/* Adds a req to the list of pending requests, waking up a worker thread if needed */
 static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags) {
 #if defined CC_BUILD_PSP || defined CC_BUILD_NDS
 	/* TODO why doesn't threading work properly on PSP */
-	DoRequest(req);
+	DoRequest(&workers[0], req);
 #else
 	Mutex_Lock(pendingMutex);
 	{
@@ -1368,10 +1532,10 @@ static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags) {
 *-----------------------------------------------------Http component------------------------------------------------------*
 *#########################################################################################################################*/
 static void Http_Init(void) {
+	int i;
 	Http_InitCommon();
-	http_curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
 	/* Http component gets initialised multiple times on Android */
-	if (workerThread) return;
+	if (workersCount) return;
 
 	HttpBackend_Init();
 	RequestList_Init(&pendingReqs);
@@ -1381,7 +1545,19 @@ static void Http_Init(void) {
 	pendingMutex    = Mutex_Create();
 	processedMutex  = Mutex_Create();
 	curRequestMutex = Mutex_Create();
-	
-	Thread_Run(&workerThread, WorkerLoop, 128 * 1024, "HTTP");
+
+	workersCount = Options_GetInt(OPT_HTTP_WORKERS, 1, HTTP_MAX_WORKERS, HTTP_DEF_WORKERS);
+	for (i = 0; i < workersCount; i++) 
+	{
+		workers[i].request.progress = HTTP_PROGRESS_NOT_WORKING_ON;
+		String_InitArray(workers[i].host, workers[i].hostBuffer);
+	}
+
+#if !defined CC_BUILD_PSP && !defined CC_BUILD_NDS
+	for (i = 0; i < workersCount; i++) 
+	{
+		Thread_Run(&workers[i].thread, WorkerLoop, 128 * 1024, "HTTP");
+	}
+#endif
 }
 #endif
@@ -52,7 +52,9 @@ static int ClassicLighting_CalcHeightAt(int x, int maxY, int z, int hIndex) {
 	BlockID block;
 	int y, offset;
 
-#ifndef EXTENDED_BLOCKS
+#if defined CC_BUILD_CHUNKEDWORLD
+	ClassicLighting_CalcBody(World_GetBlock(x, y, z));
+#elif !defined EXTENDED_BLOCKS
 	ClassicLighting_CalcBody(World.Blocks[i]);
 #else
 	if (World.IDMask <= 0xFF) {
@@ -179,7 +181,9 @@ static cc_bool ClassicLighting_NeedsNeighour(BlockID block, int i, int minY, int
 	BlockID other;
 	cc_bool affected;
 
-#ifndef EXTENDED_BLOCKS
+#if defined CC_BUILD_CHUNKEDWORLD
+	ClassicLighting_NeedsNeighourBody(World_GetRawBlock(i));
+#elif !defined EXTENDED_BLOCKS
 	ClassicLighting_NeedsNeighourBody(World.Blocks[i]);
 #else
 	if (World.IDMask <= 0xFF) {
@@ -297,6 +301,55 @@ static int Heightmap_InitialCoverage(int x1, int z1, int xCount, int zCount, int
 	return elemsLeft;
 }
 
+#ifdef CC_BUILD_CHUNKEDWORLD
+/* Whether the given row of blocks is entirely air */
+/* Rows inside chunks that are entirely air can be skipped without looking at any blocks */
+static cc_bool Heightmap_IsAirRow(int i, int count) {
+	const struct WorldChunk* chunk;
+	int x, y, z, len;
+	World_Unpack(i, x, y, z);
+
+	for (; count > 0; x += len, count -= len) {
+		chunk = &World.Chunks[World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)];
+		if (chunk->data || chunk->uniform != BLOCK_AIR) return false;
+		len = CHUNK_SIZE - (x & CHUNK_MASK);
+	}
+	return true;
+}
+#else
+/* Whether all the given blocks are 0, checking a machine word's worth of blocks at a time */
+static cc_bool Heightmap_IsZeroRun(const BlockRaw* blocks, int count) {
+	const cc_uintptr* words;
+
+	for (; count && ((cc_uintptr)blocks & (sizeof(cc_uintptr) - 1)); count--) {
+		if (*blocks++) return false;
+	}
+
+	words = (const cc_uintptr*)blocks;
+	for (; count >= (int)sizeof(cc_uintptr); count -= sizeof(cc_uintptr)) {
+		if (*words++) return false;
+	}
+
+	blocks = (const BlockRaw*)words;
+	for (; count; count--) {
+		if (*blocks++) return false;
+	}
+	return true;
+}
+
+/* Whether the given row of blocks is entirely air */
+/* Most of the upper part of a tall world is usually air, so this skips most of the per-block lookups */
+/* NOTE: Rows with other blocks that don't block light (e.g. flowers) aren't skipped, as that would */
+/*  still need a lookup per non-air block, and such rows are too rare for it to make any difference */
+static cc_bool Heightmap_IsAirRow(int i, int count) {
+	if (!Heightmap_IsZeroRun(World.Blocks + i, count)) return false;
+#ifdef EXTENDED_BLOCKS
+	if (World.IDMask > 0xFF) return Heightmap_IsZeroRun(World.Blocks2 + i, count);
+#endif
+	return true;
+}
+#endif
+
 #define Heightmap_CalculateBody(get_block)\
 for (y = World.Height - 1; y >= 0; y--) {\
 	if (elemsLeft <= 0) { return true; } \
@@ -306,7 +359,8 @@ for (y = World.Height - 1; y >= 0; y--) {\
 	for (z = 0; z < zCount; z++) {\
 		baseIndex = mapIndex;\
 		index = z * xCount;\
-		for (x = 0; x < xCount;) {\
+		x = skipAir && Heightmap_IsAirRow(mapIndex, xCount) ? xCount : 0;\
+		for (; x < xCount;) {\
 			curRunCount = skip[index];\
 			x += curRunCount; mapIndex += curRunCount; index += curRunCount;\
 \
@@ -345,8 +399,11 @@ static cc_bool Heightmap_CalculateCoverage(int x1, int z1, int xCount, int zCoun
 	int lightOffset, offset;
 	int mapIndex, hIndex, baseIndex, index;
 	int x, y, z;
+	cc_bool skipAir = !Blocks.BlocksLight[BLOCK_AIR];
 
-#ifndef EXTENDED_BLOCKS
+#if defined CC_BUILD_CHUNKEDWORLD
+	Heightmap_CalculateBody(World_GetBlock(x1 + x, y, z1 + z));
+#elif !defined EXTENDED_BLOCKS
 	Heightmap_CalculateBody(World.Blocks[mapIndex]);
 #else
 	if (World.IDMask <= 0xFF) {
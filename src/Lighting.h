@@ -74,6 +74,10 @@ CC_VAR extern struct _Lighting {
 
 void FancyLighting_SetActive(void);
 void FancyLighting_OnInit(void);
+/* Counts how many chunks have one byte of light data per cell, how many have light data packed into fewer */
+/*  bits per cell, and how many have the same light data for every cell, and how many bytes that all uses */
+/* Returns 0 for all when fancy lighting is not active */
+void FancyLighting_GetMemoryUsage(int* denseChunks, int* packedChunks, int* uniformChunks, int* bytes);
 
 /* Expose ClassicLighting functions for reuse in Fancy lighting */
 void ClassicLighting_Refresh(void);
@@ -14,6 +14,7 @@
 #include "Utils.h"
 #include "World.h"
 #include "Options.h"
+#include "Profiler.h"
 
 int MapRenderer_1DUsedCount;
 struct ChunkPartInfo* MapRenderer_PartsNormal;
@@ -42,10 +43,23 @@ static struct ChunkInfo** renderChunks;
 static int renderChunksCount;
 /* Distance of each chunk from the camera. */
 static cc_uint32* distances;
+/* Temp arrays used when sorting sortedChunks and distances */
+static struct ChunkInfo** sortedTemp;
+static cc_uint32* distancesTemp;
 /* Maximum number of chunk updates that can be performed in one frame. */
 static int maxChunkUpdates;
 /* Cached number of chunks in the world */
 static int chunksCount;
+/* Per chunk state and queue used when calculating which chunks are occluded */
+static cc_uint16* visitFlags;
+static int* visitQueue;
+/* Whether which chunks are occluded needs to be recalculated */
+static cc_bool occlusionDirty;
+/* Whether chunks have become less see through since occlusion was last calculated */
+/* NOTE: The previous result only occludes too few chunks then, so is only recalculated periodically */
+static cc_bool occlusionStale;
+/* Time since occlusionStale was set */
+static float occlusionStaleTime;
 
 static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 	chunk->centreX = x + HALF_CHUNK_SIZE; chunk->centreY = y + HALF_CHUNK_SIZE; 
@@ -56,6 +70,9 @@ static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 
 	chunk->visible = true;        chunk->empty = false;
 	chunk->pendingDelete = false; chunk->allAir = false;
+	chunk->building = false;      chunk->occluded = false;
+	/* Assume unbuilt chunks can be seen through */
+	chunk->connections = CHUNK_CONNECTIONS_ALL;
 	chunk->drawXMin = false; chunk->drawXMax = false; chunk->drawZMin = false;
 	chunk->drawZMax = false; chunk->drawYMin = false; chunk->drawYMax = false;
 
@@ -96,11 +113,11 @@ static void CheckWeather(float delta) {
 }
 
 #ifdef CC_BUILD_GL11
-#define DrawFace(face, ign)    Gfx_BindVb(part.vbs[face]); Gfx_DrawIndexedTris_T2fC4b(0, 0);
+#define DrawFace(face, ign)    Gfx_BindVb(part.vbs[face]); Gfx_DrawIndexedTris_T2fC4b(0, 0); Game_DrawCalls++;
 #define DrawFaces(f1, f2, ign) DrawFace(f1, ign); DrawFace(f2, ign);
 #else
-#define DrawFace(face, offset)    Gfx_DrawIndexedTris_T2fC4b(part.counts[face], offset);
-#define DrawFaces(f1, f2, offset) Gfx_DrawIndexedTris_T2fC4b(part.counts[f1] + part.counts[f2], offset);
+#define DrawFace(face, offset)    Gfx_DrawIndexedTris_T2fC4b(part.counts[face], offset); Game_DrawCalls++;
+#define DrawFaces(f1, f2, offset) Gfx_DrawIndexedTris_T2fC4b(part.counts[f1] + part.counts[f2], offset); Game_DrawCalls++;
 #endif
 
 #define DrawNormalFaces(minFace, maxFace) \
@@ -160,24 +177,24 @@ static void RenderNormalBatch(int batch) {
 #ifdef CC_BUILD_GL11
 		Gfx_BindVb(part.vbs[FACE_COUNT]);
 		Gfx_DrawIndexedTris_T2fC4b(0, 0);
-		Game_Vertices += count * 4;
+		Game_Vertices += count * 4; Game_DrawCalls++;
 		Gfx_SetFaceCulling(false);
 		continue;
 #endif
 		if (info->drawXMax || info->drawZMin) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count; Game_DrawCalls++;
 		} offset += count;
 
 		if (info->drawXMin || info->drawZMax) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count; Game_DrawCalls++;
 		} offset += count;
 
 		if (info->drawXMin || info->drawZMin) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count; Game_DrawCalls++;
 		} offset += count;
 
 		if (info->drawXMax || info->drawZMax) {
-			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
+			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count; Game_DrawCalls++;
 		}
 		Gfx_SetFaceCulling(false);
 	}
@@ -344,16 +361,11 @@ static void DeleteChunk(struct ChunkInfo* info) {
 	}
 }
 
-/* Builds the mesh (hence vertex buffer) for the given chunk, and updates internal state */
-static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+/* Updates internal state after the mesh of the given chunk has been built */
+static void AddChunkParts(struct ChunkInfo* info) {
 	struct ChunkPartInfo* ptr;
 	int i;
 
-	Game.ChunkUpdates++;
-	(*chunkUpdates)++;
-	info->pendingDelete = false;
-	Builder_MakeChunk(info);
-
 	if (!info->normalParts && !info->translucentParts) {
 		info->empty = true; return;
 	}
@@ -373,6 +385,42 @@ static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
 	}
 }
 
+/* Updates whether occlusion needs to be recalculated, after the given chunk has been rebuilt */
+static void CheckConnections(struct ChunkInfo* info, cc_uint16 oldConnections) {
+	if (info->connections == oldConnections) return;
+
+	/* Chunks previously occluded by this chunk might be visible now */
+	if (info->connections & ~oldConnections) {
+		occlusionDirty = true;
+	} else {
+		occlusionStale = true;
+	}
+}
+
+/* Builds the mesh (hence vertex buffer) for the given chunk, and updates internal state */
+static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+	cc_uint16 connections;
+	if (Builder_IsThreaded()) {
+		/* Keep drawing the old mesh until the new mesh has been built */
+		if (!Builder_QueueChunk(info)) return;
+		info->pendingDelete = false;
+		info->building      = true;
+		return;
+	}
+
+	DeleteChunk(info);
+	Game.ChunkUpdates++;
+	(*chunkUpdates)++;
+	info->pendingDelete = false;
+	connections = info->connections;
+
+	Profiler_Begin(PROFILE_CHUNK_BUILDS);
+	Builder_MakeChunk(info);
+	AddChunkParts(info);
+	Profiler_End(PROFILE_CHUNK_BUILDS);
+	CheckConnections(info, connections);
+}
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Chunks mangagement---------------------------------------------------*
@@ -388,11 +436,19 @@ static void FreeChunks(void) {
 	Mem_Free(sortedChunks);
 	Mem_Free(renderChunks);
 	Mem_Free(distances);
+	Mem_Free(sortedTemp);
+	Mem_Free(distancesTemp);
+	Mem_Free(visitFlags);
+	Mem_Free(visitQueue);
 
-	mapChunks    = NULL;
-	sortedChunks = NULL;
-	renderChunks = NULL;
-	distances    = NULL;
+	mapChunks     = NULL;
+	sortedChunks  = NULL;
+	renderChunks  = NULL;
+	distances     = NULL;
+	sortedTemp    = NULL;
+	distancesTemp = NULL;
+	visitFlags    = NULL;
+	visitQueue    = NULL;
 }
 
 static void AllocateParts(void) {
@@ -405,10 +461,14 @@ static void AllocateParts(void) {
 }
 
 static void AllocateChunks(void) {
-	mapChunks    = (struct ChunkInfo*) Mem_Alloc(chunksCount, sizeof(struct ChunkInfo),  "chunk info");
-	sortedChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "sorted chunk info");
-	renderChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "render chunk info");
-	distances    = (cc_uint32*)Mem_Alloc(chunksCount, 4, "chunk distances");
+	mapChunks     = (struct ChunkInfo*) Mem_Alloc(chunksCount, sizeof(struct ChunkInfo),  "chunk info");
+	sortedChunks  = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "sorted chunk info");
+	renderChunks  = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "render chunk info");
+	distances     = (cc_uint32*)Mem_Alloc(chunksCount, 4, "chunk distances");
+	sortedTemp    = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "sorted chunk temp");
+	distancesTemp = (cc_uint32*)Mem_Alloc(chunksCount, 4, "chunk distances temp");
+	visitFlags    = (cc_uint16*)Mem_Alloc(chunksCount, 2, "chunk visit flags");
+	visitQueue    = (int*)Mem_Alloc(chunksCount, 4, "chunk visit queue");
 }
 
 static void ResetPartFlags(void) {
@@ -460,8 +520,10 @@ static void DeleteChunks(void) {
 	int i;
 	if (!mapChunks) return;
 
+	Builder_CancelChunks();
 	for (i = 0; i < chunksCount; i++) {
 		DeleteChunk(&mapChunks[i]);
+		mapChunks[i].building = false;
 	}
 	ResetPartCounts();
 }
@@ -470,7 +532,7 @@ void MapRenderer_Refresh(void) {
 	int oldCount;
 	chunkPos = IVec3_MaxValue();
 
-	if (mapChunks && World.Blocks) {
+	if (mapChunks && World_HasBlocks()) {
 		DeleteChunks();
 		ResetChunks();
 
@@ -491,7 +553,7 @@ static void RefreshBorderChunks(int maxHeight) {
 	cc_bool onBorder;
 
 	chunkPos = IVec3_MaxValue();
-	if (!mapChunks || !World.Blocks) return;
+	if (!mapChunks || !World_HasBlocks()) return;
 
 	for (cz = 0; cz < World.ChunksZ; cz++) {
 		for (cy = 0; cy < World.ChunksY; cy++) {
@@ -507,10 +569,79 @@ static void RefreshBorderChunks(int maxHeight) {
 }
 
 
+/*########################################################################################################################*
+*--------------------------------------------------Chunk occlusion culling------------------------------------------------*
+*#########################################################################################################################*/
+#define VISIT_SEEN 0x8000
+#define VISIT_NO_ENTRY FACE_COUNT
+#define Visit_Entry(flags) (((flags) >> 8) & 0x07)
+static const cc_int8 faceOffsets[FACE_COUNT][3] = {
+	{ -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, -1, 0 }, { 0, 1, 0 }
+};
+
+static void MarkAllChunksVisible(void) {
+	int i;
+	for (i = 0; i < chunksCount; i++) { mapChunks[i].occluded = false; }
+}
+
+/* Flood fills outwards from the chunk the camera is in, only passing through */
+/*  chunks whose entry and exit faces can be seen through from one another */
+/* Chunks that are not reached this way are completely hidden behind other chunks */
+static void CalcOccludedChunks(void) {
+	struct ChunkInfo* info;
+	int i, head, tail, cur, next, face;
+	int flags, entry, x, y, z;
+	IVec3 pos;
+
+	occlusionDirty = false;
+	occlusionStale = false; occlusionStaleTime = 0.0f;
+	IVec3_Floor(&pos, &Camera.CurrentPos);
+	/* Chunks can be seen from the sides of the map when outside it */
+	if (!World_Contains(pos.x, pos.y, pos.z)) { MarkAllChunksVisible(); return; }
+
+	for (i = 0; i < chunksCount; i++) {
+		mapChunks[i].occluded = true;
+		visitFlags[i] = 0;
+	}
+
+	cur  = World_ChunkPack(pos.x >> CHUNK_SHIFT, pos.y >> CHUNK_SHIFT, pos.z >> CHUNK_SHIFT);
+	head = 0; tail = 0;
+	visitQueue[tail++] = cur;
+	visitFlags[cur]    = VISIT_SEEN | (VISIT_NO_ENTRY << 8);
+
+	while (head < tail) {
+		cur   = visitQueue[head++];
+		info  = &mapChunks[cur];
+		flags = visitFlags[cur];
+		entry = Visit_Entry(flags);
+		info->occluded = false;
+
+		x = info->centreX >> CHUNK_SHIFT; y = info->centreY >> CHUNK_SHIFT; z = info->centreZ >> CHUNK_SHIFT;
+		for (face = 0; face < FACE_COUNT; face++) {
+			/* Never travel back towards the camera */
+			if (flags & (1 << (face ^ 1))) continue;
+			if (entry != VISIT_NO_ENTRY && !(info->connections & CHUNK_CONNECTION(entry, face))) continue;
+
+			if (x + faceOffsets[face][0] < 0 || x + faceOffsets[face][0] >= World.ChunksX) continue;
+			if (y + faceOffsets[face][1] < 0 || y + faceOffsets[face][1] >= World.ChunksY) continue;
+			if (z + faceOffsets[face][2] < 0 || z + faceOffsets[face][2] >= World.ChunksZ) continue;
+
+			next = World_ChunkPack(x + faceOffsets[face][0], y + faceOffsets[face][1], z + faceOffsets[face][2]);
+			if (visitFlags[next] & VISIT_SEEN) continue;
+
+			visitFlags[next]   = VISIT_SEEN | ((face ^ 1) << 8) | (flags & 0x3F) | (1 << face);
+			visitQueue[tail++] = next;
+		}
+	}
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------Chunks updating/sorting------------------------------------------------*
 *#########################################################################################################################*/
 #define CHUNK_TARGET_TIME ((1.0f/30) + 0.01f)
+/* Maximum seconds that occlusion can be left stale for */
+#define OCCLUSION_STALE_DELAY 0.25f
 static int chunksTarget = 12;
 static Vec3 lastCamPos;
 static float lastYaw, lastPitch;
@@ -553,14 +684,13 @@ static int UpdateChunksAndVisibility(int* chunkUpdates) {
 		}
 		noData |= info->pendingDelete;
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			DeleteChunk(info);
+		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget && !info->building) {
 			BuildChunk(info, chunkUpdates);
 		}
 
 		info->visible = distSqr <= renderDistSqr &&
 			FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
-		if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
+		if (info->visible && !info->empty && !info->occluded) { renderChunks[j] = info; j++; }
 	}
 	return j;
 }
@@ -586,21 +716,49 @@ static int UpdateChunksStill(int* chunkUpdates) {
 		}
 		noData |= info->pendingDelete;
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			DeleteChunk(info);
+		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget && !info->building) {
 			BuildChunk(info, chunkUpdates);
 
 			/* only need to update the visibility of chunks in range. */
 			info->visible = distSqr <= renderDistSqr &&
 				FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
-			if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
-		} else if (info->visible) {
+			if (info->visible && !info->empty && !info->occluded) { renderChunks[j] = info; j++; }
+		} else if (info->visible && !info->occluded) {
 			renderChunks[j] = info; j++;
 		}
 	}
 	return j;
 }
 
+/* Replaces the meshes of chunks that have finished being built on worker threads */
+static void FinishChunks(int* chunkUpdates) {
+	struct ChunkInfo* info;
+	cc_uint16 connections;
+	cc_bool changed;
+
+	while (*chunkUpdates < chunksTarget && (info = Builder_NextFinishedChunk())) {
+		Game.ChunkUpdates++;
+		(*chunkUpdates)++;
+
+		/* Chunk might have been changed again while it was being built */
+		changed = info->pendingDelete;
+		info->building = false;
+		connections    = info->connections;
+		DeleteChunk(info);
+		Profiler_Begin(PROFILE_CHUNK_BUILDS);
+		Builder_OutputFinishedChunk();
+		AddChunkParts(info);
+		Profiler_End(PROFILE_CHUNK_BUILDS);
+		CheckConnections(info, connections);
+
+		if (changed || info->pendingDelete) {
+			info->empty  = false; info->allAir = false;
+			info->pendingDelete = true;
+		}
+	}
+}
+
+
 static void UpdateChunks(float delta) {
 	struct LocalPlayer* p;
 	cc_bool samePos;
@@ -610,6 +768,14 @@ static void UpdateChunks(float delta) {
 	chunksTarget += delta < CHUNK_TARGET_TIME ? 1 : -1; 
 	Math_Clamp(chunksTarget, 4, maxChunkUpdates);
 
+	FinishChunks(&chunkUpdates);
+	/* Recalculating is O(chunks), so avoid doing it every frame when many chunks are being built */
+	if (occlusionStale) occlusionStaleTime += delta;
+	if (occlusionDirty || occlusionStaleTime >= OCCLUSION_STALE_DELAY) {
+		CalcOccludedChunks();
+		ResetPartFlags();
+	}
+
 	p = Entities.CurPlayer;
 	samePos = Vec3_Equals(&Camera.CurrentPos, &lastCamPos)
 		&& p->Base.Pitch == lastPitch && p->Base.Yaw == lastYaw;
@@ -625,23 +791,15 @@ static void UpdateChunks(float delta) {
 	if (!samePos || chunkUpdates) ResetPartFlags();
 }
 
-static void SortMapChunks(int left, int right) {
-	struct ChunkInfo** values = sortedChunks; struct ChunkInfo* value;
-	cc_uint32* keys = distances; cc_uint32 key;
+/* Sorts chunks by distance using a radix sort, which takes linear time */
+/*  regardless of how far the camera moved (unlike quicksort when moving far) */
+static void SortMapChunks(void) {
+	struct ChunkInfo** tmpValues; cc_uint32* tmpKeys;
+	if (!Utils_RadixSortKV(distances, (void**)sortedChunks, distancesTemp, (void**)sortedTemp, chunksCount)) return;
 
-	while (left < right) {
-		int i = left, j = right;
-		cc_uint32 pivot = keys[(i + j) >> 1];
-
-		/* partition the list */
-		while (i <= j) {
-			while (pivot > keys[i]) i++;
-			while (pivot < keys[j]) j--;
-			QuickSort_Swap_KV_Maybe();
-		}
-		/* recurse into the smaller subset */
-		QuickSort_Recurse(SortMapChunks)
-	}
+	/* Sorted results ended up in the temp arrays */
+	tmpKeys   = distances;    distances    = distancesTemp; distancesTemp = tmpKeys;
+	tmpValues = sortedChunks; sortedChunks = sortedTemp;    sortedTemp    = tmpValues;
 }
 
 static void UpdateSortOrder(void) {
@@ -658,6 +816,7 @@ static void UpdateSortOrder(void) {
 	/* If in same chunk, don't need to recalculate sort order */
 	if (pos.x == chunkPos.x && pos.y == chunkPos.y && pos.z == chunkPos.z) return;
 	chunkPos = pos;
+	occlusionDirty = true;
 	if (!chunksCount) return;
 
 	for (i = 0; i < chunksCount; i++) {
@@ -679,9 +838,8 @@ static void UpdateSortOrder(void) {
 		info->drawYMin = dy >= 0; info->drawYMax = dy <= 0;
 	}
 
-	SortMapChunks(0, chunksCount - 1);
+	SortMapChunks();
 	ResetPartFlags();
-	/*SimpleOcclusionCulling();*/
 }
 
 void MapRenderer_Update(float delta) {
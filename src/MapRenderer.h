@@ -30,6 +30,11 @@ struct ChunkPartInfo {
 	cc_uint16 counts[FACE_COUNT]; /* Counts per face */
 };
 
+/* Bit flag for whether the given two faces of a chunk can be seen through from one another. */
+#define CHUNK_CONNECTION(a, b) (1 << ((a) < (b) ? (a) * (11 - (a)) / 2 + (b) - (a) - 1 : (b) * (11 - (b)) / 2 + (a) - (b) - 1))
+/* All 15 pairs of faces of a chunk can be seen through from one another. */
+#define CHUNK_CONNECTIONS_ALL 0x7FFF
+
 /* Describes data necessary for rendering a chunk. */
 struct ChunkInfo {	
 	cc_uint16 centreX, centreY, centreZ; /* Centre coordinates of the chunk */
@@ -38,6 +43,8 @@ struct ChunkInfo {
 	cc_uint8 empty : 1;         /* Whether the chunk is empty of data */
 	cc_uint8 pendingDelete : 1; /* Whether chunk is pending deletion */
 	cc_uint8 allAir : 1;        /* Whether chunk is completely air */
+	cc_uint8 building : 1;      /* Whether chunk's mesh is being built on a worker thread */
+	cc_uint8 occluded : 1;      /* Whether chunk is hidden from the camera behind other chunks */
 	cc_uint8 : 0;               /* pad to next byte*/
 
 	cc_uint8 drawXMin : 1;
@@ -47,6 +54,7 @@ struct ChunkInfo {
 	cc_uint8 drawYMin : 1;
 	cc_uint8 drawYMax : 1;
 	cc_uint8 : 0;          /* pad to next byte */
+	cc_uint16 connections; /* Which pairs of faces can be seen through from one another (see CHUNK_CONNECTION) */
 #ifdef OCCLUSION
 	public cc_bool Visited = false, Occluded = false;
 	public byte OcclusionFlags, OccludedFlags, DistanceFlags;
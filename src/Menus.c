@@ -1347,41 +1347,119 @@ static void SaveLevelScreen_RemoveOverwrites(struct SaveLevelScreen* s) {
 	}
 }
 
-static cc_result SaveLevelScreen_SaveMap(const cc_string* path) {
+/* Map is serialised into memory, which is then compressed and written to disc in the background, */
+/*  while the screen shows progress. The world can therefore keep changing while the map is saved */
+static struct Stream save_file, save_data, save_comp;
+static struct GZipParallelState save_state;
+static cc_string save_path; static char save_pathBuffer[FILENAME_SIZE];
+static volatile int save_percent;
+static int save_shownPercent;
+static cc_bool save_active;
+static void* save_thread;
+static volatile cc_bool save_written;
+static cc_result save_result;
+
+static void SaveLevelScreen_OnProgress(void* obj, cc_uint32 compressed, cc_uint32 total) {
+	save_percent = (int)((cc_uint64)compressed * 100 / max(total, 1));
+}
+
+/* Feeds the serialised map to the compressor, waiting whenever too many chunks are queued */
+/* NOTE: The compressor must always be closed, otherwise it never finishes */
+static void SaveLevelScreen_WriteData(void) {
+	save_result  = Stream_Write(&save_comp, save_data.meta.mem.base, save_data.meta.mem.length);
+	save_data.Close(&save_data);
+	save_comp.Close(&save_comp);
+	save_written = true;
+}
+
+static cc_result SaveLevelScreen_Encode(struct Stream* stream, const cc_string* path) {
 	static const cc_string schematic = String_FromConst(".schematic");
 	static const cc_string mine = String_FromConst(".mine");
-	struct Stream stream, compStream;
-	struct GZipState state;
+
+	if (String_CaselessEnds(path, &schematic)) {
+		return Schematic_Save(stream);
+	} else if (String_CaselessEnds(path, &mine)) {
+		return Dat_Save(stream);
+	} else {
+		return Cw_Save(stream);
+	}
+}
+
+static cc_result SaveLevelScreen_BeginSave(const cc_string* path) {
+	int level, workers;
 	cc_result res;
 
-	res = Stream_CreateFile(&stream, path);
+	level   = Options_GetEnum(OPT_MAP_COMPRESSION, DEFLATE_LEVEL_DEFAULT, Deflate_LevelNames, DEFLATE_LEVEL_COUNT);
+	workers = Options_GetInt(OPT_SAVE_THREADS, 0, GZIP_MAX_WORKERS,
+								max(1, min(Thread_ProcessorCount() - 1, GZIP_MAX_WORKERS)));
+
+	res = Stream_CreateFile(&save_file, path);
 	if (res) { Logger_SysWarn2(res, "creating", path); return res; }
-	GZip_MakeStream(&compStream, &state, &stream);
 
-	if (String_CaselessEnds(path, &schematic)) {
-		res = Schematic_Save(&compStream);
-	} else if (String_CaselessEnds(path, &mine)) {
-		res = Dat_Save(&compStream);
+	res = GZipParallel_MakeStream(&save_comp, &save_state, &save_file, level, workers, SaveLevelScreen_OnProgress, NULL);
+	if (res) {
+		save_file.Close(&save_file);
+		Logger_SysWarn2(res, "allocating compressor for", path); return res;
+	}
+	save_result  = 0;
+	save_written = false;
+	save_thread  = NULL;
+
+#ifndef CC_BUILD_COOPTHREADED
+	res = Stream_WriteonlyMemory(&save_data, World.Volume + 64 * 1024);
+#else
+	res = ERR_NOT_SUPPORTED;
+#endif
+
+	if (!res) {
+		/* Serialising the map is mostly just copying, so the game only pauses very briefly */
+		res = SaveLevelScreen_Encode(&save_data, path);
+		if (res) save_data.Close(&save_data);
+		else Thread_Run(&save_thread, SaveLevelScreen_WriteData, 64 * 1024, "Map saver");
 	} else {
-		res = Cw_Save(&compStream);
+		/* Not enough memory for a copy of the map, so compress the map directly instead */
+		/* NOTE: This blocks until all but the last few chunks of the map have been compressed */
+		res = SaveLevelScreen_Encode(&save_comp, path);
+		save_comp.Close(&save_comp);
+		save_written = true;
 	}
 
 	if (res) {
-		stream.Close(&stream);
+		GZipParallel_Finish(&save_state); save_file.Close(&save_file);
 		Logger_SysWarn2(res, "encoding", path); return res;
 	}
 
-	if ((res = compStream.Close(&compStream))) {
-		stream.Close(&stream);
-		Logger_SysWarn2(res, "closing", path); return res;
+	String_InitArray(save_path, save_pathBuffer);
+	String_Copy(&save_path, path);
+	save_percent      = 0;
+	save_shownPercent = -1;
+	save_active       = true;
+	return 0;
+}
+
+static cc_bool SaveLevelScreen_IsDone(void) {
+	return save_written && GZipParallel_IsDone(&save_state);
+}
+
+static void SaveLevelScreen_EndSave(void) {
+	cc_result res;
+	save_active = false;
+
+	if (save_thread) Thread_Join(save_thread);
+	save_thread = NULL;
+	res = GZipParallel_Finish(&save_state);
+	if (!res) res = save_result;
+
+	if (res) {
+		save_file.Close(&save_file);
+		Logger_SysWarn2(res, "compressing", &save_path); return;
 	}
 
-	res = stream.Close(&stream);
-	if (res) { Logger_SysWarn2(res, "closing", path); return res; }
+	res = save_file.Close(&save_file);
+	if (res) { Logger_SysWarn2(res, "closing", &save_path); return; }
 
 	World.LastSave = Game.Time;
-	Gui_ShowPauseMenu();
-	return 0;
+	Chat_Add1("&eSaved map to: %s", &save_path);
 }
 
 static void SaveLevelScreen_Save(void* screen, void* widget) { 
@@ -1389,8 +1467,8 @@ static void SaveLevelScreen_Save(void* screen, void* widget) {
 	struct ButtonWidget* btn  = (struct ButtonWidget*)widget;
 	cc_string path; char pathBuffer[FILENAME_SIZE];
 	cc_string file = s->input.base.text;
-	cc_result res;
 
+	if (save_active) return;
 	if (!file.length) {
 		TextWidget_SetConst(&s->desc, "&ePlease enter a filename", &s->textFont);
 		return;
@@ -1407,13 +1485,22 @@ static void SaveLevelScreen_Save(void* screen, void* widget) {
 	}
 		
 	SaveLevelScreen_RemoveOverwrites(s);
-	if ((res = SaveLevelScreen_SaveMap(&path))) return;
-	Chat_Add1("&eSaved map to: %s", &path);
+	if (SaveLevelScreen_BeginSave(&path)) return;
+
+	if (SaveLevelScreen_IsDone()) {
+		SaveLevelScreen_EndSave();
+		Gui_ShowPauseMenu();
+	} else {
+		/* Rest of saving is finished off in SaveLevelScreen_Render */
+		s->closable = false;
+	}
 }
 
+/* Save file dialog may expect the file to be completely written once the callback returns */
 static void SaveLevelScreen_UploadCallback(const cc_string* path) {
-	cc_result res = SaveLevelScreen_SaveMap(path);
-	if (!res) Chat_Add1("&eSaved map to: %s", path);
+	if (SaveLevelScreen_BeginSave(path)) return;
+	SaveLevelScreen_EndSave();
+	Gui_ShowPauseMenu();
 }
 
 static void SaveLevelScreen_File(void* screen, void* b) {
@@ -1426,6 +1513,7 @@ static void SaveLevelScreen_File(void* screen, void* b) {
 	struct SaveLevelScreen* s = (struct SaveLevelScreen*)screen;
 	struct SaveFileDialogArgs args;
 	cc_result res;
+	if (save_active) return;
 
 	args.filters     = filters;
 	args.titles      = titles;
@@ -1489,7 +1577,38 @@ static void SaveLevelScreen_ContextRecreated(void* screen) {
 
 static void SaveLevelScreen_Update(void* screen, float delta) {
 	struct SaveLevelScreen* s = (struct SaveLevelScreen*)screen;
+	cc_string desc; char descBuffer[STRING_SIZE];
+	int percent;
 	s->input.base.caretAccumulator += delta;
+	if (!save_active) return;
+
+	percent = save_percent;
+	if (percent == save_shownPercent) return;
+	save_shownPercent = percent;
+
+	String_InitArray(desc, descBuffer);
+	String_Format1(&desc, "&eSaving map.. %i%%", &percent);
+	TextWidget_Set(&s->desc, &desc, &s->textFont);
+}
+
+static void SaveLevelScreen_Render(void* screen, float delta) {
+	MenuScreen_Render2(screen, delta);
+	if (!save_active || !SaveLevelScreen_IsDone()) return;
+
+	SaveLevelScreen_EndSave();
+	Gui_ShowPauseMenu();
+}
+
+static void SaveLevelScreen_Cancel(void* screen, void* b) {
+	if (!save_active) Gui_ShowPauseMenu();
+}
+
+static void SaveLevelScreen_Free(void* screen) {
+	struct SaveLevelScreen* s = (struct SaveLevelScreen*)screen;
+	/* Make sure the map still gets completely written out */
+	if (save_active) SaveLevelScreen_EndSave();
+	s->closable = true;
+	OnscreenKeyboard_Close();
 }
 
 static void SaveLevelScreen_Layout(void* screen) {
@@ -1514,7 +1633,7 @@ static void SaveLevelScreen_Init(void* screen) {
 	ButtonWidget_Add(s, &s->save, 400, SaveLevelScreen_Save);
 	ButtonWidget_Add(s, &s->file, 400, SaveLevelScreen_File);
 
-	ButtonWidget_Add(s, &s->cancel, 400, Menu_SwitchPause);
+	ButtonWidget_Add(s, &s->cancel, 400, SaveLevelScreen_Cancel);
 	TextInputWidget_Add(s, &s->input, 400, &World.Name, &desc);
 	TextWidget_Add(s, &s->desc);
 	s->input.onscreenPlaceholder = "Map name";
@@ -1523,8 +1642,8 @@ static void SaveLevelScreen_Init(void* screen) {
 }
 
 static const struct ScreenVTABLE SaveLevelScreen_VTABLE = {
-	SaveLevelScreen_Init,    SaveLevelScreen_Update, Menu_CloseKeyboard,
-	MenuScreen_Render2,      Screen_BuildMesh,
+	SaveLevelScreen_Init,    SaveLevelScreen_Update, SaveLevelScreen_Free,
+	SaveLevelScreen_Render,  Screen_BuildMesh,
 	SaveLevelScreen_KeyDown, Screen_InputUp,   SaveLevelScreen_KeyPress, SaveLevelScreen_TextChanged,
 	Menu_PointerDown,        Screen_PointerUp, Menu_PointerMove,         Screen_TMouseScroll,
 	SaveLevelScreen_Layout,  SaveLevelScreen_ContextLost, SaveLevelScreen_ContextRecreated
@@ -69,6 +69,10 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_CLASSIC_CHAT "nostalgia-classicchat"
 #define OPT_CLASSIC_INVENTORY "nostalgia-classicinventory"
 #define OPT_MAX_CHUNK_UPDATES "gfx-maxchunkupdates"
+#define OPT_BUILDER_THREADS "gfx-builderthreads"
+#define OPT_SOFTGPU_THREADS "gfx-softgputhreads"
+#define OPT_GEN_THREADS "gen-threads"
+#define OPT_LIGHTING_THREADS "gfx-lightingthreads"
 #define OPT_CAMERA_MASS "cameramass"
 #define OPT_CAMERA_SMOOTH "camera-smooth"
 #define OPT_GRAB_CURSOR "win-grab-cursor"
@@ -78,6 +82,10 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_HTTP_ONLY "http-no-https"
 #define OPT_HTTPS_VERIFY "https-verify"
 #define OPT_SKIN_SERVER "http-skinserver"
+#define OPT_HTTP_WORKERS "http-workers"
+#define OPT_TEXTURECACHE_LIMIT "texturecache-limit"
+#define OPT_MAP_COMPRESSION "map-compression"
+#define OPT_SAVE_THREADS "save-threads"
 #define OPT_RAW_INPUT "win-raw-input"
 #define OPT_DPI_SCALING "win-dpi-scaling"
 #define OPT_GAME_VERSION "game-version"
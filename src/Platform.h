@@ -207,6 +207,13 @@ cc_result File_Seek(cc_file file, int offset, int seekType);
 cc_result File_Position(cc_file file, cc_uint32* pos);
 /* Attempts to retrieve the length of the given file. */
 cc_result File_Length(cc_file file, cc_uint32* len);
+#ifdef CC_BUILD_POSIX
+/* Attempts to map the first 'len' bytes of the given file into memory for reading. */
+/* NOTE: The file can be closed afterwards, the mapping remains valid until File_Unmap. */
+cc_result File_Map(cc_file file, cc_uint32 len, void** data);
+/* Unmaps memory previously mapped by File_Map. */
+void File_Unmap(void* data, cc_uint32 len);
+#endif
 
 typedef void (*Thread_StartFunc)(void);
 /* Blocks the current thread for the given number of milliseconds. */
@@ -220,6 +227,8 @@ CC_API void Thread_Detach(void* handle);
 /* Blocks the current thread, until the given thread has finished. */
 /* NOTE: This cannot be used on a thread that has been detached. */
 CC_API void Thread_Join(void* handle);
+/* Returns the number of logical processors that can run threads simultaneously. (1 if unknown) */
+int Thread_ProcessorCount(void);
 
 /* Allocates a new mutex. (used to synchronise access to a shared resource) */
 CC_API void* Mutex_Create(void);
@@ -24,6 +24,7 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <utime.h>
 #include <signal.h>
@@ -326,12 +327,34 @@ cc_result File_Length(cc_file file, cc_uint32* len) {
 	*len = st.st_size; return 0;
 }
 
+cc_result File_Map(cc_file file, cc_uint32 len, void** data) {
+	void* ptr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, file, 0);
+	if (ptr == MAP_FAILED) return errno;
+
+#ifdef MADV_SEQUENTIAL
+	/* Hint to read ahead more aggressively, since data is usually read from start to end */
+	madvise(ptr, len, MADV_SEQUENTIAL);
+#endif
+	*data = ptr; return 0;
+}
+
+void File_Unmap(void* data, cc_uint32 len) { munmap(data, len); }
+
 
 /*########################################################################################################################*
 *--------------------------------------------------------Threading--------------------------------------------------------*
 *#########################################################################################################################*/
 void Thread_Sleep(cc_uint32 milliseconds) { usleep(milliseconds * 1000); }
 
+int Thread_ProcessorCount(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+#else
+	return 1;
+#endif
+}
+
 #ifdef CC_BUILD_ANDROID
 /* All threads using JNI must detach BEFORE they exit */
 /* (see https://developer.android.com/training/articles/perf-jni#threads */
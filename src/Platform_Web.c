@@ -226,6 +226,7 @@ cc_result File_Length(cc_file file, cc_uint32* len) {
 *#########################################################################################################################*/
 /* No real threading support with emscripten backend */
 void  Thread_Sleep(cc_uint32 milliseconds) { }
+int   Thread_ProcessorCount(void) { return 1; }
 
 void* Mutex_Create(void) { return NULL; }
 void  Mutex_Free(void* handle) { }
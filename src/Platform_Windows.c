@@ -290,6 +290,13 @@ cc_result File_Length(cc_file file, cc_uint32* len) {
 *--------------------------------------------------------Threading--------------------------------------------------------*
 *#############################################################################################################p############*/
 void Thread_Sleep(cc_uint32 milliseconds) { Sleep(milliseconds); }
+
+int Thread_ProcessorCount(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors ? (int)info.dwNumberOfProcessors : 1;
+}
+
 static DWORD WINAPI ExecThread(void* param) {
 	Thread_StartFunc func = (Thread_StartFunc)param;
 	func();
@@ -0,0 +1,147 @@
+#include "Profiler.h"
+#include "String.h"
+#include "Stream.h"
+#include "Platform.h"
+#include "Funcs.h"
+#include "Game.h"
+
+cc_bool Profiler_Enabled;
+static const char* const sectionNames[PROFILE_COUNT] = {
+	"tasks", "net", "entities", "particles", "sky",
+	"mapupdate", "chunkbuilds", "normal", "translucent", "gui"
+};
+/* Shorter names so the overlay fits on one line */
+static const char* const shortNames[PROFILE_COUNT] = {
+	"task", "net", "ent", "ptcl", "sky", "map", "build", "norm", "tran", "gui"
+};
+
+static cc_uint64 sectionStarts[PROFILE_COUNT];
+/* Time (in milliseconds) spent in each section during the current frame */
+static float curTimes[PROFILE_COUNT];
+/* Time spent in each section since the last call to Profiler_Format */
+static float sumTimes[PROFILE_COUNT];
+static int sumFrames;
+
+#define PROFILER_HISTORY 1024
+struct ProfileFrame { float frameMS, times[PROFILE_COUNT]; };
+/* Ring buffer of the most recent frames */
+static struct ProfileFrame* history;
+static int historyHead, historyCount;
+
+static void ResetTimes(void) {
+	int i;
+	for (i = 0; i < PROFILE_COUNT; i++) { 
+		sectionStarts[i] = 0; curTimes[i] = 0; sumTimes[i] = 0; 
+	}
+	sumFrames = 0;
+}
+
+void Profiler_SetEnabled(cc_bool enabled) {
+	Profiler_Enabled = enabled;
+	ResetTimes();
+	historyHead = 0; historyCount = 0;
+
+	if (enabled && !history) {
+		/* Dumping is just unavailable if this fails */
+		history = (struct ProfileFrame*)Mem_TryAlloc(PROFILER_HISTORY, sizeof(struct ProfileFrame));
+	} else if (!enabled && history) {
+		Mem_Free(history);
+		history = NULL;
+	}
+}
+
+void Profiler_Begin(int section) {
+	if (!Profiler_Enabled) return;
+	sectionStarts[section] = Stopwatch_Measure();
+}
+
+void Profiler_End(int section) {
+	cc_uint64 end;
+	/* Section may have been started before the profiler was enabled */
+	if (!Profiler_Enabled || !sectionStarts[section]) return;
+
+	end = Stopwatch_Measure();
+	curTimes[section] += Stopwatch_ElapsedMicroseconds(sectionStarts[section], end) / 1000.0f;
+	sectionStarts[section] = 0;
+}
+
+void Profiler_EndFrame(double delta) {
+	struct ProfileFrame* frame = NULL;
+	int i;
+	if (!Profiler_Enabled) return;
+
+	if (history) {
+		frame = &history[historyHead];
+		frame->frameMS = (float)(delta * 1000.0);
+
+		historyHead  = (historyHead + 1) % PROFILER_HISTORY;
+		historyCount = min(historyCount + 1, PROFILER_HISTORY);
+	}
+
+	for (i = 0; i < PROFILE_COUNT; i++) {
+		if (frame) frame->times[i] = curTimes[i];
+		sumTimes[i] += curTimes[i];
+		curTimes[i]  = 0;
+	}
+	sumFrames++;
+}
+
+void Profiler_Format(cc_string* str) {
+	float avg;
+	int i;
+	if (!sumFrames) return;
+
+	for (i = 0; i < PROFILE_COUNT; i++) {
+		avg = sumTimes[i] / sumFrames;
+		sumTimes[i] = 0;
+
+		if (i) String_AppendConst(str, "  ");
+		String_Format2(str, "%c %f1", shortNames[i], &avg);
+	}
+	String_AppendConst(str, " ms");
+	sumFrames = 0;
+}
+
+cc_result Profiler_Dump(const cc_string* path) {
+	cc_string line; char lineBuffer[STRING_SIZE * 2];
+	struct ProfileFrame* frame;
+	struct Stream stream;
+	cc_result res, closeRes;
+	int i, j;
+
+	res = Stream_CreateFile(&stream, path);
+	if (res) return res;
+
+	String_InitArray(line, lineBuffer);
+	String_AppendConst(&line, "frame,frame_ms");
+	for (j = 0; j < PROFILE_COUNT; j++) {
+		String_Format1(&line, ",%c_ms", sectionNames[j]);
+	}
+	res = Stream_WriteLine(&stream, &line);
+
+	/* Oldest frame is just after the newest one in the ring buffer */
+	for (i = 0; !res && i < historyCount; i++) {
+		frame = &history[(historyHead - historyCount + i + PROFILER_HISTORY) % PROFILER_HISTORY];
+		line.length = 0;
+
+		String_Format2(&line, "%i,%f3", &i, &frame->frameMS);
+		for (j = 0; j < PROFILE_COUNT; j++) {
+			String_Format1(&line, ",%f3", &frame->times[j]);
+		}
+		res = Stream_WriteLine(&stream, &line);
+	}
+
+	closeRes = stream.Close(&stream);
+	return res ? res : closeRes;
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Profiler component----------------------------------------------------*
+*#########################################################################################################################*/
+static void OnFree(void) { Profiler_SetEnabled(false); }
+
+struct IGameComponent Profiler_Component = {
+	NULL,   /* Init */
+	OnFree  /* Free */
+};
@@ -0,0 +1,35 @@
+#ifndef CC_PROFILER_H
+#define CC_PROFILER_H
+#include "Core.h"
+/* Measures how long each stage of a frame takes, to help track down where lag spikes come from.
+   Copyright 2014-2023 ClassiCube | Licensed under BSD-3
+*/
+
+struct IGameComponent;
+extern struct IGameComponent Profiler_Component;
+
+enum ProfileSection {
+	PROFILE_TASKS, PROFILE_NETWORK, PROFILE_ENTITIES, PROFILE_PARTICLES, PROFILE_SKY,
+	PROFILE_MAP_UPDATE, PROFILE_CHUNK_BUILDS, PROFILE_MAP_NORMAL, PROFILE_MAP_TRANSLUCENT,
+	PROFILE_GUI, PROFILE_COUNT
+};
+
+/* Whether sections are currently being timed */
+extern cc_bool Profiler_Enabled;
+
+/* Starts or stops timing sections */
+/* NOTE: When enabled, the timings of the last 1024 frames are kept for Profiler_Dump */
+void Profiler_SetEnabled(cc_bool enabled);
+/* Starts timing the given section */
+void Profiler_Begin(int section);
+/* Stops timing the given section, adding the elapsed time to the current frame's total for that section */
+/* NOTE: A section may be timed multiple times in one frame (e.g. once per chunk built) */
+void Profiler_End(int section);
+/* Finishes the current frame, which took the given number of seconds in total */
+void Profiler_EndFrame(double delta);
+
+/* Appends the average time per frame of each section, since the last call to this method */
+void Profiler_Format(cc_string* str);
+/* Writes the per-frame section timings of the most recent frames to the given file as CSV */
+cc_result Profiler_Dump(const cc_string* path);
+#endif
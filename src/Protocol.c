@@ -344,6 +344,12 @@ struct MapState {
 	struct InflateState inflateState;
 	struct Stream stream;
 	BlockRaw* blocks;
+#ifdef CC_BUILD_CHUNKEDWORLD
+	/* Blocks are stored in pages instead of one map sized buffer, to reduce the peak memory used while joining */
+	/* NOTE: This does not make loading incremental - the map's dimensions are unknown until LevelFinalise, */
+	/*  so the pages are only converted into chunks (and so only rendered) once the whole map has been received */
+	BlockRaw** pages;
+#endif
 	struct GZipHeader gzHeader;
 	cc_uint8 size[MAP_SIZE_LEN];
 	int index, sizeIndex;
@@ -353,6 +359,16 @@ static struct MapState map1;
 #ifdef EXTENDED_BLOCKS
 static struct MapState map2;
 #endif
+#ifdef CC_BUILD_CHUNKEDWORLD
+#define MapState_HasBlocks(m) ((m)->pages  != NULL)
+#else
+#define MapState_HasBlocks(m) ((m)->blocks != NULL)
+#endif
+
+#ifdef CC_BUILD_CHUNKEDWORLD
+/* Pages where every block is the same are shared, so e.g. the air above the terrain uses almost no memory */
+static BlockRaw* map_uniformPages[256];
+#endif
 
 static void DisconnectInvalidMap(cc_result res) {
 	static const cc_string title  = String_FromConst("Disconnected");
@@ -369,6 +385,9 @@ static void MapState_Init(struct MapState* m) {
 
 	m->index       = 0;
 	m->blocks      = NULL;
+#ifdef CC_BUILD_CHUNKEDWORLD
+	m->pages       = NULL;
+#endif
 	m->sizeIndex   = 0;
 	m->allocFailed = false;
 }
@@ -378,6 +397,66 @@ static CC_INLINE void MapState_SkipHeader(struct MapState* m) {
 	m->sizeIndex     = MAP_SIZE_LEN;
 }
 
+#ifdef CC_BUILD_CHUNKEDWORLD
+#define MapState_PagesCount() ((map_volume + WORLD_PAGE_MASK) >> WORLD_PAGE_SHIFT)
+
+static void MapState_FreePages(struct MapState* m) {
+	BlockRaw* page;
+	int i;
+	if (!m->pages) return;
+
+	for (i = 0; i < MapState_PagesCount(); i++) {
+		page = m->pages[i];
+		if (page && page != map_uniformPages[page[0]]) Mem_Free(page);
+	}
+	Mem_Free(m->pages);
+	m->pages = NULL;
+}
+
+static void FreeMapStates(void) {
+	int i;
+	MapState_FreePages(&map1);
+#ifdef EXTENDED_BLOCKS
+	MapState_FreePages(&map2);
+#endif
+
+	for (i = 0; i < Array_Elems(map_uniformPages); i++) {
+		Mem_Free(map_uniformPages[i]);
+		map_uniformPages[i] = NULL;
+	}
+}
+
+/* Replaces the given page with the shared page for its block, if every block in it is the same */
+static void MapState_SharePage(struct MapState* m, int i) {
+	BlockRaw* page = m->pages[i];
+	int j;
+	for (j = 1; j < WORLD_PAGE_SIZE; j++) {
+		if (page[j] != page[0]) return;
+	}
+
+	if (!map_uniformPages[page[0]]) {
+		map_uniformPages[page[0]] = page;
+	} else {
+		m->pages[i] = map_uniformPages[page[0]];
+		Mem_Free(page);
+	}
+}
+
+/* Makes any pages that were never received (i.e. server sent too little map data) air */
+static cc_bool MapState_FillMissingPages(struct MapState* m) {
+	int i;
+	for (i = 0; i < MapState_PagesCount(); i++) {
+		if (m->pages[i]) continue;
+
+		if (!map_uniformPages[BLOCK_AIR]) {
+			map_uniformPages[BLOCK_AIR] = (BlockRaw*)Mem_TryAllocCleared(WORLD_PAGE_SIZE, 1);
+			if (!map_uniformPages[BLOCK_AIR]) return false;
+		}
+		m->pages[i] = map_uniformPages[BLOCK_AIR];
+	}
+	return true;
+}
+#else
 static void FreeMapStates(void) {
 	Mem_Free(map1.blocks);
 	map1.blocks = NULL;
@@ -386,10 +465,19 @@ static void FreeMapStates(void) {
 	map2.blocks = NULL;
 #endif
 }
+#endif
+
+static void MapState_OutOfMemory(struct MapState* m) {
+	Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
+	m->allocFailed = true;
+}
 
 static cc_result MapState_Read(struct MapState* m) {
 	cc_uint32 left, read;
 	cc_result res;
+#ifdef CC_BUILD_CHUNKEDWORLD
+	int i, offset;
+#endif
 	if (m->allocFailed) return 0;
 
 	if (m->sizeIndex < MAP_SIZE_LEN) {
@@ -405,14 +493,35 @@ static cc_result MapState_Read(struct MapState* m) {
 
 	if (!map_volume) map_volume = Stream_GetU32_BE(m->size);
 
+#ifdef CC_BUILD_CHUNKEDWORLD
+	if (!m->pages) {
+		m->pages = (BlockRaw**)Mem_TryAllocCleared(MapState_PagesCount(), sizeof(BlockRaw*));
+		if (!m->pages) { MapState_OutOfMemory(m); return 0; }
+	}
+
+	/* Fill up each page in turn, sharing each page once it is full to reduce memory usage */
+	while (m->index < map_volume) {
+		i      = m->index >> WORLD_PAGE_SHIFT;
+		offset = m->index &  WORLD_PAGE_MASK;
+
+		if (!m->pages[i]) {
+			m->pages[i] = (BlockRaw*)Mem_TryAlloc(WORLD_PAGE_SIZE, 1);
+			if (!m->pages[i]) { MapState_OutOfMemory(m); return 0; }
+		}
+
+		left = min(map_volume - m->index, WORLD_PAGE_SIZE - offset);
+		res  = m->stream.Read(&m->stream, &m->pages[i][offset], left, &read);
+
+		m->index += read;
+		if (offset + read == WORLD_PAGE_SIZE) MapState_SharePage(m, i);
+		if (res || !read) return res;
+	}
+	return 0;
+#else
 	if (!m->blocks) {
 		m->blocks = (BlockRaw*)Mem_TryAlloc(map_volume, 1);
 		/* unlikely but possible */
-		if (!m->blocks) {
-			Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
-			m->allocFailed = true;
-			return 0;
-		}
+		if (!m->blocks) { MapState_OutOfMemory(m); return 0; }
 	}
 
 	left = map_volume - m->index;
@@ -420,6 +529,7 @@ static cc_result MapState_Read(struct MapState* m) {
 
 	m->index += read;
 	return res;
+#endif
 }
 
 
@@ -616,15 +726,30 @@ static void Classic_LevelFinalise(cc_uint8* data) {
 	if (map1.allocFailed) {
 		Chat_AddRaw("&cFailed to load map, try joining a different map");
 		Chat_AddRaw("   &cNot enough free memory to load the map");
-	} else if (!map1.blocks) {
+		/* Some pages may have been received before running out of memory */
+		FreeMapStates();
+	} else if (!MapState_HasBlocks(&map1)) {
 		Chat_AddRaw("&cFailed to load map, try joining a different map");
 		Chat_AddRaw("   &cAttempted to load map without a Blocks array");
+		FreeMapStates();
 	} else if (map_volume != volume) {
 		Chat_AddRaw("&cFailed to load map, try joining a different map");
 		Chat_Add2(  "   &cBlocks array size (%i) does not match volume of map (%i)", &map_volume, &volume);
 		FreeMapStates();
 	}
 	
+#if defined CC_BUILD_CHUNKEDWORLD
+	if (map1.pages && !MapState_FillMissingPages(&map1)) FreeMapStates();
+#ifdef EXTENDED_BLOCKS
+	if (!IsSupported(extBlocks_Ext) || (map2.pages && !MapState_FillMissingPages(&map2))) {
+		MapState_FreePages(&map2);
+	}
+	World_SetNewMapPages(map1.pages, map2.pages, width, height, length);
+#else
+	World_SetNewMapPages(map1.pages, NULL,       width, height, length);
+#endif
+	FreeMapStates();
+#else
 #ifdef EXTENDED_BLOCKS
 	/* defer allocation of second map array if possible */
 	if (IsSupported(extBlocks_Ext) && map2.blocks) {
@@ -634,6 +759,7 @@ static void Classic_LevelFinalise(cc_uint8* data) {
 #endif
 	World_SetNewMap(map1.blocks, width, height, length);
 	map1.blocks  = NULL;
+#endif
 }
 
 static void Classic_SetBlock(cc_uint8* data) {
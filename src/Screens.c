@@ -22,6 +22,7 @@
 #include "Input.h"
 #include "Utils.h"
 #include "Options.h"
+#include "Profiler.h"
 
 #define CHAT_MAX_STATUS Array_Elems(Chat_Status)
 #define CHAT_MAX_BOTTOMRIGHT Array_Elems(Chat_BottomRight)
@@ -68,7 +69,7 @@ CC_NOINLINE static cc_bool IsOnlyChatActive(void) {
 static struct HUDScreen {
 	Screen_Body
 	struct FontDesc font;
-	struct TextWidget line1, line2;
+	struct TextWidget line1, line2, line3;
 	struct TextAtlas posAtlas;
 	float accumulator;
 	int frames, posCount;
@@ -83,7 +84,9 @@ static struct HUDScreen {
 #define POSITION_VAL_CHARS 11
 /* [PREFIX] [(] [X] [,] [Y] [,] [Z] [)] */
 #define POSITION_HUD_CHARS (1 + 1 + POSITION_VAL_CHARS + 1 + POSITION_VAL_CHARS + 1 + POSITION_VAL_CHARS + 1)
-#define HUD_MAX_VERTICES (4 + TEXTWIDGET_MAX * 2 + HOTBAR_MAX_VERTICES + POSITION_HUD_CHARS * 4)
+#define HUD_MAX_VERTICES (4 + TEXTWIDGET_MAX * 3 + HOTBAR_MAX_VERTICES + POSITION_HUD_CHARS * 4)
+/* Profiler line is placed after the position text in the vertex buffer */
+#define HUD_PROFILER_OFFSET (12 + HOTBAR_MAX_VERTICES + POSITION_HUD_CHARS * 4)
 
 static void HUDScreen_RemakeLine1(struct HUDScreen* s) {
 	cc_string status; char statusBuffer[STRING_SIZE * 2];
@@ -184,6 +187,17 @@ static void HUDScreen_RemakeLine2(struct HUDScreen* s) {
 }
 
 
+static void HUDScreen_RemakeLine3(struct HUDScreen* s) {
+	cc_string status; char statusBuffer[STRING_SIZE * 2];
+	if (!Profiler_Enabled && !s->line3.tex.ID) return;
+
+	String_InitArray(status, statusBuffer);
+	if (Profiler_Enabled) Profiler_Format(&status);
+	TextWidget_Set(&s->line3, &status, &s->font);
+	s->dirty = true;
+}
+
+
 static void HUDScreen_ContextLost(void* screen) {
 	struct HUDScreen* s = (struct HUDScreen*)screen;
 	Font_Free(&s->font);
@@ -193,6 +207,7 @@ static void HUDScreen_ContextLost(void* screen) {
 	Elem_Free(&s->hotbar);
 	Elem_Free(&s->line1);
 	Elem_Free(&s->line2);
+	Elem_Free(&s->line3);
 }
 
 static void HUDScreen_ContextRecreated(void* screen) {	
@@ -209,6 +224,7 @@ static void HUDScreen_ContextRecreated(void* screen) {
 	HUDScreen_RemakeLine1(s);
 	TextAtlas_Make(&s->posAtlas, &chars, &s->font, &prefix);
 	HUDScreen_RemakeLine2(s);
+	HUDScreen_RemakeLine3(s);
 }
 
 int HUDScreen_LayoutHotbar(void) {
@@ -222,6 +238,7 @@ static void HUDScreen_Layout(void* screen) {
 	struct HUDScreen* s = (struct HUDScreen*)screen;
 	struct TextWidget* line1 = &s->line1;
 	struct TextWidget* line2 = &s->line2;
+	struct TextWidget* line3 = &s->line3;
 	int posY;
 
 	Widget_SetLocation(line1, ANCHOR_MIN, ANCHOR_MIN, 
@@ -243,6 +260,11 @@ static void HUDScreen_Layout(void* screen) {
 
 	HUDScreen_LayoutHotbar();
 	Widget_Layout(line2);
+
+	Widget_SetLocation(line3, ANCHOR_MIN, ANCHOR_MIN, 
+						2 + DisplayInfo.ContentOffsetX, 0);
+	line3->yOffset = max(line1->yOffset, line2->yOffset) + s->posAtlas.tex.height;
+	Widget_Layout(line3);
 }
 
 static int HUDScreen_KeyDown(void* screen, int key) {
@@ -302,9 +324,11 @@ static void HUDScreen_Init(void* screen) {
 	HotbarWidget_Create(&s->hotbar);
 	TextWidget_Init(&s->line1);
 	TextWidget_Init(&s->line2);
+	TextWidget_Init(&s->line3);
 	
 	s->line1.flags  |= WIDGET_FLAG_MAINSCREEN;
 	s->line2.flags  |= WIDGET_FLAG_MAINSCREEN;
+	s->line3.flags  |= WIDGET_FLAG_MAINSCREEN;
 
 	Event_Register_(&UserEvents.HacksStateChanged, s, HUDScreen_HacksChanged);
 	Event_Register_(&TextureEvents.AtlasChanged,   s, HUDScreen_NeedRedrawing);
@@ -323,6 +347,7 @@ static void HUDScreen_UpdateFPS(struct HUDScreen* s, float delta) {
 	if (s->accumulator < 1.0f) return;
 
 	HUDScreen_RemakeLine1(s);
+	HUDScreen_RemakeLine3(s);
 	s->accumulator    = 0.0f;
 	s->frames         = 0;
 	Game.ChunkUpdates = 0;
@@ -375,6 +400,9 @@ static void HUDScreen_BuildMesh(void* screen) {
 
 	if (!Game_ClassicMode) 
 		HUDScreen_BuildPosition(s, data);
+
+	data += POSITION_HUD_CHARS * 4;
+	Widget_BuildMesh(&s->line3,  ptr);
 	Gfx_UnlockDynamicVb(s->vb);
 }
 
@@ -396,6 +424,7 @@ static void HUDScreen_Render(void* screen, float delta) {
 		Gfx_DrawVb_IndexedTris_Range(s->posCount, 12 + HOTBAR_MAX_VERTICES);
 		/* TODO swap these two lines back */
 	}
+	if (Profiler_Enabled && Gui.ShowFPS) Widget_Render2(&s->line3, HUD_PROFILER_OFFSET);
 
 	if (!Gui_GetBlocksWorld()) {
 		Gfx_BindDynamicVb(s->vb);
@@ -25,6 +25,8 @@
 #include "Input.h"
 #include "Errors.h"
 #include "Options.h"
+#include "Benchmark.h"
+#include "Profiler.h"
 
 static char nameBuffer[STRING_SIZE];
 static char motdBuffer[STRING_SIZE];
@@ -150,6 +152,8 @@ static void SPConnection_BeginConnect(void) {
 #endif
 
 	Gen_Seed   = Random_Next(&rnd, Int32_MaxValue);
+	/* Benchmark runs must always generate the same map */
+	if (Benchmark_Enabled) Gen_Seed = Benchmark_Seed;
 	Gen_Start();
 
 	GeneratingScreen_Show();
@@ -243,6 +247,22 @@ static cc_bool net_connecting;
 static double net_connectTimeout;
 #define NET_TIMEOUT_SECS 15
 
+/* Outgoing data is queued up, then sent in one go when the connection is next ticked */
+/* This coalesces many small packets into fewer socket writes, and avoids blocking */
+/*  the game when the socket's send buffer is full (e.g. on a slow or lossy connection) */
+static cc_uint8  net_sendDefault[4096];
+static cc_uint8* net_sendBuffer   = net_sendDefault;
+static cc_uint32 net_sendCapacity = sizeof(net_sendDefault);
+/* Unsent data lies between net_sendHead and net_sendTail */
+static cc_uint32 net_sendHead, net_sendTail;
+/* Time oldest unsent data was queued at, and time data was last successfully sent */
+static cc_uint64 net_sendBegin, net_sendProgress;
+static struct NetSendStats net_sendStats;
+/* Sends immediately instead of waiting for next tick once this much data is queued */
+#define NET_SEND_EAGER_SIZE 4096
+/* Disconnects if the server hasn't accepted any queued data after this long */
+#define NET_SEND_TIMEOUT_SECS 10
+
 static void MPConnection_FinishConnect(void) {
 	net_connecting = false;
 	Event_RaiseVoid(&NetEvents.Connected);
@@ -299,6 +319,8 @@ static void MPConnection_BeginConnect(void) {
 	int numValidAddrs;
 	cc_result res;
 	String_InitArray(title, titleBuffer);
+	net_sendHead = 0;
+	net_sendTail = 0;
 
 	/* Default block permissions (in case server supports SetBlockPermissions but doesn't send) */
 	Blocks.CanPlace[BLOCK_AIR] = false;
@@ -375,6 +397,67 @@ static void DisconnectInvalidOpcode(cc_uint8 opcode) {
 	Game_Disconnect(&title, &tmp); return;
 }
 
+static void MPConnection_ReserveSend(cc_uint32 len) {
+	cc_uint32 pending = net_sendTail - net_sendHead;
+	cc_uint32 i, capacity;
+	cc_uint8* buffer;
+
+	/* Try to make space by moving unsent data back to start of buffer */
+	if (pending + len <= net_sendCapacity) {
+		for (i = 0; i < pending; i++)
+		{
+			net_sendBuffer[i] = net_sendBuffer[net_sendHead + i];
+		}
+	} else {
+		capacity = max(net_sendCapacity * 2, pending + len);
+		buffer   = (cc_uint8*)Mem_Alloc(capacity, 1, "net send queue");
+		Mem_Copy(buffer, net_sendBuffer + net_sendHead, pending);
+
+		if (net_sendBuffer != net_sendDefault) Mem_Free(net_sendBuffer);
+		net_sendBuffer   = buffer;
+		net_sendCapacity = capacity;
+	}
+	net_sendHead = 0;
+	net_sendTail = pending;
+}
+
+static void MPConnection_FlushSend(void) {
+	cc_uint32 wrote;
+	cc_uint64 now;
+	cc_result res;
+	int elapsed;
+	if (net_sendHead == net_sendTail || Server.Disconnected || net_writeFailure) return;
+
+	while (net_sendHead < net_sendTail) {
+		res = Socket_Write(net_socket, net_sendBuffer + net_sendHead, net_sendTail - net_sendHead, &wrote);
+		/* Socket's send buffer is full, so try again on next tick */
+		if (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock) break;
+
+		/* NOTE: Not immediately disconnecting here, as otherwise we sometimes miss out on kick messages */
+		if (res)    { net_writeFailure = res;                  return; }
+		if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; return; }
+
+		net_sendHead    += wrote;
+		net_sendProgress = Stopwatch_Measure();
+	}
+	now = Stopwatch_Measure();
+
+	if (net_sendHead == net_sendTail) {
+		elapsed = Stopwatch_ElapsedMS(net_sendBegin, now);
+		net_sendStats.Flushes++;
+		net_sendStats.LastFlushMS = elapsed;
+		if (elapsed > net_sendStats.MaxFlushMS) net_sendStats.MaxFlushMS = elapsed;
+	} else if (Stopwatch_ElapsedMS(net_sendProgress, now) > NET_SEND_TIMEOUT_SECS * 1000) {
+		/* Server hasn't accepted any data for a long time, so connection has probably dropped */
+		net_writeFailure = ReturnCode_SocketWouldBlock;
+	}
+}
+
+void Server_GetSendStats(struct NetSendStats* stats) {
+	*stats = net_sendStats;
+	stats->BytesPending = net_sendTail - net_sendHead;
+}
+
 static void MPConnection_Tick(struct ScheduledTask* task) {
 	Net_Handler handler;
 	cc_uint8* readEnd;
@@ -442,34 +525,32 @@ static void MPConnection_Tick(struct ScheduledTask* task) {
 	}
 
 	/* Network is ticked 60 times a second. We only send position updates 20 times a second */
-	if ((ticks++ % 3) != 0) return;
-
-	TexturePack_CheckPending();
-	Protocol_Tick();
+	if ((ticks++ % 3) == 0) {
+		TexturePack_CheckPending();
+		Protocol_Tick();
+	}
+	MPConnection_FlushSend();
 }
 
 static void MPConnection_SendData(const cc_uint8* data, cc_uint32 len) {
-	cc_uint32 wrote;
-	cc_result res;
-	int tries = 0;
+	cc_uint32 pending;
 	if (Server.Disconnected) return;
 
-	while (len) {
-		res = Socket_Write(net_socket, data, len, &wrote);
-		/* If sending would block (send buffer full), retry for a bit up to 10 seconds */
-		/* TODO: Avoid doing this and manually buffer data when this happens */
-		if (res && tries < 1000 && (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock)) {
-			Thread_Sleep(10);
-			tries++;
-			continue;
-		}
+	if (net_sendHead == net_sendTail) {
+		net_sendHead  = 0;
+		net_sendTail  = 0;
+		net_sendBegin = Stopwatch_Measure();
+		net_sendProgress = net_sendBegin;
+	}
+	if (net_sendTail + len > net_sendCapacity) MPConnection_ReserveSend(len);
 
-		/* NOTE: Not immediately disconnecting here, as otherwise we sometimes miss out on kick messages */
-		if (res)    { net_writeFailure = res;                  return; }
-		if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; return; }
+	Mem_Copy(net_sendBuffer + net_sendTail, data, len);
+	net_sendTail += len;
+	net_sendStats.BytesQueued += len;
 
-		data += wrote; len -= wrote;
-	}
+	pending = net_sendTail - net_sendHead;
+	if (pending > net_sendStats.MaxPending) net_sendStats.MaxPending = pending;
+	if (pending >= NET_SEND_EAGER_SIZE) MPConnection_FlushSend();
 }
 
 static void MPConnection_Init(void) {
@@ -485,6 +566,8 @@ static void MPConnection_Init(void) {
 }
 #else
 static void MPConnection_Init(void) { SPConnection_Init(); }
+
+void Server_GetSendStats(struct NetSendStats* stats) { Mem_Set(stats, 0, sizeof(*stats)); }
 #endif
 
 
@@ -502,6 +585,12 @@ static void OnNewMap(void) {
 	}
 }
 
+static void Server_Tick(struct ScheduledTask* task) {
+	Profiler_Begin(PROFILE_NETWORK);
+	Server.Tick(task);
+	Profiler_End(PROFILE_NETWORK);
+}
+
 static void OnInit(void) {
 	String_InitArray(Server.Name,    nameBuffer);
 	String_InitArray(Server.MOTD,    motdBuffer);
@@ -513,7 +602,7 @@ static void OnInit(void) {
 		MPConnection_Init();
 	}
 
-	ScheduledTask_Add(GAME_NET_TICKS, Server.Tick);
+	ScheduledTask_Add(GAME_NET_TICKS, Server_Tick);
 	String_AppendConst(&Server.AppName, GAME_APP_NAME);
 	String_AppendConst(&Server.AppName, Platform_AppNameSuffix);
 
@@ -533,6 +622,12 @@ static void OnReset(void) {
 static void OnFree(void) {
 	Server.Address.length = 0;
 	OnClose();
+
+#ifdef CC_BUILD_NETWORKING
+	if (net_sendBuffer != net_sendDefault) Mem_Free(net_sendBuffer);
+	net_sendBuffer   = net_sendDefault;
+	net_sendCapacity = sizeof(net_sendDefault);
+#endif
 }
 
 static void OnClose(void) {
@@ -17,6 +17,18 @@ void Ping_Update(int id);
 /* Calculates average ping time based on most recent ping entries */
 int Ping_AveragePingMS(void);
 
+/* Statistics about data sent to a multiplayer server */
+struct NetSendStats {
+	cc_uint32 BytesQueued;  /* Total number of bytes queued for sending */
+	cc_uint32 BytesPending; /* Number of queued bytes not yet sent */
+	cc_uint32 MaxPending;   /* Largest number of queued bytes waiting to be sent at once */
+	cc_uint32 Flushes;      /* Number of times all queued data was completely sent */
+	int LastFlushMS;        /* Milliseconds between data being queued and all of it being sent */
+	int MaxFlushMS;         /* Largest value that LastFlushMS has been */
+};
+/* Retrieves statistics about data sent to the current multiplayer server */
+void Server_GetSendStats(struct NetSendStats* stats);
+
 /* Data for currently active connection to a server */
 CC_VAR extern struct _ServerConnectionData {
 	/* Begins connecting to the server */
@@ -161,6 +161,44 @@ void Stream_FromFile(struct Stream* s, cc_file file) {
 	s->Length   = Stream_FileLength;
 }
 
+#ifdef CC_BUILD_POSIX
+static cc_result Stream_MappedClose(struct Stream* s) {
+	File_Unmap(s->meta.mem.base, s->meta.mem.length);
+	s->meta.mem.base = NULL;
+	return 0;
+}
+
+cc_result Stream_OpenMapped(struct Stream* s, const cc_string* path) {
+	cc_file file;
+	cc_uint32 len;
+	void* data;
+	cc_result res;
+
+	res = File_Open(&file, path);
+	if (res) { Stream_FromFile(s, file); return res; }
+
+	/* Empty files can't be mapped, so just read those like normal */
+	res = File_Length(file, &len);
+	if (res || !len || File_Map(file, len, &data)) {
+		Stream_FromFile(s, file); return 0;
+	}
+
+	/* Mapping stays valid after the file is closed */
+	(void)File_Close(file);
+	Stream_ReadonlyMemory(s, data, len);
+	s->Close = Stream_MappedClose;
+	return 0;
+}
+
+cc_bool Stream_IsMapped(struct Stream* s) { return s->Close == Stream_MappedClose; }
+#else
+cc_result Stream_OpenMapped(struct Stream* s, const cc_string* path) {
+	return Stream_OpenFile(s, path);
+}
+
+cc_bool Stream_IsMapped(struct Stream* s) { return false; }
+#endif
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------PortionStream-------------------------------------------------------*
@@ -279,6 +317,68 @@ void Stream_ReadonlyMemory(struct Stream* s, void* data, cc_uint32 len) {
 	s->meta.mem.base   = (cc_uint8*)data;
 }
 
+/* For writable memory streams, cur and left are the position and space left in the block, */
+/*  while length is how many bytes have been written to it */
+static cc_result Stream_GrowableWrite(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	cc_uint32 pos = (cc_uint32)(s->meta.mem.cur - s->meta.mem.base);
+	cc_uint32 capacity;
+	cc_uint8* grown;
+
+	if (count > s->meta.mem.left) {
+		capacity = max((pos + s->meta.mem.left) * 2, pos + count);
+		grown    = (cc_uint8*)Mem_TryRealloc(s->meta.mem.base, capacity, 1);
+		if (!grown) return ERR_OUT_OF_MEMORY;
+
+		s->meta.mem.base = grown;
+		s->meta.mem.cur  = grown + pos;
+		s->meta.mem.left = capacity - pos;
+	}
+	Mem_Copy(s->meta.mem.cur, data, count);
+
+	s->meta.mem.cur    += count;
+	s->meta.mem.left   -= count;
+	s->meta.mem.length  = max(s->meta.mem.length, pos + count);
+	*modified = count;
+	return 0;
+}
+
+static cc_result Stream_GrowableSeek(struct Stream* s, cc_uint32 position) {
+	cc_uint32 capacity = (cc_uint32)(s->meta.mem.cur - s->meta.mem.base) + s->meta.mem.left;
+	if (position > s->meta.mem.length) return ERR_INVALID_ARGUMENT;
+
+	s->meta.mem.cur  = s->meta.mem.base + position;
+	s->meta.mem.left = capacity - position;
+	return 0;
+}
+
+static cc_result Stream_GrowablePosition(struct Stream* s, cc_uint32* position) {
+	*position = (cc_uint32)(s->meta.mem.cur - s->meta.mem.base); return 0;
+}
+
+static cc_result Stream_GrowableClose(struct Stream* s) {
+	Mem_Free(s->meta.mem.base);
+	s->meta.mem.base = NULL;
+	return 0;
+}
+
+cc_result Stream_WriteonlyMemory(struct Stream* s, cc_uint32 capacity) {
+	cc_uint8* data = (cc_uint8*)Mem_TryAlloc(max(capacity, 1), 1);
+	if (!data) return ERR_OUT_OF_MEMORY;
+
+	Stream_Init(s);
+	s->Write    = Stream_GrowableWrite;
+	s->Seek     = Stream_GrowableSeek;
+	s->Position = Stream_GrowablePosition;
+	s->Length   = Stream_MemoryLength;
+	s->Close    = Stream_GrowableClose;
+
+	s->meta.mem.cur    = data;
+	s->meta.mem.left   = max(capacity, 1);
+	s->meta.mem.length = 0;
+	s->meta.mem.base   = data;
+	return 0;
+}
+
 
 /*########################################################################################################################*
 *----------------------------------------------------BufferedStream-------------------------------------------------------*
@@ -363,13 +463,7 @@ void Stream_ReadonlyBuffered(struct Stream* s, struct Stream* source, void* data
 *#########################################################################################################################*/
 static cc_result Stream_Crc32Write(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
 	struct Stream* source;
-	cc_uint32 i, crc32 = stream->meta.crc32.crc32;
-
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
-	}
-	stream->meta.crc32.crc32 = crc32;
+	stream->meta.crc32.crc32 = Utils_Crc32Update(stream->meta.crc32.crc32, data, count);
 
 	source = stream->meta.crc32.source;
 	return source->Write(source, data, count, modified);
@@ -59,11 +59,24 @@ cc_result Stream_AppendFile(struct Stream* s, const cc_string* path);
 cc_result Stream_WriteAllTo(const cc_string* path, const cc_uint8* data, cc_uint32 length);
 /* Wraps a file, allowing reading from/writing to/seeking in the file. */
 CC_API void Stream_FromFile(struct Stream* s, cc_file file);
+/* Opens an existing file for reading only. Where supported, the file's contents are mapped into memory, */
+/*  and the stream is then a memory stream (see Stream_ReadonlyMemory) that reads directly from the mapping. */
+/* Otherwise, this behaves the same as Stream_OpenFile. */
+/* NOTE: The file must not be truncated by anything else while the stream is still open. */
+cc_result Stream_OpenMapped(struct Stream* s, const cc_string* path);
+/* Whether the given stream was opened by Stream_OpenMapped and reads directly from a file mapping */
+/* If so, the remaining data stays valid until the stream is closed, and can be accessed without */
+/*  copying through s->meta.mem.cur and s->meta.mem.left */
+cc_bool Stream_IsMapped(struct Stream* s);
 
 /* Wraps another Stream, only allows reading up to 'len' bytes from the wrapped stream. */
 CC_API void Stream_ReadonlyPortion(struct Stream* s, struct Stream* source, cc_uint32 len);
 /* Wraps a block of memory, allowing reading from and seeking in the block. */
 CC_API void Stream_ReadonlyMemory(struct Stream* s, void* data, cc_uint32 len);
+/* Allocates a block of memory that grows as needed, allowing writing to and seeking in the block. */
+/* The data written so far is s->meta.mem.base, and is s->meta.mem.length bytes long. */
+/* NOTE: Closing the stream frees the block of memory */
+cc_result Stream_WriteonlyMemory(struct Stream* s, cc_uint32 capacity);
 /* Wraps another Stream, reading through an intermediary buffer. (Useful for files, since each read call is expensive) */
 CC_API void Stream_ReadonlyBuffered(struct Stream* s, struct Stream* source, void* data, cc_uint32 size);
 
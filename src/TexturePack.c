@@ -215,18 +215,52 @@ cc_bool Atlas_TryChange(struct Bitmap* atlas) {
 /*########################################################################################################################*
 *------------------------------------------------------TextureCache-------------------------------------------------------*
 *#########################################################################################################################*/
-static struct StringsBuffer acceptedList, deniedList, etagCache, lastModCache;
+static struct StringsBuffer acceptedList, deniedList, etagCache, lastModCache, accessCache;
 #define ACCEPTED_TXT "texturecache/acceptedurls.txt"
 #define DENIED_TXT   "texturecache/deniedurls.txt"
 #define ETAGS_TXT    "texturecache/etags.txt"
 #define LASTMOD_TXT  "texturecache/lastmodified.txt"
+#define ACCESS_TXT   "texturecache/lastaccessed.txt"
+
+/* Each entry in accessCache is of the form "[key] [access counter] [size]" */
+/* The entry with the lowest access counter is the least recently used one */
+static cc_uint32 accessCounter, cacheSize, cacheLimit;
+static cc_bool accessChanged;
+
+static void ParseAccessEntry(const cc_string* value, int* counter, int* size) {
+	cc_string counterStr, sizeStr;
+	String_UNSAFE_Separate(value, ' ', &counterStr, &sizeStr);
+	
+	if (!Convert_ParseInt(&counterStr, counter)) *counter = 0;
+	if (!Convert_ParseInt(&sizeStr,    size))    *size    = 0;
+}
 
 /* Initialises cache state (loading various lists) */
 static void TextureCache_Init(void) {
+	cc_string entry, key, value;
+	int i, counter, size;
+
 	EntryList_UNSAFE_Load(&acceptedList, ACCEPTED_TXT);
 	EntryList_UNSAFE_Load(&deniedList,   DENIED_TXT);
 	EntryList_UNSAFE_Load(&etagCache,    ETAGS_TXT);
 	EntryList_UNSAFE_Load(&lastModCache, LASTMOD_TXT);
+	EntryList_UNSAFE_Load(&accessCache,  ACCESS_TXT);
+
+	cacheLimit = Options_GetInt(OPT_TEXTURECACHE_LIMIT, 1, 1024, 64) * 1024 * 1024;
+	for (i = 0; i < accessCache.count; i++) 
+	{
+		entry = StringsBuffer_UNSAFE_Get(&accessCache, i);
+		String_UNSAFE_Separate(&entry, ' ', &key, &value);
+		ParseAccessEntry(&value, &counter, &size);
+
+		accessCounter = max(accessCounter, (cc_uint32)counter);
+		cacheSize    += size;
+	}
+}
+
+static void SaveAccessList(void) {
+	if (accessChanged && !Platform_ReadonlyFilesystem) EntryList_Save(&accessCache, ACCESS_TXT);
+	accessChanged = false;
 }
 
 cc_bool TextureCache_HasAccepted(const cc_string* url) { return EntryList_Find(&acceptedList, url, ' ') >= 0; }
@@ -274,20 +308,23 @@ static cc_bool UseDedicatedCache(cc_string* path, const cc_string* key) {
 	return !cacheInvalid;
 }
 
-CC_NOINLINE static void MakeCachePath(cc_string* mainPath, cc_string* altPath, const cc_string* url) {
-	cc_string key; char keyBuffer[STRING_INT_CHARS];
-	String_InitArray(key, keyBuffer);
-	HashUrl(&key, url);
-	
-	if (UseDedicatedCache(mainPath, &key)) {
+static void MakeCachePathFromKey(cc_string* mainPath, cc_string* altPath, const cc_string* key) {
+	if (UseDedicatedCache(mainPath, key)) {
 		/* If using dedicated cache directory, also fallback to default cache directory */
-		String_Format1(altPath,  "texturecache/%s",  &key);
+		String_Format1(altPath,  "texturecache/%s",  key);
 	} else {
 		mainPath->length = 0;
-		String_Format1(mainPath, "texturecache/%s",  &key);
+		String_Format1(mainPath, "texturecache/%s",  key);
 	}
 }
 
+CC_NOINLINE static void MakeCachePath(cc_string* mainPath, cc_string* altPath, const cc_string* url) {
+	cc_string key; char keyBuffer[STRING_INT_CHARS];
+	String_InitArray(key, keyBuffer);
+	HashUrl(&key, url);
+	MakeCachePathFromKey(mainPath, altPath, &key);
+}
+
 /* Returns non-zero if given URL has been cached */
 static int IsCached(const cc_string* url) {
 	cc_string mainPath; char mainBuffer[FILENAME_SIZE];
@@ -299,10 +336,77 @@ static int IsCached(const cc_string* url) {
 	return File_Exists(&mainPath) || (altPath.length && File_Exists(&altPath));
 }
 
+/* Marks the given cache entry as the most recently used one */
+static void TouchCacheEntry(const cc_string* key, cc_uint32 size) {
+	cc_string value; char valueBuffer[STRING_INT_CHARS * 2];
+	int oldCounter, oldSize;
+
+	value = EntryList_UNSAFE_Get(&accessCache, key, ' ');
+	ParseAccessEntry(&value, &oldCounter, &oldSize);
+	cacheSize = cacheSize - oldSize + size;
+
+	String_InitArray(value, valueBuffer);
+	accessCounter++;
+	String_Format2(&value, "%i %i", &accessCounter, &size);
+	EntryList_Set(&accessCache, key, &value, ' ');
+	accessChanged = true;
+}
+
+/* Discards the least recently used cache entries, until the cache is within its size limit */
+/* NOTE: Cached files are truncated rather than deleted, which OpenCachedData treats as not cached */
+static void EvictCacheEntries(const cc_string* keep) {
+	cc_string mainPath; char mainBuffer[FILENAME_SIZE];
+	cc_string altPath;  char  altBuffer[FILENAME_SIZE];
+	cc_string entry, key, value;
+	int i, oldest, counter, size, oldestCounter, oldestSize;
+	cc_bool evicted = false;
+	cc_result res;
+
+	while (cacheSize > cacheLimit) {
+		oldest = -1; oldestCounter = 0; oldestSize = 0;
+
+		for (i = 0; i < accessCache.count; i++) 
+		{
+			entry = StringsBuffer_UNSAFE_Get(&accessCache, i);
+			String_UNSAFE_Separate(&entry, ' ', &key, &value);
+			if (String_CaselessEquals(&key, keep)) continue;
+
+			ParseAccessEntry(&value, &counter, &size);
+			if (oldest >= 0 && counter >= oldestCounter) continue;
+			oldest = i; oldestCounter = counter; oldestSize = size;
+		}
+		if (oldest == -1) break;
+
+		entry = StringsBuffer_UNSAFE_Get(&accessCache, oldest);
+		String_UNSAFE_Separate(&entry, ' ', &key, &value);
+		String_InitArray(mainPath, mainBuffer);
+		String_InitArray(altPath,   altBuffer);
+		MakeCachePathFromKey(&mainPath, &altPath, &key);
+
+		res = Stream_WriteAllTo(&mainPath, NULL, 0);
+		if (res) Logger_SysWarn2(res, "evicting", &mainPath);
+		if (altPath.length && File_Exists(&altPath)) Stream_WriteAllTo(&altPath, NULL, 0);
+
+		EntryList_Remove(&etagCache,    &key, ' ');
+		EntryList_Remove(&lastModCache, &key, ' ');
+		/* NOTE: key points into accessCache, so must be removed last */
+		StringsBuffer_Remove(&accessCache, oldest);
+		cacheSize    -= oldestSize;
+		evicted       = true;
+		accessChanged = true;
+	}
+	if (!evicted) return;
+
+	EntryList_Save(&etagCache,    ETAGS_TXT);
+	EntryList_Save(&lastModCache, LASTMOD_TXT);
+}
+
 /* Attempts to open the cached data stream for the given url */
 static cc_bool OpenCachedData(const cc_string* url, struct Stream* stream) {
 	cc_string mainPath; char mainBuffer[FILENAME_SIZE];
 	cc_string altPath;  char  altBuffer[FILENAME_SIZE];
+	cc_string key; char keyBuffer[STRING_INT_CHARS];
+	cc_uint32 length = 0;
 	cc_result res;
 	String_InitArray(mainPath, mainBuffer);
 	String_InitArray(altPath,   altBuffer);
@@ -317,6 +421,14 @@ static cc_bool OpenCachedData(const cc_string* url, struct Stream* stream) {
 
 	if (res == ReturnCode_FileNotFound) return false;
 	if (res) { Logger_SysWarn2(res, "opening cache for", url); return false; }
+
+	/* Empty files are cache entries that have been evicted */
+	stream->Length(stream, &length);
+	if (!length) { (void)stream->Close(stream); return false; }
+
+	String_InitArray(key, keyBuffer);
+	HashUrl(&key, url);
+	TouchCacheEntry(&key, length);
 	return true;
 }
 
@@ -356,11 +468,29 @@ CC_NOINLINE static void SetCachedTag(const cc_string* url, struct StringsBuffer*
 	EntryList_Save(list, file);
 }
 
-/* Updates cached data, ETag, and Last-Modified for the given URL */
-static void UpdateCache(struct HttpRequest* req) {
+cc_bool TextureCache_Open(const cc_string* url, struct Stream* stream) {
+	return OpenCachedData(url, stream);
+}
+
+int TextureCache_Download(const cc_string* url, cc_uint8 flags) {
+	cc_string etag = String_Empty;
+	cc_string time = String_Empty;
+
+	/* Only retrieve etag/last-modified headers if the file exists */
+	/* This inconsistency can occur if user deleted some cached files */
+	if (IsCached(url)) {
+		time = GetCachedLastModified(url);
+		etag = GetCachedETag(url);
+	}
+	return Http_AsyncGetDataEx(url, flags, &time, &etag, NULL);
+}
+
+void TextureCache_Update(struct HttpRequest* req) {
 	cc_string url, altPath, value;
 	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_string key;  char keyBuffer[STRING_INT_CHARS];
 	cc_result res;
+	if (Platform_ReadonlyFilesystem) return;
 	url = String_FromRawArray(req->url);
 
 	value = String_FromRawArray(req->etag);
@@ -373,7 +503,13 @@ static void UpdateCache(struct HttpRequest* req) {
 	MakeCachePath(&path, &altPath, &url);
 
 	res = Stream_WriteAllTo(&path, req->data, req->size);
-	if (res) { Logger_SysWarn2(res, "caching", &url); }
+	if (res) { Logger_SysWarn2(res, "caching", &url); return; }
+
+	String_InitArray(key, keyBuffer);
+	HashUrl(&key, &url);
+	TouchCacheEntry(&key, req->size);
+	EvictCacheEntries(&key);
+	SaveAccessList();
 }
 
 
@@ -524,7 +660,7 @@ static void ApplyDownloaded(struct HttpRequest* item) {
 	cc_string url;
 
 	url = String_FromRawArray(item->url);
-	if (!Platform_ReadonlyFilesystem) UpdateCache(item);
+	TextureCache_Update(item);
 	/* Took too long to download and is no longer active texture pack */
 	if (!String_Equals(&TexturePack_Url, &url)) return;
 
@@ -557,18 +693,8 @@ void TexturePack_CheckPending(void) {
 
 /* Asynchronously downloads the given texture pack */
 static void DownloadAsync(const cc_string* url) {
-	cc_string etag = String_Empty;
-	cc_string time = String_Empty;
-
-	/* Only retrieve etag/last-modified headers if the file exists */
-	/* This inconsistency can occur if user deleted some cached files */
-	if (IsCached(url)) {
-		time = GetCachedLastModified(url);
-		etag = GetCachedETag(url);
-	}
-
 	Http_TryCancel(TexturePack_ReqID);
-	TexturePack_ReqID = Http_AsyncGetDataEx(url, HTTP_FLAG_PRIORITY, &time, &etag, NULL);
+	TexturePack_ReqID = TextureCache_Download(url, HTTP_FLAG_PRIORITY);
 }
 
 void TexturePack_Extract(const cc_string* url) {
@@ -655,6 +781,7 @@ static void OnReset(void) {
 
 static void OnFree(void) {
 	OnContextLost(NULL);
+	SaveAccessList();
 	Atlas2D_Free();
 	TexturePack_Url.length = 0;
 	entries_head = NULL;
@@ -86,6 +86,16 @@ void TextureCache_Accept(const cc_string* url);
 void TextureCache_Deny(const cc_string* url);
 /* Clears the list of denied URLs, returning number removed. */
 int TextureCache_ClearDenied(void);
+/* Attempts to open the cached data for the given URL. */
+/* NOTE: Also marks the cached data as recently used, so it is the last to be evicted. */
+cc_bool TextureCache_Open(const cc_string* url, struct Stream* stream);
+/* Asynchronously downloads the given URL, returning the request ID. */
+/* If the URL has been cached, the server is asked to only send data if it has changed since. */
+/* (i.e. the response has a 304 status code and no data if the cached data is still up to date) */
+int TextureCache_Download(const cc_string* url, cc_uint8 flags);
+/* Updates the cached data, ETag, and Last-Modified for the URL of the given request. */
+/* NOTE: If the cache grows beyond its size limit, the least recently used data is discarded. */
+void TextureCache_Update(struct HttpRequest* req);
 
 /* Request ID of texture pack currently being downloaded */
 extern int TexturePack_ReqID;
@@ -41,11 +41,21 @@ int Utils_AccumulateWheelDelta(float* accumulator, float delta);
 
 cc_uint8 Utils_CalcSkinType(const struct Bitmap* bmp);
 cc_uint32 Utils_CRC32(const cc_uint8* data, cc_uint32 length);
+/* Updates a running CRC32 with the given data. */
+/* NOTE: A running CRC32 starts as 0xFFFFFFFF, and must be xor-ed with 0xFFFFFFFF to get the final CRC32 */
+cc_uint32 Utils_Crc32Update(cc_uint32 crc, const cc_uint8* data, cc_uint32 length);
+/* Calculates the CRC32 of data1 followed by data2, from the CRC32s of data1 and data2 and the length of data2 */
+cc_uint32 Utils_Crc32Combine(cc_uint32 crc1, cc_uint32 crc2, cc_uint32 length2);
 /* CRC32 lookup table, for faster CRC32 calculations. */
 /* NOTE: This cannot be just indexed by byte value - see Utils_CRC32 implementation. */
 extern const cc_uint32 Utils_Crc32Table[256];
 CC_NOINLINE void Utils_Resize(void** buffer, int* capacity, cc_uint32 elemSize, int defCapacity, int expandElems);
 void Utils_SwapEndian16(cc_int16* values, int numValues);
+/* Sorts the given values by their keys in ascending order, using a LSD radix sort */
+/* The sort is stable, and takes linear time regardless of how the keys were previously ordered */
+/* NOTE: tmpKeys and tmpValues must have room for count elements */
+/* Returns whether the sorted results ended up in tmpKeys and tmpValues instead */
+cc_bool Utils_RadixSortKV(cc_uint32* keys, void** values, cc_uint32* tmpKeys, void** tmpValues, int count);
 
 /* Converts blocks of 3 bytes into 4 ASCII characters. (pads if needed) */
 /* Returns the number of ASCII characters written. */
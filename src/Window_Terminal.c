@@ -98,6 +98,8 @@ static int orig_KB = K_XLATE;
 
 static void UpdateDimensions(void) {
 	ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws);
+	// Output may not be an actual terminal (e.g. headless benchmark runs)
+	if (!ws.ws_col || !ws.ws_row) { ws.ws_col = 80; ws.ws_row = 24; }
 
 	DisplayInfo.Width  = ws.ws_col;
 	DisplayInfo.Height = ws.ws_row * 2;
@@ -203,7 +205,7 @@ void Window_SetSize(int width, int height) {
 }
 
 void Window_RequestClose(void) {
-	// TODO
+	pendingClose = true;
 }
 
 #ifdef CC_BUILD_WIN
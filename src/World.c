@@ -10,9 +10,290 @@
 #include "Game.h"
 #include "TexturePack.h"
 #include "Window.h"
+#include "Funcs.h"
 
 struct _WorldData World;
 static char nameBuffer[STRING_SIZE];
+
+#ifdef CC_BUILD_CHUNKEDWORLD
+/*########################################################################################################################*
+*-------------------------------------------------------World chunks------------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef EXTENDED_BLOCKS
+#define WORLDCHUNK_MAX_IDS 1024
+#else
+#define WORLDCHUNK_MAX_IDS 256
+#endif
+#define World_PagedBlock(pages, i) pages[(i) >> WORLD_PAGE_SHIFT][(i) & WORLD_PAGE_MASK]
+
+static cc_bool WorldChunk_AllocData(struct WorldChunk* chunk, int bits) {
+	chunk->data = (cc_uint8*)Mem_TryAllocCleared(CHUNK_SIZE_3 * bits / 8, 1);
+	if (!chunk->data) return false;
+	chunk->bits    = bits;
+	chunk->palette = NULL;
+	if (bits == 16) return true;
+
+	chunk->palette = (BlockID*)Mem_TryAlloc(1 << bits, sizeof(BlockID));
+	if (chunk->palette) return true;
+
+	Mem_Free(chunk->data);
+	chunk->data = NULL;
+	return false;
+}
+
+static void WorldChunk_FreeData(struct WorldChunk* chunk) {
+	Mem_Free(chunk->data);
+	Mem_Free(chunk->palette);
+	chunk->data    = NULL;
+	chunk->palette = NULL;
+}
+
+static int WorldChunk_GetIndex(const struct WorldChunk* chunk, int i) {
+	int bit;
+	if (!chunk->data) return 0;
+
+	bit = i * chunk->bits;
+	return (chunk->data[bit >> 3] >> (bit & 7)) & ((1 << chunk->bits) - 1);
+}
+
+static void WorldChunk_SetIndex(struct WorldChunk* chunk, int i, int index) {
+	int bit  = i * chunk->bits;
+	int mask = ((1 << chunk->bits) - 1) << (bit & 7);
+	chunk->data[bit >> 3] = (chunk->data[bit >> 3] & ~mask) | (index << (bit & 7));
+}
+
+/* Changes how many bits are used per block in the given chunk */
+static cc_bool WorldChunk_Repack(struct WorldChunk* chunk, int bits) {
+	struct WorldChunk tmp = *chunk;
+	const BlockID* palette;
+	int i;
+	if (!WorldChunk_AllocData(&tmp, bits)) return false;
+
+	if (bits == 16) {
+		for (i = 0; i < CHUNK_SIZE_3; i++) {
+			((BlockID*)tmp.data)[i] = WorldChunk_GetBlock(chunk, i);
+		}
+	} else {
+		palette = chunk->data ? chunk->palette : &chunk->uniform;
+		Mem_Copy(tmp.palette, palette, chunk->count * sizeof(BlockID));
+
+		for (i = 0; i < CHUNK_SIZE_3; i++) {
+			WorldChunk_SetIndex(&tmp, i, WorldChunk_GetIndex(chunk, i));
+		}
+	}
+
+	WorldChunk_FreeData(chunk);
+	*chunk = tmp;
+	return true;
+}
+
+static cc_bool WorldChunk_SetBlock(struct WorldChunk* chunk, int i, BlockID block) {
+	int index;
+	if (!chunk->data) {
+		if (block == chunk->uniform) return true;
+		if (!WorldChunk_Repack(chunk, 1)) return false;
+	}
+
+	if (chunk->bits != 16) {
+		for (index = 0; index < chunk->count; index++) {
+			if (chunk->palette[index] == block) break;
+		}
+
+		if (index == chunk->count && index == (1 << chunk->bits)) {
+			if (!WorldChunk_Repack(chunk, chunk->bits * 2)) return false;
+		}
+	}
+
+	if (chunk->bits == 16) {
+		((BlockID*)chunk->data)[i] = block;
+		return true;
+	}
+
+	if (index == chunk->count) {
+		chunk->palette[index] = block;
+		chunk->count++;
+	}
+	WorldChunk_SetIndex(chunk, i, index);
+	return true;
+}
+
+void World_GetBlockRow(int x, int y, int z, int count, BlockID* blocks) {
+	const struct WorldChunk* chunk;
+	int i, base, len;
+
+	while (count > 0) {
+		chunk = &World.Chunks[World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)];
+		base  = World_ChunkLocalIndex(x, y, z);
+		len   = min(count, CHUNK_SIZE - (x & CHUNK_MASK));
+
+		if (!chunk->data) {
+			for (i = 0; i < len; i++) blocks[i] = chunk->uniform;
+		} else {
+			for (i = 0; i < len; i++) blocks[i] = WorldChunk_GetBlock(chunk, base + i);
+		}
+		x += len; blocks += len; count -= len;
+	}
+}
+
+static void WorldChunks_Free(void) {
+	int i;
+	if (!World.Chunks) return;
+
+	for (i = 0; i < World.ChunksCount; i++) {
+		WorldChunk_FreeData(&World.Chunks[i]);
+	}
+	Mem_Free(World.Chunks);
+	World.Chunks = NULL;
+}
+
+/* Converts the blocks of the given chunk from the given pages of blocks */
+/* NOTE: base is subtracted from the packed index of each block before looking it up in the pages */
+static cc_bool WorldChunks_ConvertChunk(struct WorldChunk* chunk, int x1, int y1, int z1, cc_uint16* lookup,
+										BlockRaw** pages, BlockRaw** pages2, int base) {
+	BlockID palette[CHUNK_SIZE_3];
+	cc_uint16 indices[CHUNK_SIZE_3];
+	int x2 = min(x1 + CHUNK_SIZE, World.Width);
+	int y2 = min(y1 + CHUNK_SIZE, World.Height);
+	int z2 = min(z1 + CHUNK_SIZE, World.Length);
+	int x, y, z, i, index, count = 0, bits = 0;
+	BlockID block;
+	cc_bool ok = true;
+
+	/* Any parts of the chunk outside the map use the first block in the palette */
+	Mem_Set(indices, 0, sizeof(indices));
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			index = World_Pack(x1, y, z) - base;
+			i     = World_ChunkLocalIndex(x1, y, z);
+
+			for (x = x1; x < x2; x++, index++, i++) {
+				block = World_PagedBlock(pages, index);
+				if (pages2) block |= World_PagedBlock(pages2, index) << 8;
+
+				/* lookup stores 1 + index of the block in the palette, or 0 if not in the palette yet */
+				if (!lookup[block]) {
+					palette[count++] = block;
+					lookup[block]    = count;
+				}
+				indices[i] = lookup[block] - 1;
+			}
+		}
+	}
+
+	chunk->count   = count;
+	chunk->uniform = palette[0];
+	if (count > 1) {
+		for (bits = 1; (1 << bits) < count && bits < 16; bits *= 2) { }
+		ok = WorldChunk_AllocData(chunk, bits);
+	}
+
+	if (ok && bits == 16) {
+		for (i = 0; i < CHUNK_SIZE_3; i++) {
+			((BlockID*)chunk->data)[i] = palette[indices[i]];
+		}
+	} else if (ok && count > 1) {
+		Mem_Copy(chunk->palette, palette, count * sizeof(BlockID));
+		for (i = 0; i < CHUNK_SIZE_3; i++) {
+			WorldChunk_SetIndex(chunk, i, indices[i]);
+		}
+	}
+
+	for (i = 0; i < count; i++) lookup[palette[i]] = 0;
+	return ok;
+}
+
+/* Converts the given pages of blocks into chunks */
+static cc_bool WorldChunks_Convert(BlockRaw** pages, BlockRaw** pages2) {
+	cc_uint16 lookup[WORLDCHUNK_MAX_IDS] = { 0 };
+	int cx, cy, cz, i = 0, dense = 0;
+	cc_bool ok = true;
+
+	World.Chunks = (struct WorldChunk*)Mem_TryAllocCleared(World.ChunksCount, sizeof(struct WorldChunk));
+	ok = World.Chunks != NULL;
+
+	for (cz = 0; ok && cz < World.ChunksZ; cz++) {
+		for (cy = 0; ok && cy < World.ChunksY; cy++) {
+			for (cx = 0; ok && cx < World.ChunksX; cx++, i++) 
+			{
+				ok = WorldChunks_ConvertChunk(&World.Chunks[i], cx << CHUNK_SHIFT, cy << CHUNK_SHIFT, cz << CHUNK_SHIFT, 
+												lookup, pages, pages2, 0);
+				if (World.Chunks[i].data) dense++;
+			}
+		}
+	}
+
+	if (!ok) { WorldChunks_Free(); return false; }
+	Platform_Log2("World has %i chunks, of which %i are not uniform", &World.ChunksCount, &dense);
+	return true;
+}
+
+/* Converts the loaded blocks array into chunks, then frees the loaded blocks array */
+static cc_bool WorldChunks_ConvertLoaded(void) {
+	int i, count = (World.Volume + WORLD_PAGE_MASK) >> WORLD_PAGE_SHIFT;
+	BlockRaw** pages  = (BlockRaw**)Mem_TryAlloc(count * 2, sizeof(BlockRaw*));
+	BlockRaw** pages2 = NULL;
+	cc_bool ok = pages != NULL;
+
+	if (ok) {
+		for (i = 0; i < count; i++) pages[i] = World.Blocks + (i << WORLD_PAGE_SHIFT);
+#ifdef EXTENDED_BLOCKS
+		if (World.Blocks != World.Blocks2) {
+			pages2 = pages + count;
+			for (i = 0; i < count; i++) pages2[i] = World.Blocks2 + (i << WORLD_PAGE_SHIFT);
+		}
+#endif
+		ok = WorldChunks_Convert(pages, pages2);
+	}
+	Mem_Free(pages);
+
+#ifdef EXTENDED_BLOCKS
+	if (World.Blocks != World.Blocks2) Mem_Free(World.Blocks2);
+	World.Blocks2 = NULL;
+#endif
+	Mem_Free(World.Blocks);
+	World.Blocks = NULL;
+	return ok;
+}
+
+cc_bool World_AllocChunks(int width, int height, int length) {
+	WorldChunks_Free();
+	World_SetDimensions(width, height, length);
+
+	World.Chunks = (struct WorldChunk*)Mem_TryAllocCleared(World.ChunksCount, sizeof(struct WorldChunk));
+	return World.Chunks != NULL;
+}
+
+cc_bool World_ConvertChunkLayer(int cy, BlockRaw* blocks) {
+	cc_uint16 lookup[WORLDCHUNK_MAX_IDS] = { 0 };
+	int i, cx, cz, base = (cy << CHUNK_SHIFT) * World.OneY;
+	int count = ((World.OneY << CHUNK_SHIFT) + WORLD_PAGE_MASK) >> WORLD_PAGE_SHIFT;
+	BlockRaw** pages = (BlockRaw**)Mem_TryAlloc(count, sizeof(BlockRaw*));
+	cc_bool ok = pages != NULL;
+
+	if (ok) {
+		for (i = 0; i < count; i++) pages[i] = blocks + (i << WORLD_PAGE_SHIFT);
+	}
+
+	for (cz = 0; ok && cz < World.ChunksZ; cz++) {
+		for (cx = 0; ok && cx < World.ChunksX; cx++)
+		{
+			i  = World_ChunkPack(cx, cy, cz);
+			ok = WorldChunks_ConvertChunk(&World.Chunks[i], cx << CHUNK_SHIFT, cy << CHUNK_SHIFT, cz << CHUNK_SHIFT,
+											lookup, pages, NULL, base);
+		}
+	}
+	Mem_Free(pages);
+	return ok;
+}
+
+static void WorldChunks_OutOfMemory(void) {
+	Window_ShowDialog("Out of memory", "Not enough free memory to load the map.\nTry joining a different map.");
+	World_SetDimensions(0, 0, 0);
+}
+#endif
+
+
 /*########################################################################################################################*
 *----------------------------------------------------------World----------------------------------------------------------*
 *#########################################################################################################################*/
@@ -45,6 +326,9 @@ void World_Reset(void) {
 #endif
 	Mem_Free(World.Blocks);
 	World.Blocks = NULL;
+#ifdef CC_BUILD_CHUNKEDWORLD
+	WorldChunks_Free();
+#endif
 	String_InitArray(World.Name, nameBuffer);
 
 	World_SetDimensions(0, 0, 0);
@@ -59,7 +343,23 @@ void World_NewMap(void) {
 	Event_RaiseVoid(&WorldEvents.NewMap);
 }
 
+static void World_RaiseMapLoaded(int height) {
+	if (Env.EdgeHeight == -1)   { Env.EdgeHeight   = height / 2; }
+	if (Env.CloudsHeight == -1) { Env.CloudsHeight = height + 2; }
+
+	GenerateNewUuid();
+	World.Loaded = true;
+	Event_RaiseVoid(&WorldEvents.MapLoaded);
+}
+
 void World_SetNewMap(BlockRaw* blocks, int width, int height, int length) {
+#ifdef CC_BUILD_CHUNKEDWORLD
+	/* Importer already decoded the blocks straight into chunks */
+	if (!blocks && World.Chunks) {
+		World.Name.length = 0;
+		World_RaiseMapLoaded(height); return;
+	}
+#endif
 	/* TODO: TEMP HACK */
 	if (!blocks) { width = 0; height = 0; length = 0; }
 
@@ -76,13 +376,26 @@ void World_SetNewMap(BlockRaw* blocks, int width, int height, int length) {
 	}
 #endif
 
-	if (Env.EdgeHeight == -1)   { Env.EdgeHeight   = height / 2; }
-	if (Env.CloudsHeight == -1) { Env.CloudsHeight = height + 2; }
+#ifdef CC_BUILD_CHUNKEDWORLD
+	if (World.Blocks && !WorldChunks_ConvertLoaded()) WorldChunks_OutOfMemory();
+#endif
+	World_RaiseMapLoaded(height);
+}
 
-	GenerateNewUuid();
-	World.Loaded = true;
-	Event_RaiseVoid(&WorldEvents.MapLoaded);
+#ifdef CC_BUILD_CHUNKEDWORLD
+void World_SetNewMapPages(BlockRaw** pages, BlockRaw** pages2, int width, int height, int length) {
+	if (!pages) { width = 0; height = 0; length = 0; }
+
+	World_SetDimensions(width, height, length);
+	World.Name.length = 0;
+#ifdef EXTENDED_BLOCKS
+	World.IDMask = pages2 ? 0x3FF : 0xFF;
+#endif
+
+	if (World.Volume && !WorldChunks_Convert(pages, pages2)) WorldChunks_OutOfMemory();
+	World_RaiseMapLoaded(height);
 }
+#endif
 
 CC_NOINLINE void World_SetDimensions(int width, int height, int length) {
 	World.Width  = width; World.Height = height; World.Length = length;
@@ -113,7 +426,16 @@ void World_OutOfMemory(void) {
 }
 
 
+#if defined CC_BUILD_CHUNKEDWORLD
+void World_SetBlock(int x, int y, int z, BlockID block) {
+	struct WorldChunk* chunk = &World.Chunks[World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)];
+	if (!WorldChunk_SetBlock(chunk, World_ChunkLocalIndex(x, y, z), block)) { World_OutOfMemory(); return; }
+
 #ifdef EXTENDED_BLOCKS
+	if (block > 0xFF) World.IDMask = 0x3FF;
+#endif
+}
+#elif defined EXTENDED_BLOCKS
 static CC_NOINLINE void LazyInitUpper(int i, BlockID block) {
 	BlockRaw* data = (BlockRaw*)Mem_TryAllocCleared(World.Volume, 1);
 	if (!data) { World_OutOfMemory(); return; }
@@ -19,13 +19,38 @@ extern struct IGameComponent World_Component;
 /* TODO: Swap Y and Z? Make sure to update MapRenderer's ResetChunkCache and ClearChunkCache methods! */
 
 
+#ifdef CC_BUILD_CHUNKEDWORLD
+/* A 16x16x16 chunk of blocks, stored as indices into a palette of the different blocks in the chunk */
+struct WorldChunk {
+	/* Bit packed palette indices, or raw block IDs when bits is 16 */
+	/* NULL when every block in the chunk is the same */
+	cc_uint8* data;
+	/* The different blocks in this chunk */
+	BlockID* palette;
+	/* Block ID of every block in the chunk, when data is NULL */
+	BlockID uniform;
+	/* Number of bits per block in data (1, 2, 4, 8 or 16) */
+	cc_uint8 bits;
+	/* Number of blocks in palette */
+	cc_uint16 count;
+};
+#endif
+
 CC_VAR extern struct _WorldData {
 	/* The blocks in the world. */
+	/* NOTE: With CC_BUILD_CHUNKEDWORLD, this is only used while a map is being loaded, */
+	/*  and is converted into Chunks (and then freed) by World_SetNewMap */
+	/* NOTE: Generators and the .cw/.mclevel/.dat importers (except version 1 .dat) still decode */
+	/*  the whole map into this first, so those need as much memory as without CC_BUILD_CHUNKEDWORLD */
 	BlockRaw* Blocks;
 #ifdef EXTENDED_BLOCKS
 	/* The upper 8 bit of blocks in the world. */
 	/* If only 8 bit blocks are used, equals World_Blocks. */
 	BlockRaw* Blocks2;
+#endif
+#ifdef CC_BUILD_CHUNKEDWORLD
+	/* The blocks in the world, for each chunk in the world. */
+	struct WorldChunk* Chunks;
 #endif
 	/* Volume of the world. */
 	int Volume;
@@ -68,6 +93,22 @@ CC_API void World_NewMap(void);
 /* Sets blocks array/dimensions of the map and raises WorldEvents.MapLoaded event */
 /* May also sets some environment settings like border/clouds height, if they are -1 */
 CC_API void World_SetNewMap(BlockRaw* blocks, int width, int height, int length);
+#ifdef CC_BUILD_CHUNKEDWORLD
+#define WORLD_PAGE_SHIFT 12
+#define WORLD_PAGE_SIZE (1 << WORLD_PAGE_SHIFT)
+#define WORLD_PAGE_MASK (WORLD_PAGE_SIZE - 1)
+/* Same as World_SetNewMap, but the blocks are split into pages of WORLD_PAGE_SIZE blocks */
+/* (i.e. block i is in pages[i >> WORLD_PAGE_SHIFT]). pages2 is the upper 8 bits, or NULL if unused */
+/* NOTE: The pages are converted into chunks, and so can be freed afterwards */
+/* NOTE: Pages only avoid allocating a single map sized array, the whole map must still be received first */
+CC_API void World_SetNewMapPages(BlockRaw** pages, BlockRaw** pages2, int width, int height, int length);
+/* Sets the dimensions of the map and allocates its (still empty) chunks */
+/* NOTE: Used by importers to convert blocks into chunks one layer at a time as they are decoded, */
+/*  after which World_SetNewMap(NULL, ...) raises the MapLoaded event as usual */
+CC_API cc_bool World_AllocChunks(int width, int height, int length);
+/* Converts CHUNK_SIZE rows of blocks (starting at y = cy * CHUNK_SIZE) into that layer of chunks */
+CC_API cc_bool World_ConvertChunkLayer(int cy, BlockRaw* blocks);
+#endif
 /* Sets the various dimension and max coordinate related variables. */
 /* NOTE: This is an internal API. Use World_SetNewMap instead. */
 CC_NOINLINE void World_SetDimensions(int width, int height, int length);
@@ -76,7 +117,44 @@ void World_OutOfMemory(void);
 #ifdef EXTENDED_BLOCKS
 /* Sets World.Blocks2 and updates internal state for more than 256 blocks. */
 void World_SetMapUpper(BlockRaw* blocks);
+#endif
+
+#if defined CC_BUILD_CHUNKEDWORLD
+/* Converts local x/y/z coordinates to the corresponding index in a chunk */
+#define World_ChunkLocalIndex(x, y, z) ((((y) & CHUNK_MASK) << 8) | (((z) & CHUNK_MASK) << 4) | ((x) & CHUNK_MASK))
+/* Whether the world currently has any blocks */
+#define World_HasBlocks() (World.Chunks != NULL)
+
+static CC_INLINE BlockID WorldChunk_GetBlock(const struct WorldChunk* chunk, int i) {
+	int bit;
+	if (!chunk->data) return chunk->uniform;
+#ifdef EXTENDED_BLOCKS
+	if (chunk->bits == 16) return ((BlockID*)chunk->data)[i];
+#endif
 
+	bit = i * chunk->bits;
+	return chunk->palette[(chunk->data[bit >> 3] >> (bit & 7)) & ((1 << chunk->bits) - 1)];
+}
+
+/* Gets the block at the given coordinates. */
+/* NOTE: Does NOT check that the coordinates are inside the map. */
+static CC_INLINE BlockID World_GetBlock(int x, int y, int z) {
+	const struct WorldChunk* chunk = &World.Chunks[World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)];
+	return WorldChunk_GetBlock(chunk, World_ChunkLocalIndex(x, y, z));
+}
+
+/* Gets the block at the given packed index. */
+/* NOTE: This is much slower than World_GetBlock, as the index has to be unpacked */
+static CC_INLINE BlockID World_GetRawBlock(int i) {
+	int x, y, z;
+	World_Unpack(i, x, y, z);
+	return World_GetBlock(x, y, z);
+}
+/* Gets count blocks starting at the given coordinates and moving along the X axis. */
+/* NOTE: Does NOT check that the coordinates are inside the map. */
+void World_GetBlockRow(int x, int y, int z, int count, BlockID* blocks);
+#elif defined EXTENDED_BLOCKS
+#define World_HasBlocks() (World.Blocks != NULL)
 #define World_GetRawBlock(idx) ((World.Blocks[idx] | (World.Blocks2[idx] << 8)) & World.IDMask)
 
 /* Gets the block at the given coordinates. */
@@ -86,6 +164,7 @@ static CC_INLINE BlockID World_GetBlock(int x, int y, int z) {
 	return (BlockID)World_GetRawBlock(i);
 }
 #else
+#define World_HasBlocks() (World.Blocks != NULL)
 #define World_GetBlock(x, y, z) World.Blocks[World_Pack(x, y, z)]
 #define World_GetRawBlock(idx)  World.Blocks[idx]
 #endif
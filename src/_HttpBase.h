@@ -125,6 +125,7 @@ static int Http_Add(const cc_string* url, cc_uint8 flags, cc_uint8 type, const c
 
 	req.id = ++nextReqID;
 	req.requestType = type;
+	req.flags       = flags;
 
 	/* Change http:// to https:// if required */
 	if (httpsOnly) {
@@ -221,15 +222,19 @@ static void Http_CleanCacheTask(struct ScheduledTask* task) {
 /*########################################################################################################################*
 *----------------------------------------------------Http public api------------------------------------------------------*
 *#########################################################################################################################*/
+void Http_GetSkinUrl(const cc_string* skinName, cc_string* url) {
+	if (Utils_IsUrlPrefix(skinName)) {
+		String_Copy(url, skinName);
+	} else {
+		String_Format2(url, "%s/%s.png", &skinServer, skinName);
+	}
+}
+
 int Http_AsyncGetSkin(const cc_string* skinName, cc_uint8 flags) {
 	cc_string url; char urlBuffer[URL_MAX_SIZE];
 	String_InitArray(url, urlBuffer);
 
-	if (Utils_IsUrlPrefix(skinName)) {
-		String_Copy(&url, skinName);
-	} else {
-		String_Format2(&url, "%s/%s.png", &skinServer, skinName);
-	}
+	Http_GetSkinUrl(skinName, &url);
 	return Http_AsyncGetData(&url, flags);
 }
 
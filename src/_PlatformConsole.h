@@ -32,6 +32,13 @@ void Mem_Free(void* mem) {
 void Directory_GetCachePath(cc_string* path) { }
 
 
+/*########################################################################################################################*
+*--------------------------------------------------------Threading--------------------------------------------------------*
+*#########################################################################################################################*/
+/* Console builds do not spread work across multiple processors */
+int Thread_ProcessorCount(void) { return 1; }
+
+
 /*########################################################################################################################*
 *-----------------------------------------------------Process/Module------------------------------------------------------*
 *#########################################################################################################################*/
@@ -9,6 +9,7 @@
 #include "Launcher.h"
 #include "Server.h"
 #include "Options.h"
+#include "Benchmark.h"
 
 static void RunGame(void) {
 	cc_string title; char titleBuffer[STRING_SIZE];
@@ -67,6 +68,36 @@ static void SetupProgram(int argc, char** argv) {
 	String_InitArray(Server.Address, ipBuffer);
 }
 
+#ifndef CC_BUILD_WEB
+/* --benchmark [map file or seed] [frames] [csv file] */
+static int RunBenchmark(int argsCount, const cc_string* args) {
+	Benchmark_Enabled = true;
+
+	if (argsCount > 1 && !Convert_ParseInt(&args[1], &Benchmark_Seed)) {
+		if (!File_Exists(&args[1])) {
+			WarnInvalidArg("Invalid map file or seed", &args[1]);
+			return 1;
+		}
+		String_Copy(&SP_AutoloadMap, &args[1]);
+	}
+
+	if (argsCount > 2 && (!Convert_ParseInt(&args[2], &Benchmark_Frames) || Benchmark_Frames <= 0)) {
+		WarnInvalidArg("Invalid frame count", &args[2]);
+		return 1;
+	}
+
+	if (argsCount > 3) {
+		String_Copy(&Benchmark_OutputPath, &args[3]);
+	} else {
+		String_AppendConst(&Benchmark_OutputPath, "benchmark.csv");
+	}
+
+	Options_Get(LOPT_USERNAME, &Game_Username, DEFAULT_USERNAME);
+	RunGame();
+	return 0;
+}
+#endif
+
 #define SP_HasDir(path) (String_IndexOf(&path, '/') >= 0 || String_IndexOf(&path, '\\') >= 0)
 
 static int RunProgram(int argc, char** argv) {
@@ -92,6 +123,9 @@ static int RunProgram(int argc, char** argv) {
 		args[0] = String_UNSAFE_SubstringAt(&args[0], 1);
 		String_Copy(&Launcher_AutoHash, &args[0]);
 		Launcher_Run();
+	/* Replay a scripted camera path and record frame timings */
+	} else if (String_CaselessEqualsConst(&args[0], "--benchmark")) {
+		return RunBenchmark(argsCount, args);
 	/* File path to auto load a map in singleplayer */
 	} else if (argsCount == 1 && SP_HasDir(args[0]) && File_Exists(&args[0])) {
 		Options_Get(LOPT_USERNAME, &Game_Username, DEFAULT_USERNAME);